@@ -0,0 +1,54 @@
+#ifndef __COMPLETION_LATCH_H__
+#define __COMPLETION_LATCH_H__
+
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <condition_variable>
+
+// A countdown latch counting the outcome of every completed task.
+// Completing a task is a few atomic operations on counters padded to their own cache line:
+// only the completion that releases the latch takes the mutex to wake the waiters,
+// and waiting is O(1) whatever the number of tasks.
+class CompletionLatch {
+public:
+    enum Outcome {
+        Succeeded,
+        Failed,
+        Canceled
+    };
+
+    CompletionLatch();
+
+    // tasks to wait for
+    void add(int64_t count = 1);
+    void countDown(Outcome outcome);
+
+    // return true if no task is pending, the waits hold the mutex when they return true,
+    // so the latch can be destroyed once a wait has returned true: the last countDown() is over
+    bool wait(int millis);
+    void wait();
+    // clear the counters, no task must be pending
+    void reset();
+
+    int64_t pending() const;
+    int64_t total() const;
+    int64_t succeeded() const;
+    int64_t failed() const;
+    int64_t canceled() const;
+
+private:
+    // written by add(), read by the waiters
+    std::atomic<int64_t>    m_total;
+    char                    m_pad_total[64 - sizeof(std::atomic<int64_t>)];
+    // it only reaches zero under m_mutex
+    std::atomic<int64_t>    m_pending;
+    char                    m_pad_pending[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<int64_t>    m_succeeded;
+    char                    m_pad_succeeded[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<int64_t>    m_failed;
+    std::atomic<int64_t>    m_canceled;
+    std::mutex              m_mutex;
+    std::condition_variable m_cv;
+};
+#endif // __COMPLETION_LATCH_H__
@@ -0,0 +1,50 @@
+#ifndef __DEADLINE_TIMER_H__
+#define __DEADLINE_TIMER_H__
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+
+// A single thread running callbacks at their deadline, e.g. canceling the groups with a deadline.
+// The callbacks run on the timer thread: they must be short.
+class DeadlineTimer {
+public:
+    typedef std::chrono::steady_clock Clock;
+    typedef uint64_t Id;
+
+    // the timer shared by the process, started on first use
+    static DeadlineTimer& instance();
+
+    DeadlineTimer();
+    ~DeadlineTimer();
+
+    // the ids start at 1
+    Id add(Clock::time_point deadline, const std::function<void()>& callback);
+    // once it has returned, the callback is neither running nor will run
+    // (unless it is called by the callback itself)
+    void remove(Id id);
+    size_t size();
+
+private:
+    struct Entry {
+        Clock::time_point     m_deadline;
+        std::function<void()> m_callback;
+    };
+
+    void run();
+
+    std::mutex                                  m_mutex;
+    std::condition_variable                     m_cv;
+    std::map<Id, Entry>                         m_entries;
+    std::set<std::pair<Clock::time_point, Id>>  m_deadlines;
+    Id                                          m_next_id;
+    Id                                          m_running;
+    bool                                        m_stop;
+    std::thread                                 m_thread;
+};
+#endif // __DEADLINE_TIMER_H__
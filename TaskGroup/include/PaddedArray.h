@@ -0,0 +1,54 @@
+#ifndef __PADDED_ARRAY_H__
+#define __PADDED_ARRAY_H__
+
+#include <new>
+#include <memory>
+#include <cstddef>
+
+// An array of T constructed in place, every element padded to its own cache lines
+// so the threads writing neighbour elements do not share a line.
+template<typename T>
+class PaddedArray {
+public:
+    static const size_t CACHE_LINE = 64;
+    static const size_t STRIDE = (sizeof(T) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+
+    template<typename Arg>
+    PaddedArray(size_t size, const Arg& arg):
+    m_storage(new char[size * STRIDE + CACHE_LINE]),
+    m_size(0) {
+        void* data = m_storage.get();
+        size_t space = size * STRIDE + CACHE_LINE;
+        m_data = static_cast<char*>(std::align(CACHE_LINE, size * STRIDE, data, space));
+        for (; m_size < size; ++m_size) {
+            new (m_data + m_size * STRIDE) T(arg);
+        }
+    }
+
+    ~PaddedArray() {
+        for (size_t i = 0; i < m_size; ++i) {
+            (*this)[i].~T();
+        }
+    }
+
+    T& operator[](size_t i) {
+        return *reinterpret_cast<T*>(m_data + i * STRIDE);
+    }
+
+    const T& operator[](size_t i) const {
+        return *reinterpret_cast<const T*>(m_data + i * STRIDE);
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+private:
+    PaddedArray(const PaddedArray&);
+    PaddedArray& operator=(const PaddedArray&);
+
+    std::unique_ptr<char[]> m_storage;
+    char*                   m_data;
+    size_t                  m_size;
+};
+#endif // __PADDED_ARRAY_H__
@@ -0,0 +1,68 @@
+#ifndef __TASK_GRAPH_H__
+#define __TASK_GRAPH_H__
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <exception>
+#include <functional>
+
+#include "TaskGroup.h"
+#include "CompletionLatch.h"
+
+// A graph of tasks run on the scheduler of a TaskGroup: every node runs once all its
+// dependencies have ended, and the graph can run again, e.g. once per frame.
+// The nodes are scheduled straight on the scheduler, not as pplx tasks: a run allocates nothing,
+// one node per ready set is even run inline by the thread which made it ready.
+// A run is counted as a task of the group, so wait() and terminate() wait for it, and the metrics of
+// the group measure its nodes. A task of the group may run a graph: the waiting worker runs the pending tasks.
+// The graph is built then run, adding nodes or edges during a run is not supported.
+class TaskGraph {
+public:
+    // the nodes are skipped once 'group' is canceled
+    explicit TaskGraph(TaskGroup& group);
+    ~TaskGraph();
+
+    // return the node id
+    size_t add(const std::function<void()>& func, const std::vector<size_t>& dependencies = std::vector<size_t>());
+    // 'after' runs once 'before' has ended
+    void precede(size_t before, size_t after);
+
+    // run every node once and block until the graph has ended. Return false if the group
+    // has been canceled before the end, rethrow the first exception of a node (its successors are skipped).
+    // Throw std::logic_error if the graph has a cycle.
+    bool run();
+
+    size_t size() const;
+
+private:
+    struct Node {
+        TaskGraph*            m_graph;
+        std::function<void()> m_func;
+        std::vector<Node*>    m_successors;
+        int                   m_dependencies;
+        // dependencies not ended yet in the current run
+        std::atomic<int>      m_pending;
+        // set when the node is ready, for the metrics of the group
+        int64_t               m_enqueued;
+    };
+
+    static void runNode(void* param);
+    void execute(Node* node);
+    // the node is ready: its enqueue time, if it is sampled by the metrics of the group
+    int64_t enqueue() const;
+    void invoke(Node* node);
+    // the roots, and the check for cycles
+    void prepare();
+
+    TaskGroup&                         m_group;
+    std::vector<std::unique_ptr<Node>> m_nodes;
+    std::vector<Node*>                 m_roots;
+    bool                               m_prepared;
+    CompletionLatch                    m_latch;
+    std::atomic<bool>                  m_stopped;
+    std::mutex                         m_error_mutex;
+    std::exception_ptr                 m_error;
+};
+#endif // __TASK_GRAPH_H__
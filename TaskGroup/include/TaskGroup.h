@@ -1,37 +1,341 @@
 #ifndef __TASK_GROUP_H__
 #define __TASK_GROUP_H__
 
-#include <vector>
 #include <thread>
-#include <condition_variable>
+#include <memory>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <iterator>
+#include <algorithm>
+#include <exception>
+#include <utility>
 
 #include "pplx/pplxtasks.h"
+#include "CompletionLatch.h"
+#include "DeadlineTimer.h"
+#include "TaskMetrics.h"
+
+class WorkStealingScheduler;
 
 // An implementation of a group of pplx::task
 // with no return value: pplx::task<void>
-// in case we want specialized return type value, 
-// then template it as template<_ReturnType=void>
+// in case we want specialized return type value,
+// see TypedTaskGroup<R>
+// The tasks run on a pluggable pplx scheduler: the default pplx ambient scheduler,
+// or e.g. a WorkStealingScheduler shared by several groups.
+// The completions are counted by a CompletionLatch: no lock per task, and wait() is O(1).
+// parallel_for() splits a loop into a few chunk tasks run on the group's scheduler.
+// A group may have a deadline, and child groups: canceling a group cancels its children,
+// and a group waits for the tasks of its children too.
+// enableMetrics() measures the tasks created by the group: latencies, queue depth and utilization.
 class TaskGroup {
 public:
-    TaskGroup();
+    // how parallel_for() splits [first, last) into chunks
+    enum class Partition {
+        // one block per worker, the cheapest split for iterations of equal cost
+        Static,
+        // the tasks claim chunks from a shared cursor, every chunk is a fraction of what remains
+        Guided,
+        // the range is split in halves, a half stolen by an idle thread is split again
+        Adaptive
+    };
+
+    // nullptr means the pplx ambient scheduler
+    explicit TaskGroup(std::shared_ptr<pplx::scheduler_interface> scheduler = nullptr);
+    // a child group on the scheduler of 'parent', canceled with it, 'parent' must outlive it
+    explicit TaskGroup(TaskGroup& parent);
     ~TaskGroup();
 
     void pushTask(pplx::task<void>&& task);
+    // create the task on the group's scheduler, with the group's cancellation token
+    template<typename Function>
+    void run(const Function& func) {
+        pushTask(pplx::create_task(measured(func), taskOptions()));
+    }
+
+    // call func(i) for every i in [first, last) and block until the chunks have ended.
+    // A chunk of at least 'grain' iterations runs without checking the group's cancellation token.
+    // Return false if the group has been canceled before the end of the loop,
+    // rethrow the first exception of 'func' (the chunks not started yet are skipped).
+    template<typename Index, typename Function>
+    bool parallel_for(Index first, Index last, const Function& func,
+                      Partition partition = Partition::Adaptive, Index grain = 1);
+    // call func(*it) for every it in [first, last), a random access range
+    template<typename Iterator, typename Function>
+    bool parallel_for_each(Iterator first, Iterator last, const Function& func,
+                           Partition partition = Partition::Adaptive, size_t grain = 1);
 
     // return true if all tasks have ended
     bool wait(int millis);
+    // wait up to 'millis', then cancel the tasks still running and wait for them:
+    // return true if all tasks have ended in time
+    bool waitOrCancel(int millis);
     void terminate();
+    void cancel();
+    // cancel the group at 'deadline', replacing the previous deadline
+    void setDeadline(DeadlineTimer::Clock::time_point deadline);
+    void cancelAfter(int millis);
+
+    // a relaxed atomic load, cheap enough for the inner loops of the tasks
+    bool isCanceled() const {
+        return m_canceled.load(std::memory_order_relaxed);
+    }
 
     // getters
     void getStatus(int &succeeded, int &total);
+    void getStatus(int &succeeded, int &failed, int &canceled, int &total);
     const pplx::cancellation_token_source& getCts();
+    const std::shared_ptr<pplx::scheduler_interface>& getScheduler();
+
+    // measure the tasks created by run(), parallel_for() and TypedTaskGroup from now on,
+    // the latencies of one task out of 'sample_every', rounded up to a power of two. Call it before running the tasks.
+    void enableMetrics(unsigned int sample_every = 16);
+    // throw std::logic_error if the metrics are not enabled
+    TaskMetrics::Snapshot getMetrics();
+
+protected:
+    // the task is counted by the group and by 'latch' too, if any
+    void pushTask(pplx::task<void>&& task, CompletionLatch* latch);
+    // wait for the tasks counted by 'latch': a worker of a WorkStealingScheduler runs the pending tasks
+    // meanwhile, so that a task of the group may wait for the tasks it has pushed, e.g. a nested parallel_for()
+    void waitFor(CompletionLatch& latch);
+    pplx::task_options taskOptions();
+    // the workers of a WorkStealingScheduler, otherwise the hardware threads
+    size_t concurrency();
+    // a worker of a WorkStealingScheduler has its own lane, the other threads are hashed
+    size_t laneIndex(size_t lanes) const;
+
+    // a task function measured by the metrics of the group, if enabled
+    template<typename Function>
+    class MeasuredTask {
+    public:
+        typedef decltype(std::declval<const Function&>()()) Result;
+
+        MeasuredTask(const TaskGroup* group, TaskMetrics* metrics, const Function& func):
+        m_group(group),
+        m_metrics(metrics),
+        m_enqueued(metrics ? metrics->enqueue() : 0),
+        m_func(func) {
+        }
+
+        Result operator()() const {
+            if (!m_metrics) {
+                return m_func();
+            }
+            TaskMetrics::Scope scope(*m_metrics, m_group->laneIndex(m_metrics->lanes()), m_enqueued);
+            return m_func();
+        }
+
+    private:
+        const TaskGroup* m_group;
+        TaskMetrics*     m_metrics;
+        int64_t          m_enqueued;
+        Function         m_func;
+    };
+
+    template<typename Function>
+    MeasuredTask<Function> measured(const Function& func) {
+        return MeasuredTask<Function>(this, m_metrics.get(), func);
+    }
 
 private:
-    pplx::cancellation_token_source m_cts;
-    std::vector<pplx::task<void>>   m_tasks;
-    std::mutex                      m_mutex;
-    std::condition_variable         m_cv;
-    int                             m_succeeded;
-    
+    friend class TaskGraph;
+
+    void init();
+    // a task is counted by the group and its parents, e.g. a pplx task or a run of a TaskGraph
+    void addTask();
+    void endTask(CompletionLatch::Outcome outcome);
+
+    // the state of a parallel_for(), on the stack of the caller which waits for the chunks
+    template<typename Index, typename Function>
+    struct ParallelLoop {
+        ParallelLoop(const Function& func, Index first, Index last, Index grain, const std::atomic<bool>& canceled):
+        m_func(func),
+        m_last(last),
+        m_grain(grain),
+        m_canceled(canceled),
+        m_stopped(false),
+        m_cursor(first) {
+        }
+
+        // run [begin, end) by chunks of 'grain', return false if the loop has been stopped
+        bool runRange(Index begin, Index end) {
+            while (begin < end) {
+                if (m_stopped.load(std::memory_order_relaxed) || m_canceled.load(std::memory_order_relaxed)) {
+                    return false;
+                }
+                Index chunk_end = end - begin > m_grain ? begin + m_grain : end;
+                for (Index i = begin; i < chunk_end; ++i) {
+                    m_func(i);
+                }
+                begin = chunk_end;
+            }
+            return true;
+        }
+
+        void fail(std::exception_ptr error) {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            if (!m_error) {
+                m_error = error;
+            }
+            m_stopped = true;
+        }
+
+        const Function&          m_func;
+        Index                    m_last;
+        Index                    m_grain;
+        const std::atomic<bool>& m_canceled;
+        std::atomic<bool>        m_stopped;
+        // the next iteration of a Guided loop
+        std::atomic<Index>       m_cursor;
+        CompletionLatch          m_latch;
+        std::mutex               m_mutex;
+        std::exception_ptr       m_error;
+    };
+
+    // a task running body(), which returns false when the loop has been stopped
+    template<typename Loop, typename Body>
+    void pushLoopTask(Loop& loop, const Body& body);
+    template<typename Loop, typename Index>
+    bool runGuided(Loop& loop, size_t workers);
+    // 'splits' halves may still be split off, a stolen range gets more of them, up to 'max_level'
+    template<typename Loop, typename Index>
+    bool runAdaptive(Loop& loop, Index begin, Index end, int level, int splits, int max_level, std::thread::id owner);
+
+    std::shared_ptr<pplx::scheduler_interface> m_scheduler;
+    TaskGroup*                                 m_parent;
+    pplx::cancellation_token_source            m_cts;
+    // set by a callback of the token, the token itself costs a reference count per check
+    std::atomic<bool>                          m_canceled;
+    pplx::cancellation_token_registration      m_registration;
+    std::mutex                                 m_deadline_mutex;
+    DeadlineTimer::Id                          m_deadline;
+    CompletionLatch                            m_latch;
+    WorkStealingScheduler*                     m_workers;
+    std::unique_ptr<TaskMetrics>               m_metrics;
 };
+
+//////////////////////
+template<typename Index, typename Function>
+bool TaskGroup::parallel_for(Index first, Index last, const Function& func, Partition partition, Index grain) {
+    if (!(first < last)) {
+        return true;
+    }
+    if (grain < 1) {
+        grain = 1;
+    }
+    typedef ParallelLoop<Index, Function> Loop;
+    Loop loop(func, first, last, grain, m_canceled);
+    size_t workers = concurrency();
+
+    switch (partition) {
+    case Partition::Static: {
+        Index block = (Index)((last - first + workers - 1) / workers);
+        if (block < grain) {
+            block = grain;
+        }
+        for (Index begin = first; begin < last; ) {
+            Index end = last - begin > block ? begin + block : last;
+            pushLoopTask(loop, [&loop, begin, end]() {
+                return loop.runRange(begin, end);
+            });
+            begin = end;
+        }
+        break;
+    }
+    case Partition::Guided: {
+        size_t tasks = std::min<size_t>(workers, (size_t)((last - first + grain - 1) / grain));
+        for (size_t i = 0; i < tasks; ++i) {
+            pushLoopTask(loop, [this, &loop, workers]() {
+                return runGuided<Loop, Index>(loop, workers);
+            });
+        }
+        break;
+    }
+    case Partition::Adaptive: {
+        // about two ranges per worker, up to 64 per worker once stolen
+        int splits = 1;
+        while (((size_t)1 << (splits - 1)) < workers) {
+            ++splits;
+        }
+        int max_level = splits + 5;
+        pushLoopTask(loop, [this, &loop, first, last, splits, max_level]() {
+            return runAdaptive<Loop, Index>(loop, first, last, 0, splits, max_level, std::thread::id());
+        });
+        break;
+    }
+    }
+    waitFor(loop.m_latch);
+
+    if (loop.m_error) {
+        std::rethrow_exception(loop.m_error);
+    }
+    return loop.m_latch.canceled() == 0;
+}
+
+template<typename Iterator, typename Function>
+bool TaskGroup::parallel_for_each(Iterator first, Iterator last, const Function& func, Partition partition, size_t grain) {
+    return parallel_for((size_t)0, (size_t)std::distance(first, last), [first, &func](size_t i) {
+        func(first[i]);
+    }, partition, grain);
+}
+
+template<typename Loop, typename Body>
+void TaskGroup::pushLoopTask(Loop& loop, const Body& body) {
+    pushTask(pplx::create_task(measured([&loop, body]() {
+        bool completed = false;
+        try {
+            completed = body();
+        } catch (const pplx::task_canceled&) {
+            throw;
+        } catch (...) {
+            loop.fail(std::current_exception());
+            throw;
+        }
+        if (!completed) {
+            pplx::cancel_current_task();
+        }
+    }), taskOptions()), &loop.m_latch);
+}
+
+template<typename Loop, typename Index>
+bool TaskGroup::runGuided(Loop& loop, size_t workers) {
+    while (true) {
+        Index begin = loop.m_cursor.load(std::memory_order_relaxed);
+        Index end;
+        do {
+            if (!(begin < loop.m_last)) {
+                return true;
+            }
+            Index chunk = (Index)((loop.m_last - begin) / (2 * workers));
+            if (chunk < loop.m_grain) {
+                chunk = loop.m_grain;
+            }
+            end = loop.m_last - begin > chunk ? begin + chunk : loop.m_last;
+        } while (!loop.m_cursor.compare_exchange_weak(begin, end, std::memory_order_relaxed));
+        if (!loop.runRange(begin, end)) {
+            return false;
+        }
+    }
+}
+
+template<typename Loop, typename Index>
+bool TaskGroup::runAdaptive(Loop& loop, Index begin, Index end, int level, int splits, int max_level, std::thread::id owner) {
+    std::thread::id self = std::this_thread::get_id();
+    if (owner != std::thread::id() && owner != self) {
+        // an idle thread took the range: the load is unbalanced, split it further
+        splits += 2;
+    }
+    while (end - begin > loop.m_grain && splits > 0 && level < max_level) {
+        Index middle = begin + (end - begin) / 2;
+        --splits;
+        ++level;
+        pushLoopTask(loop, [this, &loop, middle, end, level, splits, max_level, self]() {
+            return runAdaptive<Loop, Index>(loop, middle, end, level, splits, max_level, self);
+        });
+        end = middle;
+    }
+    return loop.runRange(begin, end);
+}
 #endif // __TASK_GROUP_H__
\ No newline at end of file
@@ -0,0 +1,114 @@
+#ifndef __TASK_METRICS_H__
+#define __TASK_METRICS_H__
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "PaddedArray.h"
+
+// Lock-free metrics of the tasks of a group. Every lane (a worker of a WorkStealingScheduler,
+// otherwise a hash of the thread) has its own padded counters and histograms, snapshot() merges them.
+// All the tasks are counted, the latencies are measured on one task out of 'sample_every':
+// a clock read costs more than the rest of the bookkeeping. 'sample_every' is rounded up to a power of two,
+// the sampled tasks are selected with a mask rather than a division.
+class TaskMetrics {
+private:
+    struct Lane;
+
+public:
+    // bucket i counts the durations in [2^i, 2^(i+1)) ns, the last one everything above
+    static const int BUCKETS = 40;
+
+    struct Snapshot {
+        int64_t             enqueued;
+        // enqueued, not started yet: pending tasks of the group minus the running ones
+        int64_t             queued;
+        int64_t             running;
+        int64_t             completed;
+        int64_t             sampled;
+        // enqueue -> start and run time of the sampled tasks
+        int64_t             wait_ns[BUCKETS];
+        int64_t             run_ns[BUCKETS];
+        int64_t             total_wait_ns;
+        int64_t             total_run_ns;
+        int64_t             elapsed_ns;
+        // estimated busy fraction of every lane, and of all of them
+        std::vector<double> lane_utilization;
+        double              utilization;
+
+        // upper bound of the bucket holding the 'p' percentile (0 < p <= 1), 0 if no task was sampled
+        static int64_t percentile(const int64_t* histogram, double p);
+        std::string toString() const;
+    };
+
+    TaskMetrics(size_t lanes, unsigned int sample_every);
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // on the enqueuing thread: the enqueue time of a sampled task, 0 otherwise
+    int64_t enqueue() {
+        int64_t n = m_enqueued.fetch_add(1, std::memory_order_relaxed);
+        return (n & m_sample_mask) == 0 ? now() : 0;
+    }
+
+    // on the running thread, from the start to the end of the task
+    class Scope {
+    public:
+        Scope(TaskMetrics& metrics, size_t lane, int64_t enqueued):
+        m_lane(metrics.m_lanes[lane]),
+        m_enqueued(enqueued),
+        m_started(enqueued ? now() : 0) {
+            m_lane.m_started.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        ~Scope() {
+            if (m_enqueued) {
+                m_lane.sample(m_started - m_enqueued, now() - m_started);
+            }
+            m_lane.m_completed.fetch_add(1, std::memory_order_relaxed);
+        }
+
+    private:
+        Scope(const Scope&);
+        Scope& operator=(const Scope&);
+
+        Lane&   m_lane;
+        int64_t m_enqueued;
+        int64_t m_started;
+    };
+
+    size_t lanes() const {
+        return m_lanes.size();
+    }
+    // 'pending' tasks of the group, for the queue depth
+    Snapshot snapshot(int64_t pending) const;
+
+private:
+    struct Lane {
+        explicit Lane(int64_t zero);
+        void sample(int64_t wait_ns, int64_t run_ns);
+
+        std::atomic<int64_t> m_started;
+        std::atomic<int64_t> m_completed;
+        std::atomic<int64_t> m_sampled;
+        std::atomic<int64_t> m_total_wait_ns;
+        std::atomic<int64_t> m_total_run_ns;
+        std::atomic<int64_t> m_wait_ns[BUCKETS];
+        std::atomic<int64_t> m_run_ns[BUCKETS];
+    };
+
+    static int bucket(int64_t ns);
+
+    std::atomic<int64_t>  m_enqueued;
+    int64_t               m_sample_every;
+    int64_t               m_sample_mask;
+    int64_t               m_since;
+    PaddedArray<Lane>     m_lanes;
+};
+#endif // __TASK_METRICS_H__
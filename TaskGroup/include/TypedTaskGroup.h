@@ -0,0 +1,124 @@
+#ifndef __TYPED_TASK_GROUP_H__
+#define __TYPED_TASK_GROUP_H__
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <iterator>
+#include <exception>
+#include <stdexcept>
+#include <functional>
+
+#include "TaskGroup.h"
+#include "PaddedArray.h"
+
+// A TaskGroup whose tasks return a value of type R.
+// run() stores the result of every task in its own slot of a preallocated PaddedArray.
+// map_reduce() and reduce() combine the results as the tasks end, into one partial result per lane
+// (a worker of a WorkStealingScheduler, otherwise a hash of the thread), so the intermediate results
+// are never stored: combine(R, R) must be associative and commutative.
+template<typename R>
+class TypedTaskGroup : public TaskGroup {
+public:
+    // 'capacity' results are preallocated, R must be default constructible
+    explicit TypedTaskGroup(size_t capacity, std::shared_ptr<pplx::scheduler_interface> scheduler = nullptr):
+    TaskGroup(scheduler),
+    m_results(capacity, R()),
+    m_size(0),
+    m_lanes_nb(concurrency()) {
+    }
+
+    // the tasks write to the results: they must end before the results are destroyed
+    ~TypedTaskGroup() {
+        terminate();
+    }
+
+    // return the slot of the result, throw std::length_error once 'capacity' tasks have been run
+    template<typename Function>
+    size_t run(const Function& func) {
+        size_t index = m_size.fetch_add(1);
+        if (index >= m_results.size()) {
+            throw std::length_error("TypedTaskGroup: the results are full");
+        }
+        PaddedArray<R>* results = &m_results;
+        pushTask(pplx::create_task(measured([results, index, func]() {
+            (*results)[index] = func();
+        }), taskOptions()));
+        return index;
+    }
+
+    // valid once its task has succeeded, e.g. after wait(), otherwise R()
+    const R& result(size_t index) const {
+        return m_results[index];
+    }
+
+    // number of results
+    size_t size() const {
+        return std::min(m_size.load(), m_results.size());
+    }
+
+    // run map(i) for every i in [0, count) and fold the results into 'identity'. It blocks until the tasks have ended,
+    // then rethrows the first exception of 'map', or pplx::task_canceled if the group has been canceled.
+    // A task of the group may call it: a waiting worker of a WorkStealingScheduler runs the pending tasks.
+    template<typename Map, typename Combine>
+    R map_reduce(size_t count, const Map& map, const R& identity, const Combine& combine) {
+        PaddedArray<Lane> lanes(m_lanes_nb, identity);
+        CompletionLatch latch;
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        for (size_t i = 0; i < count; ++i) {
+            pushTask(pplx::create_task(measured([this, i, &map, &combine, &lanes, &error, &error_mutex]() {
+                try {
+                    R value = map(i);
+                    Lane& lane = lanes[laneIndex(m_lanes_nb)];
+                    std::lock_guard<std::mutex> lk(lane.m_mutex);
+                    lane.m_partial = combine(lane.m_partial, value);
+                } catch (const pplx::task_canceled&) {
+                    throw;
+                } catch (...) {
+                    std::lock_guard<std::mutex> lk(error_mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    throw;
+                }
+            }), taskOptions()), &latch);
+        }
+        waitFor(latch);
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        if (latch.canceled() > 0) {
+            throw pplx::task_canceled();
+        }
+        R result = identity;
+        for (size_t i = 0; i < lanes.size(); ++i) {
+            result = combine(result, lanes[i].m_partial);
+        }
+        return result;
+    }
+
+    // fold the results of the callables in [first, last), a random access range
+    template<typename Iterator, typename Combine>
+    R reduce(Iterator first, Iterator last, const R& identity, const Combine& combine) {
+        return map_reduce((size_t)std::distance(first, last), [first](size_t i) {
+            return first[i]();
+        }, identity, combine);
+    }
+
+private:
+    struct Lane {
+        explicit Lane(const R& identity): m_partial(identity) {
+        }
+        std::mutex m_mutex;
+        R          m_partial;
+    };
+
+    PaddedArray<R>         m_results;
+    std::atomic<size_t>    m_size;
+    size_t                 m_lanes_nb;
+};
+#endif // __TYPED_TASK_GROUP_H__
@@ -0,0 +1,99 @@
+#ifndef __WORK_STEALING_SCHEDULER_H__
+#define __WORK_STEALING_SCHEDULER_H__
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+
+#include "pplx/pplxtasks.h"
+
+// A pplx scheduler backed by a fixed pool of workers, tuned for many short tasks.
+// Every worker owns a deque: the tasks scheduled from a worker are pushed to its own
+// deque and popped LIFO (the most recent one is hot in cache), idle workers steal the
+// oldest tasks of the others FIFO. The tasks scheduled from other threads go to a
+// shared injection queue. Scheduling does not allocate once the deques have grown.
+class WorkStealingScheduler : public pplx::scheduler_interface {
+public:
+    explicit WorkStealingScheduler(unsigned int num_workers = std::thread::hardware_concurrency());
+    // the tasks already scheduled are run before the workers are joined
+    ~WorkStealingScheduler();
+
+    virtual void schedule(pplx::TaskProc_t proc, void* param);
+
+    unsigned int getNumWorkers() const;
+    // index of the calling worker of this scheduler, -1 from any other thread
+    int currentWorker() const;
+    // on a worker of this scheduler: run the pending tasks until done() returns true, instead of
+    // blocking the worker while the tasks it waits for are queued behind it.
+    // Return false at once from any other thread, or if a task has destroyed the scheduler
+    bool runUntil(const std::function<bool()>& done);
+
+private:
+    struct Item {
+        pplx::TaskProc_t proc;
+        void*            param;
+    };
+
+    // Chase-Lev deque: push and pop by its owner only, steal by any thread
+    class WorkDeque {
+    public:
+        WorkDeque();
+        ~WorkDeque();
+
+        void push(const Item& item);
+        bool pop(Item& item);
+        bool steal(Item& item);
+        bool empty() const;
+
+    private:
+        // the slots are atomics because a thief may read one the owner is overwriting,
+        // the item is only used if the steal wins the race
+        struct Slot {
+            std::atomic<pplx::TaskProc_t> proc;
+            std::atomic<void*>            param;
+        };
+        struct Buffer {
+            explicit Buffer(int64_t capacity);
+            int64_t                  m_capacity;
+            std::unique_ptr<Slot[]>  m_slots;
+            void put(int64_t i, const Item& item);
+            Item get(int64_t i) const;
+        };
+
+        Buffer* grow(Buffer* buffer, int64_t bottom, int64_t top);
+
+        // top (thieves) and bottom (owner) are padded to their own cache line
+        std::atomic<int64_t>                 m_top;
+        char                                 m_pad_top[64 - sizeof(std::atomic<int64_t>)];
+        std::atomic<int64_t>                 m_bottom;
+        char                                 m_pad_bottom[64 - sizeof(std::atomic<int64_t>)];
+        std::atomic<Buffer*>                 m_buffer;
+        // the buffers replaced by a grow may still be read by a thief, they are freed with the deque
+        std::vector<std::unique_ptr<Buffer>> m_buffers;
+    };
+
+    struct Worker {
+        WorkDeque   m_deque;
+        std::thread m_thread;
+    };
+
+    void run(unsigned int index);
+    bool findWork(unsigned int index, Item& item);
+    bool hasWork() const;
+    void wakeUp();
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::deque<Item>                     m_injected;
+    std::atomic<size_t>                  m_injected_size;
+    std::mutex                           m_mutex;
+    std::condition_variable              m_cv;
+    std::atomic<int>                     m_sleeping;
+    std::atomic<bool>                    m_stop;
+};
+#endif // __WORK_STEALING_SCHEDULER_H__
@@ -0,0 +1,88 @@
+#include <chrono>
+
+#include "../include/CompletionLatch.h"
+
+CompletionLatch::CompletionLatch():
+m_total(0),
+m_pending(0),
+m_succeeded(0),
+m_failed(0),
+m_canceled(0) {
+}
+
+void CompletionLatch::add(int64_t count) {
+    m_total.fetch_add(count, std::memory_order_relaxed);
+    m_pending.fetch_add(count, std::memory_order_relaxed);
+}
+
+void CompletionLatch::countDown(Outcome outcome) {
+    switch (outcome) {
+    case Succeeded:
+        m_succeeded.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case Failed:
+        m_failed.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case Canceled:
+        m_canceled.fetch_add(1, std::memory_order_relaxed);
+        break;
+    }
+
+    int64_t pending = m_pending.load(std::memory_order_relaxed);
+    while (true) {
+        if (pending == 1) {
+            // probably the last one: releasing the latch under the mutex, a waiter can neither miss
+            // the notification nor destroy the latch before it is over
+            std::lock_guard<std::mutex> lk(m_mutex);
+            if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                m_cv.notify_all();
+            }
+            return;
+        }
+        if (m_pending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+bool CompletionLatch::wait(int millis) {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    return m_cv.wait_for(lk, std::chrono::milliseconds(millis), [this]() {
+        return m_pending.load(std::memory_order_acquire) == 0;
+    });
+}
+
+void CompletionLatch::wait() {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    m_cv.wait(lk, [this]() {
+        return m_pending.load(std::memory_order_acquire) == 0;
+    });
+}
+
+void CompletionLatch::reset() {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_total = 0;
+    m_succeeded = 0;
+    m_failed = 0;
+    m_canceled = 0;
+}
+
+int64_t CompletionLatch::pending() const {
+    return m_pending.load(std::memory_order_acquire);
+}
+
+int64_t CompletionLatch::total() const {
+    return m_total.load(std::memory_order_relaxed);
+}
+
+int64_t CompletionLatch::succeeded() const {
+    return m_succeeded.load(std::memory_order_relaxed);
+}
+
+int64_t CompletionLatch::failed() const {
+    return m_failed.load(std::memory_order_relaxed);
+}
+
+int64_t CompletionLatch::canceled() const {
+    return m_canceled.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,82 @@
+#include "../include/DeadlineTimer.h"
+
+DeadlineTimer& DeadlineTimer::instance() {
+    static DeadlineTimer timer;
+    return timer;
+}
+
+DeadlineTimer::DeadlineTimer():
+m_next_id(1),
+m_running(0),
+m_stop(false) {
+    m_thread = std::thread(&DeadlineTimer::run, this);
+}
+
+DeadlineTimer::~DeadlineTimer() {
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+}
+
+DeadlineTimer::Id DeadlineTimer::add(Clock::time_point deadline, const std::function<void()>& callback) {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    Id id = m_next_id++;
+    Entry entry = {deadline, callback};
+    m_entries[id] = entry;
+    m_deadlines.insert(std::make_pair(deadline, id));
+    // the timer thread may sleep until a later deadline
+    if (m_deadlines.begin()->second == id) {
+        m_cv.notify_all();
+    }
+    return id;
+}
+
+void DeadlineTimer::remove(Id id) {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    auto it = m_entries.find(id);
+    if (it != m_entries.end()) {
+        m_deadlines.erase(std::make_pair(it->second.m_deadline, id));
+        m_entries.erase(it);
+        return;
+    }
+    if (std::this_thread::get_id() != m_thread.get_id()) {
+        m_cv.wait(lk, [this, id]() {
+            return m_running != id;
+        });
+    }
+}
+
+size_t DeadlineTimer::size() {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    return m_entries.size();
+}
+
+void DeadlineTimer::run() {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    while (!m_stop) {
+        if (m_deadlines.empty()) {
+            m_cv.wait(lk);
+            continue;
+        }
+        Clock::time_point deadline = m_deadlines.begin()->first;
+        if (Clock::now() < deadline) {
+            m_cv.wait_until(lk, deadline);
+            continue;
+        }
+        Id id = m_deadlines.begin()->second;
+        m_deadlines.erase(m_deadlines.begin());
+        std::function<void()> callback;
+        callback.swap(m_entries[id].m_callback);
+        m_entries.erase(id);
+        m_running = id;
+        lk.unlock();
+        callback();
+        lk.lock();
+        m_running = 0;
+        // a remove() may be waiting for the end of the callback
+        m_cv.notify_all();
+    }
+}
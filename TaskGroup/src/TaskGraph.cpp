@@ -0,0 +1,160 @@
+#include <stdexcept>
+
+#include "../include/TaskGraph.h"
+
+TaskGraph::TaskGraph(TaskGroup& group):
+m_group(group),
+m_prepared(false),
+m_stopped(false) {
+}
+
+TaskGraph::~TaskGraph() {
+}
+
+size_t TaskGraph::add(const std::function<void()>& func, const std::vector<size_t>& dependencies) {
+    std::unique_ptr<Node> node(new Node());
+    node->m_graph = this;
+    node->m_func = func;
+    node->m_dependencies = 0;
+    node->m_pending = 0;
+    node->m_enqueued = 0;
+    m_nodes.push_back(std::move(node));
+    size_t id = m_nodes.size() - 1;
+    for (size_t dependency : dependencies) {
+        precede(dependency, id);
+    }
+    m_prepared = false;
+    return id;
+}
+
+void TaskGraph::precede(size_t before, size_t after) {
+    if (before >= m_nodes.size() || after >= m_nodes.size()) {
+        throw std::out_of_range("TaskGraph: unknown node");
+    }
+    m_nodes[before]->m_successors.push_back(m_nodes[after].get());
+    m_nodes[after]->m_dependencies++;
+    m_prepared = false;
+}
+
+size_t TaskGraph::size() const {
+    return m_nodes.size();
+}
+
+void TaskGraph::prepare() {
+    m_roots.clear();
+    // Kahn's algorithm: every node is reached once all its dependencies are
+    std::vector<Node*> ready;
+    for (auto& node : m_nodes) {
+        node->m_pending = node->m_dependencies;
+        if (node->m_dependencies == 0) {
+            m_roots.push_back(node.get());
+            ready.push_back(node.get());
+        }
+    }
+    size_t reached = 0;
+    while (!ready.empty()) {
+        Node* node = ready.back();
+        ready.pop_back();
+        ++reached;
+        for (Node* successor : node->m_successors) {
+            if (--successor->m_pending == 0) {
+                ready.push_back(successor);
+            }
+        }
+    }
+    if (reached != m_nodes.size()) {
+        throw std::logic_error("TaskGraph: the graph has a cycle");
+    }
+    m_prepared = true;
+}
+
+bool TaskGraph::run() {
+    if (m_nodes.empty()) {
+        return true;
+    }
+    if (!m_prepared) {
+        prepare();
+    }
+    for (auto& node : m_nodes) {
+        node->m_pending.store(node->m_dependencies, std::memory_order_relaxed);
+    }
+    m_stopped = false;
+    m_error = nullptr;
+    m_latch.reset();
+    m_latch.add((int64_t)m_nodes.size());
+
+    // the run is a task of the group: its waits see it, and a terminate() skips its nodes
+    m_group.addTask();
+    const std::shared_ptr<pplx::scheduler_interface>& scheduler = m_group.getScheduler();
+    for (Node* root : m_roots) {
+        root->m_enqueued = enqueue();
+        scheduler->schedule(&TaskGraph::runNode, root);
+    }
+    m_group.waitFor(m_latch);
+
+    bool canceled = m_latch.canceled() > 0;
+    CompletionLatch::Outcome outcome = m_error ? CompletionLatch::Failed : canceled ? CompletionLatch::Canceled : CompletionLatch::Succeeded;
+    std::exception_ptr error = m_error;
+    m_group.endTask(outcome);
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return !canceled;
+}
+
+int64_t TaskGraph::enqueue() const {
+    TaskMetrics* metrics = m_group.m_metrics.get();
+    return metrics ? metrics->enqueue() : 0;
+}
+
+void TaskGraph::invoke(Node* node) {
+    TaskMetrics* metrics = m_group.m_metrics.get();
+    if (!metrics) {
+        node->m_func();
+        return;
+    }
+    TaskMetrics::Scope scope(*metrics, m_group.laneIndex(metrics->lanes()), node->m_enqueued);
+    node->m_func();
+}
+
+void TaskGraph::runNode(void* param) {
+    Node* node = static_cast<Node*>(param);
+    node->m_graph->execute(node);
+}
+
+void TaskGraph::execute(Node* node) {
+    while (node) {
+        // a skipped node still releases its successors, so that the run ends
+        CompletionLatch::Outcome outcome = CompletionLatch::Canceled;
+        if (!m_stopped.load(std::memory_order_relaxed) && !m_group.isCanceled()) {
+            try {
+                invoke(node);
+                outcome = CompletionLatch::Succeeded;
+            } catch (const pplx::task_canceled&) {
+            } catch (...) {
+                std::lock_guard<std::mutex> lk(m_error_mutex);
+                if (!m_error) {
+                    m_error = std::current_exception();
+                }
+                m_stopped = true;
+                outcome = CompletionLatch::Failed;
+            }
+        }
+        // the last ready successor runs inline, the others are scheduled
+        Node* next = nullptr;
+        const std::shared_ptr<pplx::scheduler_interface>& scheduler = m_group.getScheduler();
+        for (Node* successor : node->m_successors) {
+            if (successor->m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                successor->m_enqueued = enqueue();
+                if (next) {
+                    scheduler->schedule(&TaskGraph::runNode, next);
+                }
+                next = successor;
+            }
+        }
+        // the latch may release run() and the graph with it: nothing is touched afterwards but 'next'
+        m_latch.countDown(outcome);
+        node = next;
+    }
+}
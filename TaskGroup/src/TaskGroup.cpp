@@ -1,63 +1,203 @@
 #include <chrono> 
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
 
 #include "../include/TaskGroup.h"
+#include "../include/WorkStealingScheduler.h"
 #include "../include/utils.h"
 
+namespace {
+    pplx::cancellation_token_source linkedSource(const pplx::cancellation_token_source& parent) {
+        pplx::cancellation_token token = parent.get_token();
+        return pplx::cancellation_token_source::create_linked_source(token);
+    }
+}
 
-TaskGroup::TaskGroup():
-m_succeeded(0) {
+TaskGroup::TaskGroup(std::shared_ptr<pplx::scheduler_interface> scheduler):
+m_scheduler(scheduler ? scheduler : pplx::get_ambient_scheduler()),
+m_parent(nullptr),
+m_canceled(false),
+m_deadline(0),
+m_workers(dynamic_cast<WorkStealingScheduler*>(m_scheduler.get())) {
     LOGGER << "constructor";
+    init();
+}
+
+TaskGroup::TaskGroup(TaskGroup& parent):
+m_scheduler(parent.m_scheduler),
+m_parent(&parent),
+m_cts(linkedSource(parent.m_cts)),
+m_canceled(false),
+m_deadline(0),
+m_workers(parent.m_workers) {
+    LOGGER << "child constructor";
+    init();
 }
 
 TaskGroup::~TaskGroup() {
     LOGGER << "destructor";
+    {
+        std::lock_guard<std::mutex> lk(m_deadline_mutex);
+        if (m_deadline) {
+            DeadlineTimer::instance().remove(m_deadline);
+        }
+    }
     terminate();
+    // waits for the callback if another thread is canceling the token
+    m_cts.get_token().deregister_callback(m_registration);
+}
+
+void TaskGroup::init() {
+    // run at once if the parent is already canceled
+    m_registration = m_cts.get_token().register_callback([this]() {
+        m_canceled.store(true, std::memory_order_relaxed);
+    });
 }
 
 void TaskGroup::pushTask(pplx::task<void>&& task) {
-    std::lock_guard<std::mutex> lk(m_mutex);
-    m_tasks.push_back(task.then([this] () {
-        LOGGER << "task terminated";
-        {
-            std::lock_guard<std::mutex> lk(m_mutex);
-            this->m_succeeded++;
+    pushTask(std::move(task), nullptr);
+}
+
+void TaskGroup::pushTask(pplx::task<void>&& task, CompletionLatch* latch) {
+    addTask();
+    if (latch) {
+        latch->add();
+    }
+    // the continuation runs on the group's scheduler too, without a log line: it would dominate a short task
+    task.then([this, latch] (pplx::task<void> ended) {
+        CompletionLatch::Outcome outcome = CompletionLatch::Succeeded;
+        try {
+            ended.get();
+        } catch (const pplx::task_canceled&) {
+            outcome = CompletionLatch::Canceled;
+        } catch (...) {
+            outcome = CompletionLatch::Failed;
         }
-        this->m_cv.notify_one();
-    }));
+        // the group outlives 'latch': terminate() waits for its own latch,
+        // and a parent outlives its children
+        if (latch) {
+            latch->countDown(outcome);
+        }
+        endTask(outcome);
+    }, pplx::task_options(m_scheduler));
+}
+
+void TaskGroup::waitFor(CompletionLatch& latch) {
+    if (m_workers) {
+        m_workers->runUntil([&latch]() {
+            return latch.pending() == 0;
+        });
+    }
+    // at once if the worker has seen the latch released: it returns once the last countDown() is over
+    latch.wait();
+}
+
+void TaskGroup::addTask() {
+    for (TaskGroup* group = this; group; group = group->m_parent) {
+        group->m_latch.add();
+    }
+}
+
+void TaskGroup::endTask(CompletionLatch::Outcome outcome) {
+    TaskGroup* group = this;
+    while (group) {
+        TaskGroup* parent = group->m_parent;
+        group->m_latch.countDown(outcome);
+        group = parent;
+    }
+}
+
+pplx::task_options TaskGroup::taskOptions() {
+    pplx::task_options options(m_scheduler);
+    options.set_cancellation_token(m_cts.get_token());
+    return options;
+}
+
+size_t TaskGroup::concurrency() {
+    return m_workers ? m_workers->getNumWorkers() : std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+size_t TaskGroup::laneIndex(size_t lanes) const {
+    int worker = m_workers ? m_workers->currentWorker() : -1;
+    if (worker >= 0) {
+        return (size_t)worker % lanes;
+    }
+    return std::hash<std::thread::id>()(std::this_thread::get_id()) % lanes;
 }
 
 bool TaskGroup::wait(int millis) {
     LOGGER << "waiting for " << millis << " ms";
-    std::unique_lock<std::mutex> lk(m_mutex);
-    auto all_tasks = pplx::when_all(begin(m_tasks), end(m_tasks));
-    m_cv.wait_for(lk, std::chrono::milliseconds(millis), [&all_tasks]() {
-        LOGGER << "is done? " << all_tasks.is_done();
-        return all_tasks.is_done();
-    });
-    // to remove
-    LOGGER << "waiting result: " << all_tasks.is_done() <<
-    ", succeeded: " << m_succeeded <<
-    ", total: " << m_tasks.size();
-    return all_tasks.is_done();
+    bool done = m_latch.wait(millis);
+    LOGGER << "waiting result: " << done <<
+    ", succeeded: " << m_latch.succeeded() <<
+    ", total: " << m_latch.total();
+    return done;
+}
+
+bool TaskGroup::waitOrCancel(int millis) {
+    if (m_latch.wait(millis)) {
+        return true;
+    }
+    LOGGER << "canceling the tasks still running after " << millis << " ms";
+    cancel();
+    m_latch.wait();
+    return false;
 }
 
 void TaskGroup::terminate() {
     LOGGER << "terminating";
-    std::lock_guard<std::mutex> lk(m_mutex);
     m_cts.cancel();
-    auto all_tasks = pplx::when_all(begin(m_tasks), end(m_tasks));
-    all_tasks.wait();
-    m_tasks.clear();
-    m_succeeded = 0;
+    m_latch.wait();
+    m_latch.reset();
     LOGGER << "terminated";
 }
 
+void TaskGroup::cancel() {
+    m_cts.cancel();
+}
+
+void TaskGroup::setDeadline(DeadlineTimer::Clock::time_point deadline) {
+    std::lock_guard<std::mutex> lk(m_deadline_mutex);
+    if (m_deadline) {
+        DeadlineTimer::instance().remove(m_deadline);
+    }
+    m_deadline = DeadlineTimer::instance().add(deadline, [this]() {
+        cancel();
+    });
+}
+
+void TaskGroup::cancelAfter(int millis) {
+    setDeadline(DeadlineTimer::Clock::now() + std::chrono::milliseconds(millis));
+}
+
 void TaskGroup::getStatus(int &succeeded, int &total) {
-    std::lock_guard<std::mutex> lk(m_mutex);
-    succeeded = m_succeeded;
-    total = (int)m_tasks.size();
+    succeeded = (int)m_latch.succeeded();
+    total = (int)m_latch.total();
+}
+
+void TaskGroup::getStatus(int &succeeded, int &failed, int &canceled, int &total) {
+    succeeded = (int)m_latch.succeeded();
+    failed = (int)m_latch.failed();
+    canceled = (int)m_latch.canceled();
+    total = (int)m_latch.total();
 }
 
 const pplx::cancellation_token_source& TaskGroup::getCts() {
     return m_cts;
-}
\ No newline at end of file
+}
+
+const std::shared_ptr<pplx::scheduler_interface>& TaskGroup::getScheduler() {
+    return m_scheduler;
+}
+
+void TaskGroup::enableMetrics(unsigned int sample_every) {
+    m_metrics.reset(new TaskMetrics(concurrency(), sample_every));
+}
+
+TaskMetrics::Snapshot TaskGroup::getMetrics() {
+    if (!m_metrics) {
+        throw std::logic_error("TaskGroup: the metrics are not enabled");
+    }
+    return m_metrics->snapshot(m_latch.pending());
+}
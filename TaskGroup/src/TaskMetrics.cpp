@@ -0,0 +1,144 @@
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include "../include/TaskMetrics.h"
+
+namespace {
+    int64_t roundUpToPowerOfTwo(unsigned int value) {
+        int64_t power = 1;
+        while (power < value) {
+            power <<= 1;
+        }
+        return power;
+    }
+
+    // "850 ns", "12 us", "3 ms"
+    std::string formatDuration(int64_t ns) {
+        std::ostringstream out;
+        if (ns < 10000) {
+            out << ns << " ns";
+        } else if (ns < 10000000) {
+            out << ns / 1000 << " us";
+        } else {
+            out << ns / 1000000 << " ms";
+        }
+        return out.str();
+    }
+}
+
+TaskMetrics::Lane::Lane(int64_t zero):
+m_started(zero),
+m_completed(zero),
+m_sampled(zero),
+m_total_wait_ns(zero),
+m_total_run_ns(zero) {
+    for (int i = 0; i < BUCKETS; ++i) {
+        m_wait_ns[i] = zero;
+        m_run_ns[i] = zero;
+    }
+}
+
+void TaskMetrics::Lane::sample(int64_t wait_ns, int64_t run_ns) {
+    m_sampled.fetch_add(1, std::memory_order_relaxed);
+    m_total_wait_ns.fetch_add(wait_ns, std::memory_order_relaxed);
+    m_total_run_ns.fetch_add(run_ns, std::memory_order_relaxed);
+    m_wait_ns[bucket(wait_ns)].fetch_add(1, std::memory_order_relaxed);
+    m_run_ns[bucket(run_ns)].fetch_add(1, std::memory_order_relaxed);
+}
+
+TaskMetrics::TaskMetrics(size_t lanes, unsigned int sample_every):
+m_enqueued(0),
+m_sample_every(roundUpToPowerOfTwo(sample_every)),
+m_sample_mask(m_sample_every - 1),
+m_since(now()),
+m_lanes(lanes > 0 ? lanes : 1, (int64_t)0) {
+}
+
+int TaskMetrics::bucket(int64_t ns) {
+    int i = 0;
+    while (ns > 1 && i < BUCKETS - 1) {
+        ns >>= 1;
+        ++i;
+    }
+    return i;
+}
+
+TaskMetrics::Snapshot TaskMetrics::snapshot(int64_t pending) const {
+    Snapshot snapshot;
+    snapshot.enqueued = m_enqueued.load(std::memory_order_relaxed);
+    snapshot.elapsed_ns = std::max<int64_t>(now() - m_since, 1);
+    int64_t started = 0;
+    snapshot.completed = 0;
+    snapshot.sampled = 0;
+    snapshot.total_wait_ns = 0;
+    snapshot.total_run_ns = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        snapshot.wait_ns[i] = 0;
+        snapshot.run_ns[i] = 0;
+    }
+    double busy = 0;
+    for (size_t l = 0; l < m_lanes.size(); ++l) {
+        const Lane& lane = m_lanes[l];
+        // completed before started: a task counted as completed is counted as started too
+        int64_t completed = lane.m_completed.load(std::memory_order_relaxed);
+        snapshot.completed += completed;
+        started += std::max(lane.m_started.load(std::memory_order_relaxed), completed);
+        snapshot.sampled += lane.m_sampled.load(std::memory_order_relaxed);
+        snapshot.total_wait_ns += lane.m_total_wait_ns.load(std::memory_order_relaxed);
+        int64_t run_ns = lane.m_total_run_ns.load(std::memory_order_relaxed);
+        snapshot.total_run_ns += run_ns;
+        for (int i = 0; i < BUCKETS; ++i) {
+            snapshot.wait_ns[i] += lane.m_wait_ns[i].load(std::memory_order_relaxed);
+            snapshot.run_ns[i] += lane.m_run_ns[i].load(std::memory_order_relaxed);
+        }
+        // the sampled run time stands for the run time of 'sample_every' tasks
+        double utilization = std::min(1.0, (double)run_ns * m_sample_every / snapshot.elapsed_ns);
+        snapshot.lane_utilization.push_back(utilization);
+        busy += utilization;
+    }
+    snapshot.running = started - snapshot.completed;
+    snapshot.queued = std::max<int64_t>(pending - snapshot.running, 0);
+    snapshot.utilization = busy / m_lanes.size();
+    return snapshot;
+}
+
+int64_t TaskMetrics::Snapshot::percentile(const int64_t* histogram, double p) {
+    int64_t count = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        count += histogram[i];
+    }
+    if (count == 0) {
+        return 0;
+    }
+    int64_t rank = std::max<int64_t>((int64_t)(p * count + 0.5), 1);
+    int64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += histogram[i];
+        if (seen >= rank) {
+            return (int64_t)1 << (i + 1);
+        }
+    }
+    return (int64_t)1 << BUCKETS;
+}
+
+std::string TaskMetrics::Snapshot::toString() const {
+    std::ostringstream out;
+    out << "tasks: enqueued " << enqueued << ", queued " << queued << ", running " << running <<
+    ", completed " << completed << "\n";
+    if (sampled > 0) {
+        out << "wait: mean " << formatDuration(total_wait_ns / sampled) <<
+        ", p50 < " << formatDuration(percentile(wait_ns, 0.5)) <<
+        ", p99 < " << formatDuration(percentile(wait_ns, 0.99)) << "\n";
+        out << "run: mean " << formatDuration(total_run_ns / sampled) <<
+        ", p50 < " << formatDuration(percentile(run_ns, 0.5)) <<
+        ", p99 < " << formatDuration(percentile(run_ns, 0.99)) <<
+        " (" << sampled << " sampled)\n";
+    }
+    out << "utilization: " << std::fixed << std::setprecision(0) << utilization * 100 << "% [";
+    for (size_t i = 0; i < lane_utilization.size(); ++i) {
+        out << (i > 0 ? " " : "") << lane_utilization[i] * 100 << "%";
+    }
+    out << "] over " << formatDuration(elapsed_ns);
+    return out.str();
+}
@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <chrono>
+
+#include "../include/WorkStealingScheduler.h"
+
+namespace {
+    const int64_t INITIAL_CAPACITY = 1024;
+    const size_t  INJECTED_BATCH = 32;
+    // failed searches of a waiting worker before it sleeps between its searches
+    const int     HELPING_SPINS = 64;
+
+    // the scheduler and the index of the calling worker
+    struct CurrentWorker {
+        const WorkStealingScheduler* scheduler;
+        int                          index;
+    };
+    thread_local CurrentWorker t_current_worker = {nullptr, -1};
+}
+
+WorkStealingScheduler::WorkDeque::Buffer::Buffer(int64_t capacity):
+m_capacity(capacity),
+m_slots(new Slot[capacity]) {
+}
+
+void WorkStealingScheduler::WorkDeque::Buffer::put(int64_t i, const Item& item) {
+    Slot& slot = m_slots[i & (m_capacity - 1)];
+    slot.proc.store(item.proc, std::memory_order_relaxed);
+    slot.param.store(item.param, std::memory_order_relaxed);
+}
+
+WorkStealingScheduler::Item WorkStealingScheduler::WorkDeque::Buffer::get(int64_t i) const {
+    const Slot& slot = m_slots[i & (m_capacity - 1)];
+    Item item = {slot.proc.load(std::memory_order_relaxed), slot.param.load(std::memory_order_relaxed)};
+    return item;
+}
+
+WorkStealingScheduler::WorkDeque::WorkDeque():
+m_top(0),
+m_bottom(0) {
+    m_buffers.emplace_back(new Buffer(INITIAL_CAPACITY));
+    m_buffer.store(m_buffers.back().get(), std::memory_order_relaxed);
+}
+
+WorkStealingScheduler::WorkDeque::~WorkDeque() {
+}
+
+void WorkStealingScheduler::WorkDeque::push(const Item& item) {
+    int64_t b = m_bottom.load(std::memory_order_relaxed);
+    int64_t t = m_top.load(std::memory_order_acquire);
+    Buffer* buffer = m_buffer.load(std::memory_order_relaxed);
+    if (b - t >= buffer->m_capacity) {
+        buffer = grow(buffer, b, t);
+    }
+    buffer->put(b, item);
+    m_bottom.store(b + 1, std::memory_order_release);
+}
+
+bool WorkStealingScheduler::WorkDeque::pop(Item& item) {
+    int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+    Buffer* buffer = m_buffer.load(std::memory_order_relaxed);
+    m_bottom.store(b, std::memory_order_release);
+    // the thieves must see the reservation before the owner reads top
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = m_top.load(std::memory_order_relaxed);
+    if (t > b) {
+        // empty
+        m_bottom.store(b + 1, std::memory_order_release);
+        return false;
+    }
+    item = buffer->get(b);
+    if (t == b) {
+        // the last item, a thief may be taking it
+        bool won = m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        m_bottom.store(b + 1, std::memory_order_release);
+        return won;
+    }
+    return true;
+}
+
+bool WorkStealingScheduler::WorkDeque::steal(Item& item) {
+    int64_t t = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = m_bottom.load(std::memory_order_acquire);
+    if (t >= b) {
+        return false;
+    }
+    Buffer* buffer = m_buffer.load(std::memory_order_acquire);
+    item = buffer->get(t);
+    // lost to the owner or to another thief
+    return m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+bool WorkStealingScheduler::WorkDeque::empty() const {
+    return m_bottom.load() <= m_top.load();
+}
+
+WorkStealingScheduler::WorkDeque::Buffer* WorkStealingScheduler::WorkDeque::grow(Buffer* buffer, int64_t bottom, int64_t top) {
+    Buffer* bigger = new Buffer(buffer->m_capacity * 2);
+    for (int64_t i = top; i < bottom; ++i) {
+        bigger->put(i, buffer->get(i));
+    }
+    m_buffers.emplace_back(bigger);
+    m_buffer.store(bigger, std::memory_order_release);
+    return bigger;
+}
+
+//////////////////////
+WorkStealingScheduler::WorkStealingScheduler(unsigned int num_workers):
+m_injected_size(0),
+m_sleeping(0),
+m_stop(false) {
+    num_workers = std::max(num_workers, 1u);
+    for (unsigned int i = 0; i < num_workers; ++i) {
+        m_workers.emplace_back(new Worker());
+    }
+    // all the deques exist before a worker may steal
+    for (unsigned int i = 0; i < num_workers; ++i) {
+        m_workers[i]->m_thread = std::thread(&WorkStealingScheduler::run, this, i);
+    }
+}
+
+WorkStealingScheduler::~WorkStealingScheduler() {
+    {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    // the last reference may be released by a task (e.g. its continuation options): that worker
+    // cannot join itself, it is detached and leaves run() as soon as the task returns
+    int self = currentWorker();
+    if (self >= 0) {
+        t_current_worker.scheduler = nullptr;
+        m_workers[self]->m_thread.detach();
+    }
+    for (auto& worker : m_workers) {
+        if (worker->m_thread.joinable()) {
+            worker->m_thread.join();
+        }
+    }
+}
+
+void WorkStealingScheduler::schedule(pplx::TaskProc_t proc, void* param) {
+    Item item = {proc, param};
+    int index = currentWorker();
+    if (index >= 0) {
+        m_workers[index]->m_deque.push(item);
+        wakeUp();
+        return;
+    }
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_injected.push_back(item);
+    ++m_injected_size;
+    if (m_sleeping > 0) {
+        m_cv.notify_one();
+    }
+}
+
+unsigned int WorkStealingScheduler::getNumWorkers() const {
+    return (unsigned int)m_workers.size();
+}
+
+int WorkStealingScheduler::currentWorker() const {
+    return t_current_worker.scheduler == this ? t_current_worker.index : -1;
+}
+
+bool WorkStealingScheduler::runUntil(const std::function<bool()>& done) {
+    int index = currentWorker();
+    if (index < 0) {
+        return false;
+    }
+    Item item;
+    int spins = 0;
+    while (!done()) {
+        if (findWork((unsigned int)index, item)) {
+            item.proc(item.param);
+            if (t_current_worker.scheduler != this) {
+                // the scheduler has been destroyed by the task
+                return false;
+            }
+            spins = 0;
+            continue;
+        }
+        // the awaited tasks are running on the other workers
+        if (++spins < HELPING_SPINS) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+    return true;
+}
+
+void WorkStealingScheduler::run(unsigned int index) {
+    t_current_worker.scheduler = this;
+    t_current_worker.index = (int)index;
+    Item item;
+    while (true) {
+        if (findWork(index, item)) {
+            item.proc(item.param);
+            if (t_current_worker.scheduler != this) {
+                // the scheduler has been destroyed by the task
+                return;
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lk(m_mutex);
+        // a task pushed before the increment is seen by hasWork(), a later one wakes us up
+        ++m_sleeping;
+        while (!hasWork()) {
+            if (m_stop) {
+                --m_sleeping;
+                return;
+            }
+            m_cv.wait(lk);
+        }
+        --m_sleeping;
+    }
+}
+
+bool WorkStealingScheduler::findWork(unsigned int index, Item& item) {
+    if (m_workers[index]->m_deque.pop(item)) {
+        return true;
+    }
+    if (m_injected_size > 0) {
+        // take a batch to the own deque, the other workers steal from it instead of locking the queue
+        size_t batch = 0;
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            batch = std::min(m_injected.size(), INJECTED_BATCH);
+            if (batch > 0) {
+                item = m_injected.front();
+                for (size_t i = 1; i < batch; ++i) {
+                    m_workers[index]->m_deque.push(m_injected[i]);
+                }
+                m_injected.erase(m_injected.begin(), m_injected.begin() + batch);
+                m_injected_size -= batch;
+            }
+        }
+        if (batch > 1) {
+            wakeUp();
+        }
+        if (batch > 0) {
+            return true;
+        }
+    }
+    size_t num_workers = m_workers.size();
+    for (size_t i = 1; i < num_workers; ++i) {
+        if (m_workers[(index + i) % num_workers]->m_deque.steal(item)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WorkStealingScheduler::hasWork() const {
+    if (m_injected_size > 0) {
+        return true;
+    }
+    for (const auto& worker : m_workers) {
+        if (!worker->m_deque.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingScheduler::wakeUp() {
+    // pairs with the increment of m_sleeping in run(): either the sleeper sees the task or we see the sleeper
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleeping.load() > 0) {
+        std::lock_guard<std::mutex> lk(m_mutex);
+        m_cv.notify_one();
+    }
+}
@@ -3,10 +3,20 @@
 #include <cstdlib>
 #include <chrono>
 #include <thread>
+#include <atomic>
+#include <set>
+#include <cmath>
+#include <vector>
 
 #include "gtest/gtest.h"
 
 #include "../include/TaskGroup.h"
+#include "../include/WorkStealingScheduler.h"
+#include "../include/CompletionLatch.h"
+#include "../include/DeadlineTimer.h"
+#include "../include/TaskMetrics.h"
+#include "../include/TaskGraph.h"
+#include "../include/TypedTaskGroup.h"
 #include "../include/utils.h"
 
 
@@ -111,6 +121,839 @@ TEST(TaskGroup, many_tasks_some_with_others_without_time) {
     EXPECT_EQ(total, NUM_TASKS_OK + NUM_TASKS_KO);
 }
 
+TEST(TaskGroup, work_stealing_scheduler) {
+    auto scheduler = std::make_shared<WorkStealingScheduler>(4);
+    EXPECT_EQ(scheduler->getNumWorkers(), 4u);
+    EXPECT_EQ(scheduler->currentWorker(), -1);
+
+    TaskGroup group(scheduler);
+    int NUM_TASKS = 10000;
+    std::atomic<int> counter(0);
+    std::atomic<int> on_workers(0);
+    for (int i = 0; i < NUM_TASKS; ++i) {
+        group.run([&counter, &on_workers, scheduler]() {
+            ++counter;
+            if (scheduler->currentWorker() >= 0) {
+                ++on_workers;
+            }
+        });
+    }
+    EXPECT_TRUE(group.wait(5000));
+    int suceeded, total;
+    group.getStatus(suceeded, total);
+    EXPECT_EQ(suceeded, NUM_TASKS);
+    EXPECT_EQ(total, NUM_TASKS);
+    EXPECT_EQ(counter, NUM_TASKS);
+    EXPECT_EQ(on_workers, NUM_TASKS);
+}
+
+// recursive fan-out: every task schedules its children on its own deque, the idle workers steal them
+struct FanOut {
+    WorkStealingScheduler* scheduler;
+    std::atomic<int>*      leaves;
+    std::atomic<int>*      pending;
+    std::mutex*            mutex;
+    std::set<std::thread::id>* threads;
+    int                    depth;
+
+    static void run(void* param) {
+        std::unique_ptr<FanOut> node(static_cast<FanOut*>(param));
+        {
+            std::lock_guard<std::mutex> lk(*node->mutex);
+            node->threads->insert(std::this_thread::get_id());
+        }
+        if (node->depth == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            ++*node->leaves;
+        } else {
+            for (int i = 0; i < 2; ++i) {
+                ++*node->pending;
+                FanOut* child = new FanOut(*node);
+                child->depth = node->depth - 1;
+                node->scheduler->schedule(&FanOut::run, child);
+            }
+        }
+        --*node->pending;
+    }
+};
+
+TEST(WorkStealingScheduler, recursive_fan_out) {
+    std::atomic<int> leaves(0);
+    std::atomic<int> pending(1);
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    {
+        WorkStealingScheduler scheduler(4);
+        FanOut* root = new FanOut {&scheduler, &leaves, &pending, &mutex, &threads, 10};
+        scheduler.schedule(&FanOut::run, root);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (pending > 0 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    EXPECT_EQ(pending, 0);
+    EXPECT_EQ(leaves, 1 << 10);
+    // a single task was scheduled from outside, the other workers got their work by stealing
+    EXPECT_EQ(threads.size(), 4u);
+}
+
+TEST(TaskGroup, succeeded_failed_canceled) {
+    TaskGroup group(std::make_shared<WorkStealingScheduler>(2));
+    int NUM_TASKS = 100;
+    for (int i = 0; i < NUM_TASKS; ++i) {
+        group.run([i]() {
+            if (i % 4 == 1) {
+                throw std::runtime_error("failed");
+            }
+            if (i % 4 == 2) {
+                pplx::cancel_current_task();
+            }
+        });
+    }
+    EXPECT_TRUE(group.wait(5000));
+    int suceeded, failed, canceled, total;
+    group.getStatus(suceeded, failed, canceled, total);
+    EXPECT_EQ(suceeded, NUM_TASKS / 2);
+    EXPECT_EQ(failed, NUM_TASKS / 4);
+    EXPECT_EQ(canceled, NUM_TASKS / 4);
+    EXPECT_EQ(total, NUM_TASKS);
+
+    // the tasks created once the group is canceled do not run
+    group.terminate();
+    std::atomic<int> counter(0);
+    group.run([&counter]() {
+        ++counter;
+    });
+    EXPECT_TRUE(group.wait(5000));
+    group.getStatus(suceeded, failed, canceled, total);
+    EXPECT_EQ(counter, 0);
+    EXPECT_EQ(canceled, 1);
+    EXPECT_EQ(total, 1);
+}
+
+TEST(CompletionLatch, many_threads) {
+    int NUM_THREADS = 8;
+    int NUM_TASKS = 100000;
+    CompletionLatch latch;
+    latch.add(NUM_THREADS * NUM_TASKS);
+    EXPECT_FALSE(latch.wait(10));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < NUM_THREADS; ++t) {
+        threads.emplace_back([&latch, NUM_TASKS, t]() {
+            for (int i = 0; i < NUM_TASKS; ++i) {
+                latch.countDown(i % 10 == 0 ? CompletionLatch::Failed : CompletionLatch::Succeeded);
+            }
+        });
+    }
+    EXPECT_TRUE(latch.wait(10000));
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(latch.pending(), 0);
+    EXPECT_EQ(latch.failed(), NUM_THREADS * NUM_TASKS / 10);
+    EXPECT_EQ(latch.succeeded() + latch.failed(), NUM_THREADS * NUM_TASKS);
+    EXPECT_EQ(latch.total(), NUM_THREADS * NUM_TASKS);
+}
+
+TEST(TypedTaskGroup, results) {
+    int NUM_TASKS = 1000;
+    TypedTaskGroup<int64_t> group(NUM_TASKS, std::make_shared<WorkStealingScheduler>(4));
+    for (int i = 0; i < NUM_TASKS; ++i) {
+        EXPECT_EQ(group.run([i]() {
+            return (int64_t)i * i;
+        }), (size_t)i);
+    }
+    EXPECT_THROW(group.run([]() {
+        return (int64_t)0;
+    }), std::length_error);
+    EXPECT_TRUE(group.wait(5000));
+    ASSERT_EQ(group.size(), (size_t)NUM_TASKS);
+    for (int i = 0; i < NUM_TASKS; ++i) {
+        EXPECT_EQ(group.result(i), (int64_t)i * i);
+    }
+}
+
+TEST(TypedTaskGroup, map_reduce) {
+    int NUM_TASKS = 10000;
+    auto square = [](size_t i) {
+        return (int64_t)i * i;
+    };
+    auto sum = [](int64_t a, int64_t b) {
+        return a + b;
+    };
+    int64_t expected = 0;
+    for (int i = 0; i < NUM_TASKS; ++i) {
+        expected += (int64_t)i * i;
+    }
+
+    // with the lanes of the workers, and with the hashed threads of the pplx scheduler
+    TypedTaskGroup<int64_t> group(0, std::make_shared<WorkStealingScheduler>(4));
+    EXPECT_EQ(group.map_reduce(NUM_TASKS, square, 0, sum), expected);
+    TypedTaskGroup<int64_t> ambient_group(0);
+    EXPECT_EQ(ambient_group.map_reduce(NUM_TASKS, square, 0, sum), expected);
+
+    std::vector<std::function<int64_t()>> tasks;
+    for (int i = 1; i <= 10; ++i) {
+        tasks.push_back([i]() {
+            return (int64_t)i;
+        });
+    }
+    EXPECT_EQ(group.reduce(tasks.begin(), tasks.end(), 1, [](int64_t a, int64_t b) {
+        return a * b;
+    }), 3628800);
+
+    // the first exception is rethrown once all the tasks have ended
+    EXPECT_THROW(group.map_reduce(100, [](size_t i) -> int64_t {
+        if (i == 50) {
+            throw std::runtime_error("failed");
+        }
+        return 1;
+    }, 0, sum), std::runtime_error);
+    int suceeded, failed, canceled, total;
+    group.getStatus(suceeded, failed, canceled, total);
+    EXPECT_EQ(failed, 1);
+    EXPECT_EQ(total, NUM_TASKS + 10 + 100);
+}
+
+TEST(TypedTaskGroup, nested_map_reduce) {
+    int NUM_TASKS = 8;
+    int COUNT = 1000;
+    // fewer workers than outer tasks: the waiting workers run the tasks of the inner reductions
+    TypedTaskGroup<int64_t> group(NUM_TASKS, std::make_shared<WorkStealingScheduler>(2));
+    for (int t = 0; t < NUM_TASKS; ++t) {
+        group.run([&group, COUNT]() {
+            return group.map_reduce(COUNT, [](size_t i) {
+                return (int64_t)i;
+            }, 0, [](int64_t a, int64_t b) {
+                return a + b;
+            });
+        });
+    }
+    EXPECT_TRUE(group.wait(10000));
+    for (int t = 0; t < NUM_TASKS; ++t) {
+        EXPECT_EQ(group.result(t), (int64_t)COUNT * (COUNT - 1) / 2);
+    }
+}
+
+TEST(TaskGroup, parallel_for) {
+    int SIZE = 100000;
+    TaskGroup::Partition partitions[] = {
+        TaskGroup::Partition::Static, TaskGroup::Partition::Guided, TaskGroup::Partition::Adaptive
+    };
+    TaskGroup group(std::make_shared<WorkStealingScheduler>(4));
+    TaskGroup ambient_group;
+    for (TaskGroup::Partition partition : partitions) {
+        for (int grain : {1, 7, 1000, 1000000}) {
+            // every iteration runs exactly once
+            std::vector<std::atomic<int>> visits(SIZE);
+            auto visit = [&visits](int i) {
+                ++visits[i];
+            };
+            EXPECT_TRUE(group.parallel_for(0, SIZE, visit, partition, grain));
+            EXPECT_TRUE(ambient_group.parallel_for(0, SIZE, visit, partition, grain));
+            for (int i = 0; i < SIZE; ++i) {
+                ASSERT_EQ(visits[i], 2) << "iteration " << i << ", grain " << grain;
+            }
+        }
+    }
+    EXPECT_TRUE(group.parallel_for(10, 10, [](int) {
+        FAIL();
+    }));
+
+    std::vector<int64_t> values(SIZE, 1);
+    std::atomic<int64_t> sum(0);
+    EXPECT_TRUE(group.parallel_for_each(values.begin(), values.end(), [&sum](int64_t value) {
+        sum += value;
+    }, TaskGroup::Partition::Guided, 64));
+    EXPECT_EQ(sum, SIZE);
+
+    // the first exception is rethrown, the chunks not started yet are skipped
+    EXPECT_THROW(group.parallel_for(0, SIZE, [](int i) {
+        if (i == 500) {
+            throw std::runtime_error("failed");
+        }
+    }, TaskGroup::Partition::Adaptive, 100), std::runtime_error);
+}
+
+TEST(TaskGroup, nested_parallel_for) {
+    int NUM_TASKS = 8;
+    int SIZE = 1000;
+    // fewer workers than outer tasks: the waiting workers run the chunks of the inner loops
+    TaskGroup group(std::make_shared<WorkStealingScheduler>(2));
+    TaskGroup::Partition partitions[] = {
+        TaskGroup::Partition::Static, TaskGroup::Partition::Guided, TaskGroup::Partition::Adaptive
+    };
+    std::atomic<int> count(0);
+    std::atomic<int> completed(0);
+    for (int t = 0; t < NUM_TASKS; ++t) {
+        TaskGroup::Partition partition = partitions[t % 3];
+        group.run([&group, &count, &completed, partition, SIZE]() {
+            if (group.parallel_for(0, SIZE, [&count](int) {
+                ++count;
+            }, partition)) {
+                ++completed;
+            }
+        });
+    }
+    EXPECT_TRUE(group.wait(10000));
+    EXPECT_EQ(completed, NUM_TASKS);
+    EXPECT_EQ(count, NUM_TASKS * SIZE);
+}
+
+TEST(TaskGroup, parallel_for_canceled) {
+    int SIZE = 10000000;
+    TaskGroup group(std::make_shared<WorkStealingScheduler>(4));
+    std::atomic<int> count(0);
+    const pplx::cancellation_token_source& cts = group.getCts();
+    EXPECT_FALSE(group.parallel_for(0, SIZE, [&count, &cts](int) {
+        if (++count == 1000) {
+            cts.cancel();
+        }
+    }, TaskGroup::Partition::Guided, 100));
+    EXPECT_LT(count, SIZE);
+    // a canceled group runs no more chunks
+    EXPECT_FALSE(group.parallel_for(0, 10, [](int) {
+        FAIL();
+    }));
+}
+
+// time from the cancellation to the end of 'NUM_TASKS' tasks checking the group in their inner loop
+void checkTimeToQuiesce(const std::string& name, std::shared_ptr<pplx::scheduler_interface> scheduler) {
+    int NUM_TASKS = 10000;
+    TaskGroup group(scheduler);
+    std::atomic<int> started(0);
+    for (int i = 0; i < NUM_TASKS; ++i) {
+        group.run([&group, &started]() {
+            ++started;
+            while (!group.isCanceled()) {
+                std::this_thread::yield();
+            }
+            pplx::cancel_current_task();
+        });
+    }
+    auto deadline = DeadlineTimer::Clock::now() + std::chrono::milliseconds(100);
+    group.setDeadline(deadline);
+    EXPECT_FALSE(group.wait(50));
+    EXPECT_TRUE(group.wait(10000));
+    auto end = DeadlineTimer::Clock::now();
+    int quiesce = (int)std::chrono::duration_cast<std::chrono::milliseconds>(end - deadline).count();
+    LOGGER << name << " - " << NUM_TASKS << " tasks, " << started << " started, quiesced in " << quiesce << " ms";
+    EXPECT_LT(quiesce, 2000);
+
+    int succeeded, failed, canceled, total;
+    group.getStatus(succeeded, failed, canceled, total);
+    EXPECT_EQ(canceled, NUM_TASKS);
+    EXPECT_EQ(total, NUM_TASKS);
+}
+
+TEST(TaskGroup, deadline) {
+    checkTimeToQuiesce("work-stealing scheduler", std::make_shared<WorkStealingScheduler>(4));
+    checkTimeToQuiesce("pplx ambient scheduler", nullptr);
+
+    // the deadline does not fire once the tasks have ended
+    TaskGroup group;
+    group.cancelAfter(50);
+    group.setDeadline(DeadlineTimer::Clock::now() + std::chrono::milliseconds(5000));
+    group.run([]() {
+    });
+    EXPECT_TRUE(group.wait(1000));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_FALSE(group.isCanceled());
+}
+
+TEST(TaskGroup, child_groups) {
+    auto spin = [](TaskGroup& group) {
+        return [&group]() {
+            while (!group.isCanceled()) {
+                std::this_thread::yield();
+            }
+            pplx::cancel_current_task();
+        };
+    };
+    TaskGroup parent(std::make_shared<WorkStealingScheduler>(4));
+    {
+        TaskGroup first(parent);
+        TaskGroup second(parent);
+        EXPECT_EQ(first.getScheduler(), parent.getScheduler());
+
+        // canceling a child cancels neither its parent nor its siblings
+        first.run(spin(first));
+        first.cancel();
+        EXPECT_TRUE(first.wait(1000));
+        EXPECT_FALSE(parent.isCanceled());
+        EXPECT_FALSE(second.isCanceled());
+
+        // the parent waits for the tasks of its children, and cancels them
+        for (int i = 0; i < 100; ++i) {
+            second.run(spin(second));
+            parent.run(spin(parent));
+        }
+        EXPECT_FALSE(parent.waitOrCancel(50));
+        EXPECT_TRUE(second.isCanceled());
+        EXPECT_TRUE(second.wait(0));
+
+        // a child of a canceled group is canceled at once
+        TaskGroup late(parent);
+        EXPECT_TRUE(late.isCanceled());
+    }
+    int succeeded, failed, canceled, total;
+    parent.getStatus(succeeded, failed, canceled, total);
+    EXPECT_EQ(canceled, 201);
+    EXPECT_EQ(total, 201);
+}
+
+TEST(TaskGroup, metrics) {
+    TaskGroup group(std::make_shared<WorkStealingScheduler>(2));
+    EXPECT_THROW(group.getMetrics(), std::logic_error);
+    group.enableMetrics(1);
+
+    // 2 workers blocked: 2 tasks running, the others queued
+    std::atomic<bool> gate(false);
+    for (int i = 0; i < 10; ++i) {
+        group.run([&gate]() {
+            while (!gate) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    TaskMetrics::Snapshot snapshot = group.getMetrics();
+    EXPECT_EQ(snapshot.enqueued, 10);
+    EXPECT_EQ(snapshot.running, 2);
+    EXPECT_EQ(snapshot.queued, 8);
+    EXPECT_EQ(snapshot.completed, 0);
+    gate = true;
+
+    for (int i = 0; i < 90; ++i) {
+        group.run([]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        });
+    }
+    EXPECT_TRUE(group.wait(10000));
+    snapshot = group.getMetrics();
+    LOGGER << snapshot.toString();
+    EXPECT_EQ(snapshot.enqueued, 100);
+    EXPECT_EQ(snapshot.running, 0);
+    EXPECT_EQ(snapshot.queued, 0);
+    EXPECT_EQ(snapshot.completed, 100);
+    EXPECT_EQ(snapshot.sampled, 100);
+    EXPECT_GE(TaskMetrics::Snapshot::percentile(snapshot.run_ns, 0.5), 2000000);
+    EXPECT_GE(TaskMetrics::Snapshot::percentile(snapshot.wait_ns, 0.99), 100000000);
+    EXPECT_EQ(snapshot.lane_utilization.size(), (size_t)2);
+    EXPECT_GT(snapshot.utilization, 0.5);
+
+    // one task out of 4 measured, all of them counted
+    TaskGroup sampled_group;
+    sampled_group.enableMetrics(4);
+    sampled_group.parallel_for(0, 100, [](int) {
+    }, TaskGroup::Partition::Static, 1);
+    for (int i = 0; i < 100; ++i) {
+        sampled_group.run([]() {
+        });
+    }
+    EXPECT_TRUE(sampled_group.wait(1000));
+    snapshot = sampled_group.getMetrics();
+    int64_t tasks = snapshot.enqueued;
+    EXPECT_GT(tasks, 100);
+    EXPECT_EQ(snapshot.completed, tasks);
+    EXPECT_EQ(snapshot.sampled, (tasks + 3) / 4);
+}
+
+TEST(TaskGraph, dependencies) {
+    TaskGroup group(std::make_shared<WorkStealingScheduler>(4));
+    TaskGraph graph(group);
+    // a diamond: a -> (b, c) -> d, every node records its rank
+    std::atomic<int> rank(0);
+    int ranks[4] = {0, 0, 0, 0};
+    size_t a = graph.add([&]() {
+        ranks[0] = ++rank;
+    });
+    size_t b = graph.add([&]() {
+        ranks[1] = ++rank;
+    }, {a});
+    size_t c = graph.add([&]() {
+        ranks[2] = ++rank;
+    }, {a});
+    size_t d = graph.add([&]() {
+        ranks[3] = ++rank;
+    });
+    graph.precede(b, d);
+    graph.precede(c, d);
+    EXPECT_EQ(graph.size(), (size_t)4);
+
+    for (int i = 0; i < 100; ++i) {
+        rank = 0;
+        EXPECT_TRUE(graph.run());
+        ASSERT_EQ(ranks[0], 1);
+        ASSERT_LT(std::max(ranks[1], ranks[2]), 4);
+        ASSERT_EQ(ranks[3], 4);
+    }
+    EXPECT_THROW(graph.precede(d, 10), std::out_of_range);
+
+    // a failed node skips its successors, the next run starts over
+    bool fail = true;
+    std::atomic<int> after_failure(0);
+    size_t failing = graph.add([&fail]() {
+        if (fail) {
+            throw std::runtime_error("failed");
+        }
+    }, {d});
+    graph.add([&after_failure]() {
+        ++after_failure;
+    }, {failing});
+    EXPECT_THROW(graph.run(), std::runtime_error);
+    EXPECT_EQ(after_failure, 0);
+    fail = false;
+    EXPECT_TRUE(graph.run());
+    EXPECT_EQ(after_failure, 1);
+
+    graph.precede(failing, a);
+    EXPECT_THROW(graph.run(), std::logic_error);
+
+    // the nodes of a canceled group are skipped
+    TaskGroup canceled_group;
+    TaskGraph canceled_graph(canceled_group);
+    canceled_graph.add([&canceled_group]() {
+        canceled_group.cancel();
+    });
+    canceled_graph.add([]() {
+        FAIL();
+    }, {0});
+    EXPECT_FALSE(canceled_graph.run());
+}
+
+TEST(TaskGraph, nested_and_counted) {
+    int NUM_GRAPHS = 6;
+    int NUM_NODES = 50;
+    // fewer workers than graphs run by the tasks: the waiting workers run the nodes
+    TaskGroup group(std::make_shared<WorkStealingScheduler>(2));
+    group.enableMetrics(1);
+    std::atomic<int> count(0);
+    std::vector<std::unique_ptr<TaskGraph>> graphs;
+    for (int g = 0; g < NUM_GRAPHS; ++g) {
+        graphs.emplace_back(new TaskGraph(group));
+        size_t root = graphs.back()->add([]() {
+        });
+        for (int n = 1; n < NUM_NODES; ++n) {
+            graphs.back()->add([&count]() {
+                ++count;
+            }, {root});
+        }
+    }
+    std::atomic<int> completed(0);
+    for (auto& graph : graphs) {
+        TaskGraph* nested = graph.get();
+        group.run([nested, &completed]() {
+            if (nested->run()) {
+                ++completed;
+            }
+        });
+    }
+    EXPECT_TRUE(group.wait(10000));
+    EXPECT_EQ(completed, NUM_GRAPHS);
+    EXPECT_EQ(count, NUM_GRAPHS * (NUM_NODES - 1));
+    // every run is a task of the group, and the metrics measure its nodes
+    int succeeded, total;
+    group.getStatus(succeeded, total);
+    EXPECT_EQ(total, 2 * NUM_GRAPHS);
+    EXPECT_EQ(succeeded, 2 * NUM_GRAPHS);
+    TaskMetrics::Snapshot snapshot = group.getMetrics();
+    EXPECT_EQ(snapshot.completed, NUM_GRAPHS + NUM_GRAPHS * NUM_NODES);
+
+    // the wait of the group covers a run from another thread
+    std::atomic<bool> gate(false);
+    TaskGraph blocked(group);
+    blocked.add([&gate]() {
+        while (!gate) {
+            std::this_thread::yield();
+        }
+    });
+    std::thread runner([&blocked]() {
+        EXPECT_TRUE(blocked.run());
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(group.wait(10));
+    gate = true;
+    EXPECT_TRUE(group.wait(10000));
+    runner.join();
+}
+
+// Benchmarks are disabled by default, run them with:
+// main --gtest_also_run_disabled_tests --gtest_filter=TaskGroupBenchmark.*
+void benchmarkTinyTasks(const std::string& name, std::shared_ptr<pplx::scheduler_interface> scheduler, int num_tasks) {
+    std::atomic<int> counter(0);
+    auto start = std::chrono::steady_clock::now();
+    {
+        TaskGroup group(scheduler);
+        for (int i = 0; i < num_tasks; ++i) {
+            group.run([&counter]() {
+                ++counter;
+            });
+        }
+        EXPECT_TRUE(group.wait(120000));
+    }
+    auto end = std::chrono::steady_clock::now();
+    int elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    EXPECT_EQ(counter, num_tasks);
+    LOGGER << name << " - " << num_tasks << " tiny tasks: " << elapsed << " ms, " <<
+    (int64_t)num_tasks * 1000 / std::max(elapsed, 1) << " tasks/s";
+}
+
+TEST(TaskGroupBenchmark, DISABLED_million_tiny_tasks) {
+    int NUM_TASKS = 1000000;
+    benchmarkTinyTasks("pplx ambient scheduler", nullptr, NUM_TASKS);
+    benchmarkTinyTasks("work-stealing scheduler", std::make_shared<WorkStealingScheduler>(), NUM_TASKS);
+
+    // the raw executors, without the pplx task objects
+    struct Tiny {
+        static void run(void* param) {
+            ++*static_cast<std::atomic<int>*>(param);
+        }
+    };
+    auto raw = [NUM_TASKS](const std::string& name, std::shared_ptr<pplx::scheduler_interface> scheduler) {
+        std::atomic<int> counter(0);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < NUM_TASKS; ++i) {
+            scheduler->schedule(&Tiny::run, &counter);
+        }
+        while (counter < NUM_TASKS) {
+            std::this_thread::yield();
+        }
+        auto end = std::chrono::steady_clock::now();
+        int elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        LOGGER << name << " raw schedule - " << NUM_TASKS << " tiny tasks: " << elapsed << " ms";
+    };
+    raw("pplx ambient scheduler", pplx::get_ambient_scheduler());
+    raw("work-stealing scheduler", std::make_shared<WorkStealingScheduler>());
+}
+
+TEST(TaskGroupBenchmark, DISABLED_completion_throughput) {
+    int NUM_THREADS = std::max(4u, std::thread::hardware_concurrency());
+    int NUM_TASKS = 1000000;
+
+    // the former completion of TaskGroup: a mutex and a notification per task
+    struct MutexCompletion {
+        std::mutex              m_mutex;
+        std::condition_variable m_cv;
+        int                     m_succeeded = 0;
+        void countDown() {
+            {
+                std::lock_guard<std::mutex> lk(m_mutex);
+                m_succeeded++;
+            }
+            m_cv.notify_one();
+        }
+    };
+
+    auto run = [NUM_THREADS, NUM_TASKS](const std::string& name, const std::function<void()>& complete) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < NUM_THREADS; ++t) {
+            threads.emplace_back([&complete, NUM_TASKS, NUM_THREADS]() {
+                for (int i = 0; i < NUM_TASKS / NUM_THREADS; ++i) {
+                    complete();
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        auto end = std::chrono::steady_clock::now();
+        int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        LOGGER << name << " - " << NUM_TASKS << " completions from " << NUM_THREADS << " threads: " <<
+        elapsed / 1000 << " ms, " << elapsed * 1000 / NUM_TASKS << " ns/completion";
+    };
+
+    MutexCompletion mutex_completion;
+    run("mutex + notify", [&mutex_completion]() {
+        mutex_completion.countDown();
+    });
+    CompletionLatch latch;
+    latch.add(NUM_TASKS);
+    run("completion latch", [&latch]() {
+        latch.countDown(CompletionLatch::Succeeded);
+    });
+    EXPECT_TRUE(latch.wait(1000));
+}
+
+TEST(TaskGroupBenchmark, DISABLED_map_reduce) {
+    int NUM_TASKS = 1000000;
+    auto scheduler = std::make_shared<WorkStealingScheduler>();
+    auto square = [](size_t i) {
+        return (int64_t)i * i;
+    };
+
+    // the results are collected then summed after the wait
+    auto start = std::chrono::steady_clock::now();
+    int64_t collected = 0;
+    {
+        TypedTaskGroup<int64_t> group(NUM_TASKS, scheduler);
+        for (int i = 0; i < NUM_TASKS; ++i) {
+            group.run([i, &square]() {
+                return square(i);
+            });
+        }
+        EXPECT_TRUE(group.wait(120000));
+        for (size_t i = 0; i < group.size(); ++i) {
+            collected += group.result(i);
+        }
+    }
+    int elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    LOGGER << "collect then sum - " << NUM_TASKS << " tasks: " << elapsed << " ms, results: " <<
+    NUM_TASKS * PaddedArray<int64_t>::STRIDE / (1024 * 1024) << " MB";
+
+    start = std::chrono::steady_clock::now();
+    TypedTaskGroup<int64_t> group(0, scheduler);
+    int64_t reduced = group.map_reduce(NUM_TASKS, square, 0, [](int64_t a, int64_t b) {
+        return a + b;
+    });
+    elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    LOGGER << "map_reduce - " << NUM_TASKS << " tasks: " << elapsed << " ms, partial results: " << scheduler->getNumWorkers();
+    EXPECT_EQ(reduced, collected);
+}
+
+TEST(TaskGroupBenchmark, DISABLED_parallel_for_grain_sizes) {
+    int SIZE = 10000000;
+    std::vector<double> values(SIZE);
+    auto body = [&values](int i) {
+        values[i] = std::sqrt((double)i) * 0.5;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < SIZE; ++i) {
+        body(i);
+    }
+    int elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    LOGGER << "serial loop - " << SIZE << " iterations: " << elapsed << " ms";
+
+    TaskGroup group(std::make_shared<WorkStealingScheduler>());
+    const char* names[] = {"static", "guided", "adaptive"};
+    TaskGroup::Partition partitions[] = {
+        TaskGroup::Partition::Static, TaskGroup::Partition::Guided, TaskGroup::Partition::Adaptive
+    };
+    for (int p = 0; p < 3; ++p) {
+        for (int grain : {1, 64, 4096, 262144}) {
+            start = std::chrono::steady_clock::now();
+            EXPECT_TRUE(group.parallel_for(0, SIZE, body, partitions[p], grain));
+            elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+            LOGGER << names[p] << " parallel_for - " << SIZE << " iterations, grain " << grain << ": " << elapsed << " ms";
+        }
+    }
+}
+
+TEST(TaskGroupBenchmark, DISABLED_metrics_overhead) {
+    int NUM_TASKS = 10000000;
+    // the budget of the bookkeeping per task, at the default sampling of enableMetrics()
+    unsigned int DEFAULT_SAMPLING = 16;
+    int64_t BUDGET_NS = 50;
+    // the bookkeeping of a task alone, on one thread
+    for (unsigned int sample_every : {1u, DEFAULT_SAMPLING, 64u}) {
+        TaskMetrics metrics(4, sample_every);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < NUM_TASKS; ++i) {
+            int64_t enqueued = metrics.enqueue();
+            TaskMetrics::Scope scope(metrics, i & 3, enqueued);
+        }
+        int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        EXPECT_EQ(metrics.snapshot(0).completed, NUM_TASKS);
+        LOGGER << "metrics sampling 1/" << sample_every << " - " << elapsed / NUM_TASKS << " ns/task";
+        if (sample_every == DEFAULT_SAMPLING) {
+            EXPECT_LT(elapsed / NUM_TASKS, BUDGET_NS);
+        }
+    }
+
+    // through a group: the difference with the same tasks not measured
+    NUM_TASKS = 1000000;
+    auto scheduler = std::make_shared<WorkStealingScheduler>();
+    auto run = [NUM_TASKS, &scheduler](unsigned int sample_every) {
+        std::atomic<int> counter(0);
+        TaskGroup group(scheduler);
+        if (sample_every > 0) {
+            group.enableMetrics(sample_every);
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < NUM_TASKS; ++i) {
+            group.run([&counter]() {
+                ++counter;
+            });
+        }
+        EXPECT_TRUE(group.wait(120000));
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / NUM_TASKS;
+    };
+    int64_t baseline = run(0);
+    for (unsigned int sample_every : {1u, 16u}) {
+        int64_t measured = run(sample_every);
+        LOGGER << "group tasks: " << baseline << " ns/task, measured sampling 1/" << sample_every << ": " <<
+        measured << " ns/task";
+    }
+}
+
+// 'layers' layers of 'width' nodes, every node depends on 2 nodes of the previous layer
+void buildLayeredGraph(TaskGraph& graph, int layers, int width, std::vector<int64_t>& values) {
+    values.assign(layers * width, 0);
+    for (int l = 0; l < layers; ++l) {
+        for (int w = 0; w < width; ++w) {
+            int64_t* value = &values[l * width + w];
+            std::vector<size_t> dependencies;
+            if (l > 0) {
+                dependencies.push_back((l - 1) * width + w);
+                dependencies.push_back((l - 1) * width + (w + 1) % width);
+            }
+            graph.add([value]() {
+                ++*value;
+            }, dependencies);
+        }
+    }
+}
+
+TEST(TaskGroupBenchmark, DISABLED_task_graph) {
+    int LAYERS = 10;
+    int WIDTH = 100;
+    int NUM_RUNS = 10000;
+    TaskGroup group(std::make_shared<WorkStealingScheduler>());
+    TaskGraph graph(group);
+    std::vector<int64_t> values;
+    buildLayeredGraph(graph, LAYERS, WIDTH, values);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < NUM_RUNS; ++i) {
+        graph.run();
+    }
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    for (int64_t value : values) {
+        ASSERT_EQ(value, NUM_RUNS);
+    }
+    LOGGER << "task graph - " << graph.size() << " nodes x " << NUM_RUNS << " runs: " << elapsed / 1000 << " ms, " <<
+    elapsed / NUM_RUNS << " us/run, " << elapsed * 1000 / NUM_RUNS / (int64_t)graph.size() << " ns/node";
+
+    // the same graph as pplx continuations: a task per node and a when_all per dependency set, every run
+    int PPLX_RUNS = 100;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < PPLX_RUNS; ++i) {
+        std::vector<pplx::task<void>> tasks;
+        for (int l = 0; l < LAYERS; ++l) {
+            for (int w = 0; w < WIDTH; ++w) {
+                int64_t* value = &values[l * WIDTH + w];
+                auto func = [value]() {
+                    ++*value;
+                };
+                if (l == 0) {
+                    tasks.push_back(pplx::create_task(func));
+                } else {
+                    std::vector<pplx::task<void>> dependencies;
+                    dependencies.push_back(tasks[(l - 1) * WIDTH + w]);
+                    dependencies.push_back(tasks[(l - 1) * WIDTH + (w + 1) % WIDTH]);
+                    tasks.push_back(pplx::when_all(dependencies.begin(), dependencies.end()).then(func));
+                }
+            }
+        }
+        pplx::when_all(tasks.begin(), tasks.end()).wait();
+    }
+    elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    LOGGER << "pplx continuations - " << graph.size() << " nodes x " << PPLX_RUNS << " runs: " << elapsed / 1000 << " ms, " <<
+    elapsed / PPLX_RUNS << " us/run";
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
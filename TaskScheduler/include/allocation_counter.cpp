@@ -0,0 +1,24 @@
+#include "allocation_counter.h"
+
+#include <new>
+#include <cstdlib>
+
+thread_local int64_t thread_allocations_nb = 0;
+thread_local int64_t thread_allocated_bytes = 0;
+
+void *operator new(size_t size) {
+  ++thread_allocations_nb;
+  thread_allocated_bytes += size;
+  if (void *ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+  std::free(ptr);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+
+// Allocations of the calling thread, counted by the global operator new replaced in allocation_counter.cpp.
+// The replacement lives in its own translation unit: the compiler never sees a new-expression
+// paired with the free() of the replaced operator delete, so -Wmismatched-new-delete stays quiet.
+extern thread_local int64_t thread_allocations_nb;
+extern thread_local int64_t thread_allocated_bytes;
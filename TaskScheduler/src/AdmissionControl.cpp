@@ -0,0 +1,37 @@
+#include "AdmissionControl.h"
+
+AdmissionControl::AdmissionControl(const int64_t &max_in_flight, RejectionHandler handler): max_in_flight_(max_in_flight), handler_(std::move(handler)) {
+}
+
+bool AdmissionControl::tryAcquire(const TaskId &task_id) {
+  int64_t in_flight = in_flight_.load(std::memory_order_relaxed);
+  do {
+    if (in_flight >= max_in_flight_) {
+      ++rejected_;
+      if (handler_) {
+        handler_(task_id);
+      }
+      return false;
+    }
+  } while (!in_flight_.compare_exchange_weak(in_flight, in_flight + 1, std::memory_order_acquire, std::memory_order_relaxed));
+
+  int64_t peak = peak_in_flight_.load(std::memory_order_relaxed);
+  while (in_flight + 1 > peak && !peak_in_flight_.compare_exchange_weak(peak, in_flight + 1, std::memory_order_relaxed));
+  return true;
+}
+
+void AdmissionControl::release() {
+  in_flight_.fetch_sub(1, std::memory_order_release);
+}
+
+int64_t AdmissionControl::inFlight() const {
+  return in_flight_;
+}
+
+int64_t AdmissionControl::peakInFlight() const {
+  return peak_in_flight_;
+}
+
+int64_t AdmissionControl::rejected() const {
+  return rejected_;
+}
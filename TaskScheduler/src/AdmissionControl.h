@@ -0,0 +1,35 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+
+#include <boost/utility.hpp> // boost::noncopyable
+
+#include "TaskRegistry.h"
+
+/**
+* @brief AdmissionControl bounds the number of task executions in flight (admitted and not completed yet)
+* of a TaskScheduler. An execution beyond the limit is rejected: it is skipped, and the rejection handler
+* is invoked so the producers get a backpressure signal. The handler is invoked on the worker that rejects,
+* it must be short and it must not block.
+*/
+class AdmissionControl: boost::noncopyable {
+ public:
+  using RejectionHandler = std::function<void(const TaskId &task_id)>;
+
+  AdmissionControl(const int64_t &max_in_flight, RejectionHandler handler);
+
+  bool tryAcquire(const TaskId &task_id); //!< return false if rejected
+  void release();
+
+  int64_t inFlight() const;
+  int64_t peakInFlight() const;
+  int64_t rejected() const;
+
+ private:
+  const int64_t max_in_flight_;
+  const RejectionHandler handler_;
+  std::atomic<int64_t> in_flight_ {0};
+  std::atomic<int64_t> peak_in_flight_ {0};
+  std::atomic<int64_t> rejected_ {0};
+};
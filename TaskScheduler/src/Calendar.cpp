@@ -0,0 +1,199 @@
+#include "Calendar.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+Calendar::Calendar(std::vector<boost::posix_time::ptime> instants): instants_(std::move(instants)) {
+  std::sort(instants_.begin(), instants_.end());
+  instants_.erase(std::unique(instants_.begin(), instants_.end()), instants_.end());
+  instants_.shrink_to_fit();
+}
+
+Calendar::Calendar(const boost::posix_time::ptime &first, const boost::posix_time::time_duration &period, const size_t &instants_nb) {
+  if (period <= boost::posix_time::time_duration(0, 0, 0)) {
+    // the instants would be neither sorted nor unique
+    throw std::invalid_argument("Calendar: the period must be positive");
+  }
+  instants_.reserve(instants_nb);
+  for (size_t i = 0; i < instants_nb; ++i) {
+    instants_.push_back(first + period * static_cast<int>(i));
+  }
+}
+
+size_t Calendar::size() const {
+  return instants_.size();
+}
+
+const boost::posix_time::ptime &Calendar::at(const size_t &idx) const {
+  return instants_[idx];
+}
+
+size_t Calendar::firstAfter(const boost::posix_time::ptime &time) const {
+  return std::upper_bound(instants_.begin(), instants_.end(), time) - instants_.begin();
+}
+
+size_t Calendar::memoryBytes() const {
+  return sizeof(*this) + instants_.capacity() * sizeof(boost::posix_time::ptime);
+}
+
+/////////////
+CalendarBatch::Timer::Timer(std::shared_ptr<CalendarBatch> batch, const TaskStrand &strand): batch_(std::move(batch)), strand_(strand) {
+}
+
+CalendarBatch::Timer::~Timer() {
+  const std::lock_guard<std::mutex> lock(batch_->mutex_);
+  if (waiting_) {
+    batch_->unlink(this);
+  }
+}
+
+size_t CalendarBatch::Timer::expiresFromNow(const int64_t &/*microseconds*/) {
+  return 0;
+}
+
+size_t CalendarBatch::Timer::expiresAt(const boost::posix_time::ptime &/*expiry_time*/) {
+  return 0;
+}
+
+void CalendarBatch::Timer::asyncWait(Handler handler) {
+  {
+    const std::lock_guard<std::mutex> lock(batch_->mutex_);
+    if (batch_->next_instant_ < batch_->calendar_->size()) {
+      handler_ = std::move(handler);
+      batch_->link(this);
+      return;
+    }
+  }
+  // the calendar is exhausted
+  boost::asio::post(strand_, std::bind(std::move(handler), boost::asio::error::operation_aborted));
+}
+
+size_t CalendarBatch::Timer::cancel() {
+  Handler handler;
+  {
+    const std::lock_guard<std::mutex> lock(batch_->mutex_);
+    if (!waiting_) {
+      return 0;
+    }
+    batch_->unlink(this);
+    handler = std::move(handler_);
+    handler_ = nullptr;
+  }
+  boost::asio::post(strand_, std::bind(std::move(handler), boost::asio::error::operation_aborted));
+  return 1;
+}
+
+const TaskStrand &CalendarBatch::Timer::strand() const {
+  return strand_;
+}
+
+std::chrono::steady_clock::time_point CalendarBatch::Timer::now() const {
+  return batch_->driver_->now();
+}
+
+boost::posix_time::ptime CalendarBatch::Timer::universalTime() const {
+  return batch_->driver_->universalTime();
+}
+
+CalendarBatch &CalendarBatch::Timer::batch() {
+  return *batch_;
+}
+
+size_t CalendarBatch::Timer::instant() const {
+  return instant_;
+}
+
+/////////////
+CalendarBatch::CalendarBatch(std::shared_ptr<const Calendar> calendar, std::unique_ptr<TaskTimer> driver):
+  calendar_(std::move(calendar)),
+  driver_(std::move(driver)),
+  next_instant_(calendar_->firstAfter(driver_->universalTime())) {
+}
+
+const Calendar &CalendarBatch::calendar() const {
+  return *calendar_;
+}
+
+size_t CalendarBatch::nextInstant() {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  return next_instant_;
+}
+
+size_t CalendarBatch::waiting() {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  return waiting_nb_;
+}
+
+void CalendarBatch::link(Timer *timer) {
+  // push front
+  timer->prev_ = nullptr;
+  timer->next_ = waiting_;
+  if (waiting_) {
+    waiting_->prev_ = timer;
+  }
+  waiting_ = timer;
+  timer->waiting_ = true;
+  ++waiting_nb_;
+
+  if (!armed_) {
+    arm();
+  }
+}
+
+void CalendarBatch::unlink(Timer *timer) {
+  if (timer->prev_) {
+    timer->prev_->next_ = timer->next_;
+  } else {
+    waiting_ = timer->next_;
+  }
+  if (timer->next_) {
+    timer->next_->prev_ = timer->prev_;
+  }
+  timer->prev_ = nullptr;
+  timer->next_ = nullptr;
+  timer->waiting_ = false;
+  --waiting_nb_;
+}
+
+void CalendarBatch::arm() {
+  // the batch has been idle: only the last instant in the past is still dispatched
+  size_t first_future = calendar_->firstAfter(driver_->universalTime());
+  if (first_future > next_instant_ + 1) {
+    next_instant_ = first_future - 1;
+  }
+
+  armed_ = true;
+  driver_->expiresAt(calendar_->at(next_instant_));
+  // the batch is owned by its timers, it may be destroyed while the driver is waiting
+  std::weak_ptr<CalendarBatch> weak_batch = weak_from_this();
+  driver_->asyncWait([weak_batch](const boost::system::error_code & e) {
+    if (std::shared_ptr<CalendarBatch> batch = weak_batch.lock()) {
+      batch->onExpiry(e);
+    }
+  });
+}
+
+void CalendarBatch::onExpiry(const boost::system::error_code &e) {
+  if (e == boost::asio::error::operation_aborted) {
+    return;
+  }
+
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    armed_ = false;
+    size_t instant = next_instant_++;
+    while (waiting_) {
+      Timer *timer = waiting_;
+      unlink(timer);
+      timer->instant_ = instant;
+      dispatched_.emplace_back(timer->strand_, std::move(timer->handler_));
+      timer->handler_ = nullptr;
+    }
+  }
+
+  // batched dispatch of the waiting timers
+  for (auto &it : dispatched_) {
+    boost::asio::post(it.first, std::bind(std::move(it.second), boost::system::error_code()));
+  }
+  dispatched_.clear();
+}
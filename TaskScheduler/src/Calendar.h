@@ -0,0 +1,94 @@
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <vector>
+
+#include "TaskTimer.h"
+
+/**
+* @brief Calendar is an immutable, sorted and de-duplicated list of instants in UTC (Absolut Time).
+* It is stored flat, 8 bytes per instant, and it is meant to be shared by many tasks (see CalendarBatch).
+*/
+class Calendar: boost::noncopyable {
+ public:
+  explicit Calendar(std::vector<boost::posix_time::ptime> instants);
+  Calendar(const boost::posix_time::ptime &first, const boost::posix_time::time_duration &period, const size_t &instants_nb); //!< throw std::invalid_argument if 'period' is not positive
+
+  size_t size() const;
+  const boost::posix_time::ptime &at(const size_t &idx) const;
+  size_t firstAfter(const boost::posix_time::ptime &time) const; //!< index of the first instant after 'time', size() if none
+  size_t memoryBytes() const;
+
+ private:
+  std::vector<boost::posix_time::ptime> instants_;
+};
+
+/**
+* @brief CalendarBatch dispatches the instants of a Calendar to all its Timers with a single driver timer:
+* at every instant the Timers waiting for it are dispatched as a batch, each handler is posted to its timer's strand.
+* The instants in the past (on the driver's clock) when the batch is created are ignored, and a Timer that is not waiting when an instant
+* is dispatched (its task is still running) misses it. Once the calendar is exhausted, the waits are aborted.
+*/
+class CalendarBatch: public std::enable_shared_from_this<CalendarBatch>, boost::noncopyable {
+ public:
+  using Handler = TaskTimer::Handler;
+
+  /**
+  * @brief Timer is a subscription to the instants of a CalendarBatch, its expiry is decided by the calendar:
+  * expiresFromNow() and expiresAt() are ignored. It is an intrusive node of the list of waiting timers.
+  */
+  class Timer: public TaskTimer, public Pooled<Timer> {
+   public:
+    Timer(std::shared_ptr<CalendarBatch> batch, const TaskStrand &strand);
+    ~Timer() override; // pending wait is dropped without invoking its handler
+
+    size_t expiresFromNow(const int64_t &microseconds) override;
+    size_t expiresAt(const boost::posix_time::ptime &expiry_time) override;
+    void asyncWait(Handler handler) override;
+    size_t cancel() override;
+    const TaskStrand &strand() const override;
+    std::chrono::steady_clock::time_point now() const override; //!< clock of the batch's driver
+    boost::posix_time::ptime universalTime() const override;
+
+    CalendarBatch &batch();
+    size_t instant() const; //!< index of the instant of the last dispatch, valid in its handler
+
+   private:
+    friend class CalendarBatch;
+
+    std::shared_ptr<CalendarBatch> batch_;
+    TaskStrand strand_;
+    Handler handler_;
+    size_t instant_ {0};
+    bool waiting_ {false};
+    Timer *prev_ {nullptr};
+    Timer *next_ {nullptr};
+  };
+
+  /**
+  * @param driver timer of the batch, its strand serializes the dispatches
+  */
+  CalendarBatch(std::shared_ptr<const Calendar> calendar, std::unique_ptr<TaskTimer> driver);
+
+  const Calendar &calendar() const;
+  size_t nextInstant(); //!< index of the next instant to dispatch
+  size_t waiting(); //!< number of timers waiting for the next instant
+
+ private:
+  // not thread safe, 'mutex_' must be locked
+  void link(Timer *timer);
+  void unlink(Timer *timer);
+  void arm();
+
+  void onExpiry(const boost::system::error_code &e);
+
+  const std::shared_ptr<const Calendar> calendar_;
+  const std::unique_ptr<TaskTimer> driver_;
+  size_t next_instant_ {0};
+  size_t waiting_nb_ {0};
+  bool armed_ {false};
+  Timer *waiting_ {nullptr}; //!< head of the list of waiting timers
+  std::vector<std::pair<TaskStrand, Handler>> dispatched_; //!< reused by every dispatch, only accessed by the driver's handler
+  std::mutex mutex_;
+};
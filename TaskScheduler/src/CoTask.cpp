@@ -0,0 +1,61 @@
+#include "CoTask.h"
+#include "TaskScheduler.h"
+
+std::coroutine_handle<> CoTask::FinalAwaiter::await_suspend(Handle handle) noexcept {
+  promise_type &promise = handle.promise();
+  if (promise.continuation_) {
+    return promise.continuation_;
+  }
+  if (promise.scheduler_) {
+    // the frame is destroyed here, it is suspended already
+    promise.scheduler_->releaseCoroutine(handle);
+  }
+  return std::noop_coroutine();
+}
+
+/////////////
+SleepAwaiter::SleepAwaiter(const int64_t &microseconds): microseconds_(microseconds) {
+}
+
+SleepAwaiter::SleepAwaiter(const boost::posix_time::ptime &expiry_time): expiry_time_(expiry_time) {
+}
+
+void SleepAwaiter::await_suspend(CoTask::Handle handle) {
+  TaskTimer *timer = handle.promise().timer_;
+  if (!timer) {
+    throw std::logic_error("SleepAwaiter: the coroutine has not been spawned by a TaskScheduler");
+  }
+  if (expiry_time_.is_not_a_date_time()) {
+    timer->expiresFromNow(microseconds_);
+  } else {
+    timer->expiresAt(expiry_time_);
+  }
+  timer->asyncWait([handle](const boost::system::error_code & e) {
+    // aborted when the timer is destroyed with the coroutine frame
+    if (e != boost::asio::error::operation_aborted) {
+      handle.resume();
+    }
+  });
+}
+
+/////////////
+CompletionAwaiter::CompletionAwaiter(std::shared_ptr<Task> task): task_(std::move(task)) {
+}
+
+void CompletionAwaiter::await_suspend(CoTask::Handle handle) {
+  TaskTimer *timer = handle.promise().timer_;
+  if (!timer) {
+    throw std::logic_error("CompletionAwaiter: the coroutine has not been spawned by a TaskScheduler");
+  }
+  // from the strand of the task to the one of the coroutine
+  TaskStrand strand = timer->strand();
+  task_->addCompletionWaiter([handle, strand]() {
+    boost::asio::post(strand, [handle]() {
+      handle.resume();
+    });
+  });
+}
+
+Task::Summary CompletionAwaiter::await_resume() const {
+  return task_->summary();
+}
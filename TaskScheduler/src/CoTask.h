@@ -0,0 +1,119 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <exception>
+#include <coroutine>
+
+#include "TaskTimer.h"
+
+class TaskScheduler;
+
+/**
+* @brief CoTask is the return type of the coroutines run by a TaskScheduler, see TaskScheduler::spawn().
+* It is lazy: it starts when it is spawned, or when another CoTask awaits it, which is resumed once it has completed
+* and receives its exception, if any. A spawned coroutine and all the ones it awaits resume on the same strand,
+* so they never run concurrently, and they share a single timer for their sleeps.
+*/
+class CoTask {
+ public:
+  struct promise_type;
+  using Handle = std::coroutine_handle<promise_type>;
+
+  /**
+  * @brief FinalAwaiter resumes the awaiting coroutine, or releases a spawned one
+  */
+  struct FinalAwaiter {
+    bool await_ready() const noexcept {
+      return false;
+    }
+    std::coroutine_handle<> await_suspend(Handle handle) noexcept;
+    void await_resume() const noexcept {}
+  };
+
+  struct promise_type {
+    CoTask get_return_object() noexcept {
+      return CoTask(Handle::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() const noexcept {
+      return {};
+    }
+    FinalAwaiter final_suspend() const noexcept {
+      return {};
+    }
+    void return_void() const noexcept {}
+    void unhandled_exception() noexcept {
+      exception_ = std::current_exception();
+    }
+
+    TaskTimer *timer_ {nullptr}; //!< timer of the spawned coroutine, shared with the awaited ones
+    std::unique_ptr<TaskTimer> owned_timer_; //!< only the spawned coroutine owns it
+    TaskScheduler *scheduler_ {nullptr}; //!< only the spawned coroutine is released by the scheduler
+    std::coroutine_handle<> continuation_; //!< awaiting coroutine
+    std::exception_ptr exception_;
+  };
+
+  CoTask() = default;
+  CoTask(CoTask &&other) noexcept: handle_(std::exchange(other.handle_, nullptr)) {}
+  CoTask &operator=(CoTask &&other) noexcept {
+    if (this != &other) {
+      reset();
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+  ~CoTask() {
+    reset();
+  }
+
+  // awaited by another CoTask: it runs now and resumes the awaiting one when it completes
+  bool await_ready() const noexcept {
+    return !handle_ || handle_.done();
+  }
+  std::coroutine_handle<> await_suspend(Handle awaiting) noexcept {
+    handle_.promise().continuation_ = awaiting;
+    handle_.promise().timer_ = awaiting.promise().timer_;
+    return handle_;
+  }
+  void await_resume() const {
+    if (handle_ && handle_.promise().exception_) {
+      std::rethrow_exception(handle_.promise().exception_);
+    }
+  }
+
+  Handle release() noexcept {
+    return std::exchange(handle_, nullptr);
+  }
+
+ private:
+  explicit CoTask(Handle handle) noexcept: handle_(handle) {}
+
+  void reset() noexcept {
+    if (handle_) {
+      handle_.destroy();
+      handle_ = nullptr;
+    }
+  }
+
+  Handle handle_;
+};
+
+/**
+* @brief SleepAwaiter suspends a CoTask until a timeout or an absolute time, without blocking the worker.
+* See TaskScheduler::sleep_for() and TaskScheduler::at().
+*/
+class SleepAwaiter {
+ public:
+  explicit SleepAwaiter(const int64_t &microseconds);
+  explicit SleepAwaiter(const boost::posix_time::ptime &expiry_time); //!< expiry_time must be in UTC (Absolut Time)
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+  void await_suspend(CoTask::Handle handle);
+  void await_resume() const noexcept {}
+
+ private:
+  int64_t microseconds_ {0};
+  boost::posix_time::ptime expiry_time_;
+};
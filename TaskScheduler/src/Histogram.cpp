@@ -0,0 +1,132 @@
+#include "Histogram.h"
+
+#include <cmath>
+#include <algorithm>
+
+template <unsigned int SubBucketBits>
+void BasicHistogram<SubBucketBits>::record(const int64_t &value) {
+  int64_t clamped = clamp(value);
+  ++counts_[bucketOf(clamped)];
+  ++count_;
+  min_ = std::min(min_, clamped);
+  max_ = std::max(max_, clamped);
+  sum_ += clamped;
+}
+
+template <unsigned int SubBucketBits>
+void BasicHistogram<SubBucketBits>::merge(const BasicHistogram &other) {
+  for (unsigned int bucket = 0; bucket < BUCKETS; ++bucket) {
+    counts_[bucket] += other.counts_[bucket];
+  }
+  count_ += other.count_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+  sum_ += other.sum_;
+}
+
+template <unsigned int SubBucketBits>
+void BasicHistogram<SubBucketBits>::reset() {
+  *this = BasicHistogram();
+}
+
+template <unsigned int SubBucketBits>
+int64_t BasicHistogram<SubBucketBits>::count() const {
+  return count_;
+}
+
+template <unsigned int SubBucketBits>
+int64_t BasicHistogram<SubBucketBits>::min() const {
+  return count_ > 0 ? min_ : 0;
+}
+
+template <unsigned int SubBucketBits>
+int64_t BasicHistogram<SubBucketBits>::max() const {
+  return max_;
+}
+
+template <unsigned int SubBucketBits>
+double BasicHistogram<SubBucketBits>::mean() const {
+  return count_ > 0 ? static_cast<double>(sum_) / count_ : 0.0;
+}
+
+template <unsigned int SubBucketBits>
+int64_t BasicHistogram<SubBucketBits>::percentile(const double &percentile) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  // rank of the value, 1-based
+  int64_t rank = std::max(static_cast<int64_t>(std::ceil(percentile / 100.0 * count_)), static_cast<int64_t>(1));
+  int64_t accumulated = 0;
+  for (unsigned int bucket = 0; bucket < BUCKETS; ++bucket) {
+    accumulated += counts_[bucket];
+    if (accumulated >= rank) {
+      return std::min(upperBoundOf(bucket), max_);
+    }
+  }
+  return max_;
+}
+
+template <unsigned int SubBucketBits>
+int64_t BasicHistogram<SubBucketBits>::clamp(const int64_t &value) {
+  return std::min(std::max(value, static_cast<int64_t>(0)), MAX_VALUE);
+}
+
+template <unsigned int SubBucketBits>
+unsigned int BasicHistogram<SubBucketBits>::bucketOf(const int64_t &value) {
+  if (value < SUB_BUCKETS) {
+    return static_cast<unsigned int>(value);
+  }
+  // most significant bit, value < 2^32
+  unsigned int msb = 0;
+  for (unsigned int step = VALUE_BITS / 2; step > 0; step >>= 1) {
+    if ((value >> (msb + step)) != 0) {
+      msb += step;
+    }
+  }
+  // the top SUB_BUCKET_BITS bits select the sub-bucket of the power of two
+  unsigned int shift = msb - (SUB_BUCKET_BITS - 1);
+  return shift * (SUB_BUCKETS / 2) + static_cast<unsigned int>(value >> shift);
+}
+
+template <unsigned int SubBucketBits>
+int64_t BasicHistogram<SubBucketBits>::upperBoundOf(const unsigned int &bucket) {
+  if (bucket < SUB_BUCKETS) {
+    return bucket;
+  }
+  unsigned int shift = bucket / (SUB_BUCKETS / 2) - 1;
+  int64_t top = bucket - shift * (SUB_BUCKETS / 2);
+  return ((top + 1) << shift) - 1;
+}
+
+template class BasicHistogram<4>;
+template class BasicHistogram<3>;
+
+/////////////
+void AtomicHistogram::record(const int64_t &value) {
+  int64_t clamped = Histogram::clamp(value);
+  add(counts_[Histogram::bucketOf(clamped)], static_cast<uint32_t>(1));
+  add(count_, static_cast<int64_t>(1));
+  add(sum_, clamped);
+  if (clamped < min_.load(std::memory_order_relaxed)) {
+    min_.store(clamped, std::memory_order_relaxed);
+  }
+  if (clamped > max_.load(std::memory_order_relaxed)) {
+    max_.store(clamped, std::memory_order_relaxed);
+  }
+}
+
+void AtomicHistogram::mergeInto(Histogram &histogram) const {
+  // the count is the sum of the buckets, so percentiles stay consistent with a concurrent record()
+  int64_t count = 0;
+  for (unsigned int bucket = 0; bucket < Histogram::BUCKETS; ++bucket) {
+    uint32_t bucket_count = counts_[bucket].load(std::memory_order_relaxed);
+    histogram.counts_[bucket] += bucket_count;
+    count += bucket_count;
+  }
+  histogram.count_ += count;
+  histogram.sum_ += sum_.load(std::memory_order_relaxed);
+  if (count > 0) {
+    histogram.min_ = std::min(histogram.min_, min_.load(std::memory_order_relaxed));
+    histogram.max_ = std::max(histogram.max_, max_.load(std::memory_order_relaxed));
+  }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <limits>
+#include <cstdint>
+
+/**
+* @brief BasicHistogram counts values (e.g. microseconds) in log-linear buckets, like an HDR histogram:
+* values below SUB_BUCKETS are exact, above every power of two is split in SUB_BUCKETS / 2 buckets,
+* so the relative error of a percentile is below 2 / SUB_BUCKETS. Its size is fixed, recording never allocates.
+* Negative values are recorded as zero and values above MAX_VALUE as MAX_VALUE.
+*/
+template <unsigned int SubBucketBits>
+class BasicHistogram {
+ public:
+  static constexpr unsigned int SUB_BUCKET_BITS = SubBucketBits;
+  static constexpr unsigned int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static constexpr unsigned int VALUE_BITS = 32;
+  static constexpr int64_t MAX_VALUE = (1LL << VALUE_BITS) - 1;
+  static constexpr unsigned int BUCKETS = (VALUE_BITS - SUB_BUCKET_BITS + 1) * (SUB_BUCKETS / 2) + SUB_BUCKETS / 2;
+
+  void record(const int64_t &value);
+  void merge(const BasicHistogram &other);
+  void reset();
+
+  int64_t count() const;
+  int64_t min() const; //!< zero if empty
+  int64_t max() const;
+  double mean() const;
+  int64_t percentile(const double &percentile) const; //!< percentile in [0, 100], upper bound of its bucket
+
+  static int64_t clamp(const int64_t &value);
+  static unsigned int bucketOf(const int64_t &value); //!< value must be clamped
+
+ private:
+  friend class AtomicHistogram;
+
+  static int64_t upperBoundOf(const unsigned int &bucket);
+
+  std::array<uint32_t, BUCKETS> counts_ {};
+  int64_t count_ {0};
+  int64_t min_ {std::numeric_limits<int64_t>::max()};
+  int64_t max_ {0};
+  int64_t sum_ {0};
+};
+
+using Histogram = BasicHistogram<4>; //!< 240 buckets, ~1 KB: the aggregated SchedulerStats
+using CoarseHistogram = BasicHistogram<3>; //!< 124 buckets, ~0.5 KB: the Summary of every task, which are many
+
+/**
+* @brief AtomicHistogram is a Histogram with a single writer thread and any number of reader threads:
+* record() is lock-free and cheap (relaxed loads and stores, no read-modify-write), and the readers
+* merge a consistent enough copy with mergeInto() while it is being recorded.
+*/
+class AtomicHistogram {
+ public:
+  void record(const int64_t &value); //!< only from the writer thread
+  void mergeInto(Histogram &histogram) const;
+
+ private:
+  template <typename T>
+  static void add(std::atomic<T> &counter, const T &value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+
+  std::array<std::atomic<uint32_t>, Histogram::BUCKETS> counts_ {};
+  std::atomic<int64_t> count_ {0};
+  std::atomic<int64_t> min_ {std::numeric_limits<int64_t>::max()};
+  std::atomic<int64_t> max_ {0};
+  std::atomic<int64_t> sum_ {0};
+};
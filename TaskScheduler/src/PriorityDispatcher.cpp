@@ -0,0 +1,82 @@
+#include "PriorityDispatcher.h"
+#include "TaskScheduler.h"
+
+#include <numeric>
+#include <stdexcept>
+
+PriorityDispatcher::PriorityDispatcher(boost::asio::io_context &io_ctx, const int &workers_nb): io_ctx_(io_ctx), workers_nb_(workers_nb) {
+}
+
+void PriorityDispatcher::reserveWorkers(const TaskPriority &priority, const int &workers_nb) {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  std::array<int, CLASSES> reserved = reserved_;
+  reserved[static_cast<size_t>(priority)] = workers_nb;
+  if (workers_nb < 0 || std::accumulate(reserved.begin(), reserved.end(), 0) >= workers_nb_) {
+    throw std::invalid_argument("PriorityDispatcher: the reserved workers must leave one worker at least");
+  }
+  reserved_ = reserved;
+}
+
+void PriorityDispatcher::submit(Task *task, const TaskPriority &priority, const std::chrono::steady_clock::time_point &deadline) {
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    queues_[static_cast<size_t>(priority)].push(Entry{deadline, sequence_++, task});
+  }
+  boost::asio::post(io_ctx_, [this]() {
+    drain();
+  });
+}
+
+size_t PriorityDispatcher::size() {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  size_t size = 0;
+  for (const auto &queue : queues_) {
+    size += queue.size();
+  }
+  return size;
+}
+
+void PriorityDispatcher::drain() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    // the most urgent class allowed to run, a drain with nothing to run returns right away
+    size_t priority = 0;
+    while (priority < CLASSES && (queues_[priority].empty() || !isAllowed(priority))) {
+      ++priority;
+    }
+    if (priority == CLASSES) {
+      return;
+    }
+
+    Task *task = queues_[priority].top().task;
+    queues_[priority].pop();
+    // the expiry runs on the strand of the task, it counts as busy until it returns
+    ++busy_[priority];
+    lock.unlock();
+    boost::asio::post(task->strand(), [this, task, priority]() {
+      task->onExpiry(boost::system::error_code());
+      {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        --busy_[priority];
+      }
+      drain();
+    });
+    lock.lock();
+  }
+}
+
+bool PriorityDispatcher::isAllowed(const size_t &priority) const {
+  // the workers running a class or any less urgent one must leave the reservations of the more urgent ones
+  int available = workers_nb_;
+  for (size_t k = 0; k <= priority; ++k) {
+    int busy = 0;
+    for (size_t i = k; i < CLASSES; ++i) {
+      busy += busy_[i];
+    }
+    if (busy >= available) {
+      return false;
+    }
+    available -= reserved_[k];
+  }
+  return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <queue>
+#include <chrono>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/utility.hpp> // boost::noncopyable
+
+class Task;
+
+/**
+* @brief TaskPriority is the priority class of a task, from the most to the least urgent
+*/
+enum class TaskPriority {
+  High, //!< latency-critical tasks, e.g. heartbeats
+  Normal,
+  Low //!< maintenance tasks
+};
+
+/**
+* @brief PriorityDispatcher runs the expired tasks of a TaskScheduler by priority class, and by earliest deadline
+* first within a class, instead of the io_context completion order.
+* A class can reserve workers: the less urgent classes never occupy them, so the tasks of that class
+* keep a bounded latency while the others overload the scheduler.
+*/
+class PriorityDispatcher: boost::noncopyable {
+ public:
+  static constexpr size_t CLASSES = 3;
+
+  PriorityDispatcher(boost::asio::io_context &io_ctx, const int &workers_nb);
+
+  /**
+  * @brief Reserve workers for a class, the reservations of all the classes must leave one worker at least.
+  * It throws std::invalid_argument otherwise.
+  */
+  void reserveWorkers(const TaskPriority &priority, const int &workers_nb);
+  /**
+  * @brief Queue an expired task, it is posted to the task's strand once a worker is allowed to run its class.
+  * The worker counts as busy from then until the expiry returns.
+  */
+  void submit(Task *task, const TaskPriority &priority, const std::chrono::steady_clock::time_point &deadline);
+  size_t size(); //!< number of tasks waiting for a worker
+
+ private:
+  struct Entry {
+    std::chrono::steady_clock::time_point deadline;
+    uint64_t sequence; //!< FIFO among the same deadlines
+    Task *task;
+
+    bool operator>(const Entry &other) const {
+      return deadline > other.deadline || (deadline == other.deadline && sequence > other.sequence);
+    }
+  };
+  using EntryQueue = std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>>;
+
+  void drain(); // post the queued tasks until none is allowed
+  bool isAllowed(const size_t &priority) const; // not thread safe, 'mutex_' must be locked
+
+  boost::asio::io_context &io_ctx_;
+  const int workers_nb_;
+  std::array<int, CLASSES> reserved_ {};
+  std::array<int, CLASSES> busy_ {}; //!< expiries of every class posted and not returned yet
+  std::array<EntryQueue, CLASSES> queues_;
+  uint64_t sequence_ {0};
+  std::mutex mutex_;
+};
@@ -0,0 +1,46 @@
+#include "SchedulerStats.h"
+
+thread_local SchedulerStats::Worker *SchedulerStats::current_worker_ = nullptr;
+
+SchedulerStats::SchedulerStats(const int &workers_nb) {
+  for (int i = 0; i < workers_nb; ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+}
+
+void SchedulerStats::attachWorker(const int &worker_idx) {
+  current_worker_ = workers_.at(worker_idx).get();
+}
+
+void SchedulerStats::detachWorker() {
+  current_worker_ = nullptr;
+}
+
+void SchedulerStats::recordExecution(const int64_t &execution_us, const bool &succeded) {
+  Worker *worker = current_worker_;
+  if (!worker) {
+    return;
+  }
+  std::atomic<int64_t> &counter = succeded ? worker->succeded : worker->failed;
+  counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  worker->execution_us.record(execution_us);
+}
+
+void SchedulerStats::recordLateness(const int64_t &lateness_us) {
+  Worker *worker = current_worker_;
+  if (worker) {
+    worker->lateness_us.record(lateness_us);
+  }
+}
+
+SchedulerStats::Snapshot SchedulerStats::snapshot() const {
+  Snapshot snapshot;
+  for (const auto &worker : workers_) {
+    snapshot.succeded += worker->succeded.load(std::memory_order_relaxed);
+    snapshot.failed += worker->failed.load(std::memory_order_relaxed);
+    worker->execution_us.mergeInto(snapshot.execution_us);
+    worker->lateness_us.mergeInto(snapshot.lateness_us);
+  }
+  snapshot.executed = snapshot.succeded + snapshot.failed;
+  return snapshot;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <boost/utility.hpp> // boost::noncopyable
+
+#include "Histogram.h"
+
+/**
+* @brief SchedulerStats aggregates the executions of all the tasks of a TaskScheduler.
+* Every worker thread records in its own slot, without locks nor contention with the other workers,
+* and snapshot() merges the slots while they are being recorded.
+*/
+class SchedulerStats: boost::noncopyable {
+ public:
+  /**
+  * @brief Snapshot of the executions since the scheduler was created
+  */
+  struct Snapshot {
+    int64_t executed {0}; //!< number of executions, succeded or failed
+    int64_t succeded {0};
+    int64_t failed {0};
+    int64_t in_flight {0}; //!< executions admitted and not completed yet, with an admission limit only
+    int64_t peak_in_flight {0};
+    int64_t rejected {0}; //!< executions rejected by the admission limit
+    Histogram execution_us; //!< duration of the callbacks, in microseconds
+    Histogram lateness_us; //!< delay of the executions from their expected time, in microseconds
+  };
+
+  explicit SchedulerStats(const int &workers_nb);
+
+  /**
+  * @brief The calling thread records in the slot 'worker_idx' until detachWorker() is called.
+  * A thread is attached to a single scheduler at once.
+  */
+  void attachWorker(const int &worker_idx);
+  static void detachWorker();
+
+  // record in the slot of the calling thread, ignored if it is not attached
+  static void recordExecution(const int64_t &execution_us, const bool &succeded);
+  static void recordLateness(const int64_t &lateness_us);
+
+  Snapshot snapshot() const;
+
+ private:
+  struct alignas(64) Worker {
+    std::atomic<int64_t> succeded {0};
+    std::atomic<int64_t> failed {0};
+    AtomicHistogram execution_us;
+    AtomicHistogram lateness_us;
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  static thread_local Worker *current_worker_;
+};
@@ -0,0 +1,134 @@
+#include "SimulatedClock.h"
+
+#include <cassert>
+#include <algorithm>
+
+SimulatedClock::Timer::Timer(SimulatedClock &clock, const TaskStrand &strand): clock_(clock), strand_(strand) {
+}
+
+SimulatedClock::Timer::~Timer() {
+  const std::lock_guard<std::mutex> lock(clock_.mutex_);
+  if (pending_) {
+    clock_.queue_.erase(entry_);
+  }
+}
+
+size_t SimulatedClock::Timer::expiresFromNow(const int64_t &microseconds) {
+  size_t cancelled_nb = cancel();
+  const std::lock_guard<std::mutex> lock(clock_.mutex_);
+  expiry_ = clock_.now() + std::chrono::microseconds(microseconds);
+  return cancelled_nb;
+}
+
+size_t SimulatedClock::Timer::expiresAt(const boost::posix_time::ptime &expiry_time) {
+  int64_t from_now_us = (expiry_time - clock_.universalTime()).total_microseconds();
+  return expiresFromNow(from_now_us);
+}
+
+void SimulatedClock::Timer::asyncWait(Handler handler) {
+  const std::lock_guard<std::mutex> lock(clock_.mutex_);
+  assert(!pending_);
+  handler_ = std::move(handler);
+  // an expiry in the past is dispatched by the next advance()
+  entry_ = clock_.queue_.emplace(expiry_, this);
+  pending_ = true;
+}
+
+size_t SimulatedClock::Timer::cancel() {
+  Handler handler;
+  {
+    const std::lock_guard<std::mutex> lock(clock_.mutex_);
+    if (!pending_) {
+      return 0;
+    }
+    clock_.queue_.erase(entry_);
+    pending_ = false;
+    handler = std::move(handler_);
+    handler_ = nullptr;
+  }
+  boost::asio::post(strand_, std::bind(std::move(handler), boost::asio::error::operation_aborted));
+  return 1;
+}
+
+const TaskStrand &SimulatedClock::Timer::strand() const {
+  return strand_;
+}
+
+SimulatedClock::Clock::time_point SimulatedClock::Timer::now() const {
+  return clock_.now();
+}
+
+boost::posix_time::ptime SimulatedClock::Timer::universalTime() const {
+  return clock_.universalTime();
+}
+
+/////////////
+SimulatedClock::SimulatedClock(boost::asio::io_context &io_ctx):
+  io_ctx_(io_ctx),
+  origin_(Clock::now()),
+  origin_utc_(boost::posix_time::microsec_clock::universal_time()) {
+}
+
+SimulatedClock::Clock::time_point SimulatedClock::now() const {
+  return origin_ + std::chrono::microseconds(elapsed_us_.load(std::memory_order_acquire));
+}
+
+boost::posix_time::ptime SimulatedClock::universalTime() const {
+  return origin_utc_ + boost::posix_time::microseconds(elapsed_us_.load(std::memory_order_acquire));
+}
+
+std::unique_ptr<SimulatedClock::Timer> SimulatedClock::createTimer() {
+  return std::make_unique<Timer>(*this, boost::asio::make_strand(io_ctx_));
+}
+
+size_t SimulatedClock::size() {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  return queue_.size();
+}
+
+size_t SimulatedClock::advance(const Clock::duration &duration) {
+  const int64_t target_us = elapsed_us_ + std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+  size_t dispatched_nb = 0;
+  poll(); // the handlers posted before, e.g. the first wait of a task
+  while (true) {
+    {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      if (queue_.empty()) {
+        break;
+      }
+      int64_t expiry_us = std::chrono::duration_cast<std::chrono::microseconds>(queue_.begin()->first - origin_).count();
+      if (expiry_us > target_us) {
+        break;
+      }
+      // the time never goes back, a timer expired in the past fires now
+      elapsed_us_.store(std::max(elapsed_us_.load(std::memory_order_relaxed), expiry_us), std::memory_order_release);
+
+      // all the timers of the earliest expiry are dispatched together
+      const Clock::time_point expiry = queue_.begin()->first;
+      while (!queue_.empty() && queue_.begin()->first == expiry) {
+        Timer *timer = queue_.begin()->second;
+        queue_.erase(queue_.begin());
+        timer->pending_ = false;
+        expired_.emplace_back(timer->strand_, std::move(timer->handler_));
+        timer->handler_ = nullptr;
+      }
+    }
+
+    for (auto &it : expired_) {
+      boost::asio::post(it.first, std::bind(std::move(it.second), boost::system::error_code()));
+    }
+    dispatched_nb += expired_.size();
+    expired_.clear();
+    poll();
+  }
+  elapsed_us_.store(std::max(elapsed_us_.load(std::memory_order_relaxed), target_us), std::memory_order_release);
+  return dispatched_nb;
+}
+
+void SimulatedClock::poll() {
+  // the io_context stops by itself once it has run out of work
+  if (io_ctx_.stopped()) {
+    io_ctx_.restart();
+  }
+  io_ctx_.poll();
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <chrono>
+
+#include "TaskTimer.h"
+
+/**
+* @brief SimulatedClock is a virtual clock for the tests and the simulations: its time only moves forward
+* with advance(), which dispatches the expired timers in expiry order and runs their handlers on the calling
+* thread, so a day of schedule is replayed in milliseconds and deterministically.
+* It starts at the real time of its creation. The Timers must be destroyed before their SimulatedClock.
+*/
+class SimulatedClock: boost::noncopyable {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Handler = TaskTimer::Handler;
+  class Timer;
+
+ private:
+  using Queue = std::multimap<Clock::time_point, Timer *, std::less<Clock::time_point>, TaskAllocator<std::pair<const Clock::time_point, Timer *>>>;
+
+ public:
+  /**
+  * @brief Timer is an entry of the SimulatedClock queue, it is also the clock of its task
+  */
+  class Timer: public TaskTimer, public Pooled<Timer> {
+   public:
+    Timer(SimulatedClock &clock, const TaskStrand &strand);
+    ~Timer() override; // pending wait is dropped without invoking its handler
+
+    size_t expiresFromNow(const int64_t &microseconds) override;
+    size_t expiresAt(const boost::posix_time::ptime &expiry_time) override;
+    void asyncWait(Handler handler) override;
+    size_t cancel() override;
+    const TaskStrand &strand() const override;
+    Clock::time_point now() const override;
+    boost::posix_time::ptime universalTime() const override;
+
+   private:
+    friend class SimulatedClock;
+
+    SimulatedClock &clock_;
+    TaskStrand strand_;
+    Clock::time_point expiry_;
+    Handler handler_;
+    bool pending_ {false};
+    Queue::iterator entry_; //!< valid while pending
+  };
+
+  /**
+  * @param io_ctx where the handlers are posted, advance() polls it
+  */
+  explicit SimulatedClock(boost::asio::io_context &io_ctx);
+
+  Clock::time_point now() const;
+  boost::posix_time::ptime universalTime() const; //!< in UTC (Absolut Time)
+
+  std::unique_ptr<Timer> createTimer(); //!< on a new strand of the io_context
+  size_t size(); //!< number of pending timers
+
+  /**
+  * @brief Move the time forward by 'duration': every timer expiring until then is dispatched at its expiry time,
+  * and the handlers are run before the time moves on, the waits they start included.
+  * It must not be called from a handler. The io_context should not be run by other threads meanwhile,
+  * otherwise the handlers run there and the time may move on before they complete.
+  * @return the number of timers dispatched
+  */
+  size_t advance(const Clock::duration &duration);
+
+ private:
+  void poll(); // run the ready handlers
+
+  boost::asio::io_context &io_ctx_;
+  const Clock::time_point origin_;
+  const boost::posix_time::ptime origin_utc_;
+  std::atomic<int64_t> elapsed_us_ {0};
+  Queue queue_; //!< by expiry, the timers of the same expiry in the order of their waits
+  std::vector<std::pair<TaskStrand, Handler>> expired_; //!< only used by advance(), kept to recycle its capacity
+  std::mutex mutex_;
+};
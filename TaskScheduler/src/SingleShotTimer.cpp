@@ -0,0 +1,94 @@
+#include "SingleShotTimer.h"
+
+SingleShotService &SingleShotService::instance() {
+  static SingleShotService service;
+  return service;
+}
+
+SingleShotService::SingleShotService():
+  work_(boost::asio::make_work_guard(io_ctx_)),
+  wheel_(io_ctx_),
+  strand_(boost::asio::make_strand(io_ctx_)),
+  thread_([this]() {
+  io_ctx_.run();
+}) {
+}
+
+SingleShotService::~SingleShotService() {
+  work_.reset();
+  io_ctx_.stop();
+  thread_.join();
+}
+
+std::unique_ptr<TimingWheel::Timer> SingleShotService::createTimer() {
+  return std::make_unique<TimingWheel::Timer>(wheel_, strand_);
+}
+
+/////////////
+SingleShotTimer::SingleShotTimer():
+  state_(std::make_shared<State>()),
+  // the service is created first, so a static SingleShotTimer is destroyed before it
+  timer_(SingleShotService::instance().createTimer()) {
+}
+
+SingleShotTimer::SingleShotTimer(SimulatedClock &clock):
+  state_(std::make_shared<State>()),
+  timer_(clock.createTimer()) {
+}
+
+SingleShotTimer::~SingleShotTimer() {
+  shutdown();
+}
+
+void SingleShotTimer::scheduleTask(unsigned int milliseconds, std::function<void()> callback) {
+  const std::lock_guard<std::mutex> lock(state_->mutex_);
+  uint64_t generation = ++state_->generation_;
+  state_->callback_ = std::move(callback);
+  timer_->expiresFromNow(milliseconds * 1'000LL);
+  std::shared_ptr<State> state = state_;
+  timer_->asyncWait([state, generation](const boost::system::error_code & e) {
+    onExpiry(state, generation, e);
+  });
+}
+
+bool SingleShotTimer::cancel() {
+  const std::lock_guard<std::mutex> lock(state_->mutex_);
+  ++state_->generation_;
+  state_->callback_ = nullptr;
+  // the handler may have been dispatched already, the generation discards it
+  return timer_->cancel() > 0;
+}
+
+void SingleShotTimer::shutdown() {
+  cancel();
+  std::unique_lock<std::mutex> locker(state_->mutex_);
+  // the callback itself may shut its timer down, it must not wait for its own completion
+  state_->cv_.wait(locker, [this]() {
+    return !state_->running_ || state_->running_thread_ == std::this_thread::get_id();
+  });
+}
+
+void SingleShotTimer::onExpiry(const std::shared_ptr<State> &state, const uint64_t &generation, const boost::system::error_code &e) {
+  std::function<void()> callback;
+  {
+    const std::lock_guard<std::mutex> lock(state->mutex_);
+    if (e == boost::asio::error::operation_aborted || generation != state->generation_) {
+      return;
+    }
+    callback = std::move(state->callback_);
+    state->callback_ = nullptr;
+    state->running_ = true;
+    state->running_thread_ = std::this_thread::get_id();
+  }
+
+  // the callback may destroy the SingleShotTimer, only 'state' is used afterwards
+  try {
+    callback();
+  } catch (...) {
+    // it would stop the thread of the shared service
+  }
+
+  const std::lock_guard<std::mutex> lock(state->mutex_);
+  state->running_ = false;
+  state->cv_.notify_all();
+}
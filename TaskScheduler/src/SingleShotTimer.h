@@ -0,0 +1,70 @@
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+#include "TimingWheel.h"
+#include "SimulatedClock.h"
+
+/**
+* @brief SingleShotService is the timer service shared by all the SingleShotTimers of the process:
+* a single thread running a TimingWheel, created on first use. The callbacks are invoked on its thread,
+* so a slow callback delays the others.
+*/
+class SingleShotService: boost::noncopyable {
+ public:
+  static SingleShotService &instance();
+  ~SingleShotService();
+
+  std::unique_ptr<TimingWheel::Timer> createTimer();
+
+ private:
+  SingleShotService();
+
+  boost::asio::io_context io_ctx_;
+  boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_;
+  TimingWheel wheel_;
+  TaskStrand strand_; //!< the service has a single thread, all the timers share it
+  std::thread thread_;
+};
+
+/**
+* @brief SingleShotTimer invokes a callback once after a timeout. It is an entry of the shared
+* SingleShotService, it creates no thread: scheduling and cancelling are O(1).
+* Scheduling again re-arms it, the pending callback is dropped. The callback may destroy the SingleShotTimer
+* (e.g. IVSInterfaceImpl::streamReopenHandlerAvigilon() deletes its owner).
+* On a SimulatedClock, the callback is invoked by SimulatedClock::advance() once the virtual timeout has elapsed.
+*/
+class SingleShotTimer: boost::noncopyable {
+ public:
+  SingleShotTimer();
+  explicit SingleShotTimer(SimulatedClock &clock); //!< the timer must be destroyed before the clock
+  ~SingleShotTimer(); //!< shutdown()
+
+  void scheduleTask(unsigned int milliseconds, std::function<void()> callback);
+  bool cancel(); //!< return false if there was no pending callback
+  /**
+  * @brief Cancel the pending callback and wait for the running one, unless called from the callback itself.
+  * A later scheduleTask() arms the timer again.
+  */
+  void shutdown();
+
+ private:
+  // shared with the pending handler, which may outlive the timer
+  struct State {
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::function<void()> callback_;
+    uint64_t generation_ {0}; //!< bumped by every schedule and cancel, a stale handler is ignored
+    bool running_ {false};
+    std::thread::id running_thread_; //!< where the callback is running
+  };
+
+  static void onExpiry(const std::shared_ptr<State> &state, const uint64_t &generation, const boost::system::error_code &e);
+
+  std::shared_ptr<State> state_;
+  std::unique_ptr<TaskTimer> timer_;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <new>
+#include <cstddef>
+#include <utility>
+#include <functional> // std::bad_function_call
+#include <type_traits>
+
+/**
+* @brief TaskCallback is a move-only 'void()' callable, like std::function but with a larger inline buffer:
+* callables up to INLINE_SIZE bytes (lambdas capturing a few references or a std::function) are stored
+* in place, so wrapping them does not allocate. Bigger callables are moved to the heap.
+*/
+class TaskCallback {
+ public:
+  static const size_t INLINE_SIZE = 48;
+
+  TaskCallback() = default;
+
+  template <typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, TaskCallback>::value>>
+  TaskCallback(F &&callable) {
+    using Callable = std::decay_t<F>;
+    if constexpr (isInline<Callable>()) {
+      new (&storage_) Callable(std::forward<F>(callable));
+      ops_ = &inlineOps<Callable>;
+    } else {
+      new (&storage_) Callable *(new Callable(std::forward<F>(callable)));
+      ops_ = &heapOps<Callable>;
+    }
+  }
+
+  TaskCallback(TaskCallback &&other) noexcept {
+    moveFrom(other);
+  }
+
+  TaskCallback &operator=(TaskCallback &&other) noexcept {
+    if (this != &other) {
+      reset();
+      moveFrom(other);
+    }
+    return *this;
+  }
+
+  ~TaskCallback() {
+    reset();
+  }
+
+  void operator()() {
+    if (!ops_) {
+      throw std::bad_function_call();
+    }
+    ops_->invoke(&storage_);
+  }
+
+  explicit operator bool() const {
+    return ops_ != nullptr;
+  }
+
+ private:
+  struct Ops {
+    void (*invoke)(void *storage);
+    void (*move)(void *dst, void *src); // move construct 'dst' and destroy 'src'
+    void (*destroy)(void *storage);
+  };
+
+  template <typename Callable>
+  static constexpr bool isInline() {
+    return sizeof(Callable) <= INLINE_SIZE && alignof(std::max_align_t) % alignof(Callable) == 0 &&
+           std::is_nothrow_move_constructible<Callable>::value;
+  }
+
+  template <typename Callable>
+  static constexpr Ops inlineOps = {
+    [](void *storage) {
+      (*static_cast<Callable *>(storage))();
+    },
+    [](void *dst, void *src) {
+      new (dst) Callable(std::move(*static_cast<Callable *>(src)));
+      static_cast<Callable *>(src)->~Callable();
+    },
+    [](void *storage) {
+      static_cast<Callable *>(storage)->~Callable();
+    }
+  };
+
+  template <typename Callable>
+  static constexpr Ops heapOps = {
+    [](void *storage) {
+      (**static_cast<Callable **>(storage))();
+    },
+    [](void *dst, void *src) {
+      new (dst) Callable *(*static_cast<Callable **>(src));
+    },
+    [](void *storage) {
+      delete *static_cast<Callable **>(storage);
+    }
+  };
+
+  void moveFrom(TaskCallback &other) {
+    if (other.ops_) {
+      other.ops_->move(&storage_, &other.storage_);
+      ops_ = other.ops_;
+      other.ops_ = nullptr;
+    }
+  }
+
+  void reset() {
+    if (ops_) {
+      ops_->destroy(&storage_);
+      ops_ = nullptr;
+    }
+  }
+
+  std::aligned_storage_t<INLINE_SIZE, alignof(std::max_align_t)> storage_;
+  const Ops *ops_ {nullptr};
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <new>
+
+#include <boost/pool/pool_alloc.hpp>
+#include <boost/pool/singleton_pool.hpp>
+
+/**
+* @brief TaskAllocator is the allocator of the tasks, used with std::allocate_shared: the task and its
+* shared_ptr control block come from a free list of equally sized blocks, which is never returned to the system.
+*/
+template <typename T>
+using TaskAllocator = boost::fast_pool_allocator<T>;
+
+/**
+* @brief Pooled gives to the class T (CRTP) an operator new/delete backed by a boost::singleton_pool,
+* so the objects created and destroyed at high rates recycle their memory.
+* Derived classes of a different size fall back to the global operator new.
+*/
+template <typename T>
+class Pooled {
+ public:
+  static void *operator new(size_t size) {
+    if (size != sizeof(T)) {
+      return ::operator new(size);
+    }
+    void *ptr = boost::singleton_pool<PoolTag, sizeof(T)>::malloc();
+    if (!ptr) {
+      throw std::bad_alloc();
+    }
+    return ptr;
+  }
+
+  static void operator delete(void *ptr, size_t size) {
+    if (size != sizeof(T)) {
+      ::operator delete(ptr);
+      return;
+    }
+    boost::singleton_pool<PoolTag, sizeof(T)>::free(ptr);
+  }
+
+ private:
+  struct PoolTag {}; // one pool per class T, sizeof(T) can only be taken once T is complete
+};
@@ -0,0 +1,153 @@
+#include "TaskRegistry.h"
+
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+
+TaskId TaskRegistry::insert(std::shared_ptr<Task> task) {
+  // spread the producer threads over the shards
+  static std::atomic<unsigned int> next_shard {0};
+  thread_local const unsigned int shard_idx = next_shard++ % SHARDS;
+
+  Shard &shard = shards_[shard_idx];
+  const std::lock_guard<std::mutex> lock(shard.mutex);
+  uint32_t slot_idx = 0;
+  bool recycled = false;
+  while (!recycled && !shard.free_slots.empty()) {
+    slot_idx = shard.free_slots.back();
+    shard.free_slots.pop_back();
+    recycled = !shard.slots[slot_idx].task;
+  }
+  if (!recycled) {
+    if (shard.slots.size() >= MAX_SLOTS_PER_SHARD) {
+      // a bigger slot index would be truncated by the shift below and alias another task
+      throw std::length_error("TaskRegistry: the shard is full");
+    }
+    slot_idx = static_cast<uint32_t>(shard.slots.size());
+    shard.slots.emplace_back();
+  }
+  Slot &slot = shard.slots[slot_idx];
+  slot.task = std::move(task);
+  ++shard.size;
+
+  TaskId id;
+  id.index = (slot_idx << SHARD_BITS) | shard_idx;
+  id.generation = slot.generation;
+  return id;
+}
+
+bool TaskRegistry::insertAt(const TaskId &id, std::shared_ptr<Task> task) {
+  uint32_t slot_idx = id.index >> SHARD_BITS;
+  if (id.generation == 0 || slot_idx >= MAX_RESTORED_SLOTS_PER_SHARD) {
+    return false;
+  }
+  Shard *shard = shardOf(id);
+  const std::lock_guard<std::mutex> lock(shard->mutex);
+  while (shard->slots.size() <= slot_idx) {
+    // the slots in between are free
+    if (shard->slots.size() < slot_idx) {
+      shard->free_slots.push_back(static_cast<uint32_t>(shard->slots.size()));
+    }
+    shard->slots.emplace_back();
+  }
+  Slot &slot = shard->slots[slot_idx];
+  if (slot.task) {
+    return false;
+  }
+  // the slot stays in free_slots, insert() skips it while it is used: a bulk restore is linear
+  slot.generation = id.generation;
+  slot.task = std::move(task);
+  ++shard->size;
+  return true;
+}
+
+bool TaskRegistry::isRestorable(const TaskId &id) {
+  uint32_t slot_idx = id.index >> SHARD_BITS;
+  if (id.generation == 0 || slot_idx >= MAX_RESTORED_SLOTS_PER_SHARD) {
+    return false;
+  }
+  Shard *shard = shardOf(id);
+  const std::lock_guard<std::mutex> lock(shard->mutex);
+  return slot_idx >= shard->slots.size() || !shard->slots[slot_idx].task;
+}
+
+std::shared_ptr<Task> TaskRegistry::find(const TaskId &id) {
+  Shard *shard = shardOf(id);
+  const std::lock_guard<std::mutex> lock(shard->mutex);
+  Slot *slot = slotOf(*shard, id);
+  return slot ? slot->task : std::shared_ptr<Task>();
+}
+
+std::shared_ptr<Task> TaskRegistry::erase(const TaskId &id) {
+  Shard *shard = shardOf(id);
+  const std::lock_guard<std::mutex> lock(shard->mutex);
+  Slot *slot = slotOf(*shard, id);
+  if (!slot) {
+    return std::shared_ptr<Task>();
+  }
+  return release(*shard, id.index >> SHARD_BITS);
+}
+
+void TaskRegistry::forEach(const std::function<void(const std::shared_ptr<Task> &)> &visitor) {
+  for (Shard &shard : shards_) {
+    const std::lock_guard<std::mutex> lock(shard.mutex);
+    for (const Slot &slot : shard.slots) {
+      if (slot.task) {
+        visitor(slot.task);
+      }
+    }
+  }
+}
+
+size_t TaskRegistry::size() {
+  size_t size = 0;
+  for (Shard &shard : shards_) {
+    const std::lock_guard<std::mutex> lock(shard.mutex);
+    size += shard.size;
+  }
+  return size;
+}
+
+void TaskRegistry::clear() {
+  for (Shard &shard : shards_) {
+    std::vector<std::shared_ptr<Task>> tasks;
+    {
+      const std::lock_guard<std::mutex> lock(shard.mutex);
+      for (uint32_t slot_idx = 0; slot_idx < shard.slots.size(); ++slot_idx) {
+        if (shard.slots[slot_idx].task) {
+          tasks.push_back(release(shard, slot_idx));
+        }
+      }
+    }
+    // tasks are destroyed out of the lock
+  }
+}
+
+TaskRegistry::Shard *TaskRegistry::shardOf(const TaskId &id) {
+  return &shards_[id.index & (SHARDS - 1)];
+}
+
+std::shared_ptr<Task> TaskRegistry::release(Shard &shard, const uint32_t &slot_idx) {
+  Slot &slot = shard.slots[slot_idx];
+  std::shared_ptr<Task> task = std::move(slot.task);
+  slot.task.reset();
+  // invalidate the handles of this slot, zero is skipped when it wraps around
+  if (++slot.generation == 0) {
+    slot.generation = 1;
+  }
+  shard.free_slots.push_back(slot_idx);
+  --shard.size;
+  return task;
+}
+
+TaskRegistry::Slot *TaskRegistry::slotOf(Shard &shard, const TaskId &id) {
+  uint32_t slot_idx = id.index >> SHARD_BITS;
+  if (slot_idx >= shard.slots.size()) {
+    return nullptr;
+  }
+  Slot &slot = shard.slots[slot_idx];
+  if (slot.generation != id.generation || !slot.task) {
+    return nullptr;
+  }
+  return &slot;
+}
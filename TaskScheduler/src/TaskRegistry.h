@@ -0,0 +1,77 @@
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <functional>
+
+#include <boost/utility.hpp> // boost::noncopyable
+
+class Task;
+
+/**
+* @brief TaskId is the handle of a task: the index of its slot in the TaskRegistry and the
+* generation of that slot, so the handle of a purged task never aliases a newer task.
+*/
+struct TaskId {
+  uint32_t index {0};
+  uint32_t generation {0}; //!< zero is never used by a registered task
+
+  bool operator==(const TaskId &other) const {
+    return index == other.index && generation == other.generation;
+  }
+  bool operator!=(const TaskId &other) const {
+    return !(*this == other);
+  }
+  uint64_t value() const {
+    return (static_cast<uint64_t>(generation) << 32) | index;
+  }
+  static TaskId fromValue(const uint64_t &value) {
+    TaskId id;
+    id.index = static_cast<uint32_t>(value);
+    id.generation = static_cast<uint32_t>(value >> 32);
+    return id;
+  }
+};
+
+/**
+* @brief TaskRegistry stores the tasks of a TaskScheduler, indexed by TaskId.
+* It is split in shards with their own lock, a producer thread always inserts in the same shard,
+* so concurrent producers and readers rarely contend. Slots of erased tasks are recycled.
+*/
+class TaskRegistry: boost::noncopyable {
+ public:
+  static const unsigned int SHARD_BITS = 6;
+  static const unsigned int SHARDS = 1 << SHARD_BITS;
+  static const uint32_t MAX_SLOTS_PER_SHARD = 1u << (32 - SHARD_BITS); //!< the slot index has the other bits of TaskId::index
+  static const uint32_t MAX_RESTORED_SLOTS_PER_SHARD = 1u << 20; //!< bound of the slot index of a restored handle, read from a file
+
+  TaskId insert(std::shared_ptr<Task> task); //!< throw std::length_error if the shard of the thread is full
+  bool insertAt(const TaskId &id, std::shared_ptr<Task> task); //!< keep the handle of a restored task, false if its slot is used or out of bounds
+  bool isRestorable(const TaskId &id); //!< insertAt() would succeed
+  std::shared_ptr<Task> find(const TaskId &id); //!< empty if not found
+  std::shared_ptr<Task> erase(const TaskId &id); //!< return the erased task, empty if not found
+  void forEach(const std::function<void(const std::shared_ptr<Task> &)> &visitor); //!< it locks one shard at a time
+  size_t size();
+  void clear();
+
+ private:
+  struct Slot {
+    uint32_t generation {1};
+    std::shared_ptr<Task> task;
+  };
+
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    std::vector<Slot> slots;
+    std::vector<uint32_t> free_slots; //!< it may hold slots used by insertAt() since, they are skipped by insert()
+    size_t size {0};
+  };
+
+  Shard *shardOf(const TaskId &id);
+  // not thread safe, the shard must be locked
+  Slot *slotOf(Shard &shard, const TaskId &id); // nullptr if the handle is stale
+  std::shared_ptr<Task> release(Shard &shard, const uint32_t &slot_idx);
+
+  Shard shards_[SHARDS];
+};
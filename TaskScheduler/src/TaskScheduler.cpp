@@ -3,177 +3,559 @@
 #include <iostream>
 #include <cassert>
 #include <limits>
-
-#include <boost/bind.hpp>
+#include <algorithm>
+#include <unordered_set>
 
 #include <boost/date_time/posix_time/posix_time.hpp>
 
-// uuid
-#include <boost/uuid/uuid.hpp>            // uuid class
-#include <boost/uuid/uuid_generators.hpp> // generators
-#include <boost/uuid/uuid_io.hpp>         // streaming operators etc.
-#include <boost/lexical_cast.hpp>
-
 
-Task::Task(boost::asio::deadline_timer timer, std::function<void()> callback):
+Task::Task(std::unique_ptr<TaskTimer> timer, TaskCallback callback):
   timer_(std::move(timer)),
-  callback_(callback),
+  callback_(std::move(callback)),
   terminated_(false) {
-  // create task uuid
-  static boost::uuids::random_generator uuid_generator; // reuse generator ffor all tasks
-  boost::uuids::uuid uuid = uuid_generator();
-  id_ = boost::lexical_cast<std::string>(uuid);
 }
 
-std::string Task::id() {
-  return id_;
+void Task::start() {
+  const std::lock_guard<std::mutex> lock(mutex_);
+
+  // schedule first one
+  schedule();
+
+  // nothing to execute
+  if (pending_waits_ == 0) {
+    complete();
+  }
 }
 
-Task::Summary Task::summary() {
+void Task::setCompletionHandler(std::function<void()> handler) {
   const std::lock_guard<std::mutex> lock(mutex_);
-  return summary_;
+  completion_handler_ = std::move(handler);
 }
 
-Task::Summary Task::terminate() {
-  {
-    const std::lock_guard<std::mutex> lock(mutex_);
-    terminated_ = true;
-    timer_.cancel();
+void Task::addCompletionWaiter(std::function<void()> waiter) {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  if (completed_) {
+    boost::asio::post(timer_->strand(), std::move(waiter));
+  } else {
+    completion_waiters_.push_back(std::move(waiter));
+  }
+}
+
+void Task::setDispatcher(PriorityDispatcher *dispatcher, const TaskPriority &priority) {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  dispatcher_ = dispatcher;
+  priority_ = priority;
+}
+
+void Task::asyncWait(const std::chrono::steady_clock::time_point &deadline) {
+  ++pending_waits_;
+  wait_deadline_ = deadline;
+  timer_->asyncWait([this](const boost::system::error_code & e) {
+    if (dispatcher_ && e != boost::asio::error::operation_aborted) {
+      dispatcher_->submit(this, priority_, wait_deadline_);
+    } else {
+      onExpiry(e);
+    }
+  });
+}
+
+void Task::setAdmission(AdmissionControl *admission) {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  admission_ = admission;
+}
+
+void Task::setId(const TaskId &task_id) {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  task_id_ = task_id;
+}
+
+const TaskId &Task::id() const {
+  return task_id_;
+}
+
+void Task::saveTask(TaskSnapshot::Record &record) {
+  record.task_id = task_id_.value();
+  record.priority = static_cast<uint8_t>(priority_);
+  record.terminated = terminated_ ? 1 : 0;
+  record.executed = summary_.executed;
+  record.succeded = summary_.succeded;
+  record.failed = summary_.failed;
+  record.cancelled = summary_.cancelled;
+  record.skipped = summary_.skipped;
+  record.rejected = summary_.rejected;
+}
+
+void Task::restore(const TaskSnapshot::Record &record) {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  terminated_ = record.terminated != 0;
+  summary_.executed = record.executed;
+  summary_.succeded = record.succeded;
+  summary_.failed = record.failed;
+  summary_.cancelled = record.cancelled;
+  summary_.skipped = record.skipped;
+  summary_.rejected = record.rejected;
+}
+
+std::chrono::steady_clock::time_point Task::steadyTimeOf(const boost::posix_time::ptime &time) const {
+  int64_t from_now_us = (time - timer_->universalTime()).total_microseconds();
+  return timer_->now() + std::chrono::microseconds(from_now_us);
+}
+
+void Task::onExpiry(const boost::system::error_code &e) {
+  run(e);
+
+  const std::lock_guard<std::mutex> lock(mutex_);
+  // run() has already scheduled the next one, if any
+  releasePending();
+}
+
+void Task::releasePending() {
+  if (--pending_waits_ == 0) {
+    complete();
   }
+}
 
-  timer_.wait();
+void Task::complete() {
+  completed_ = true;
+  // posted to the strand: they are invoked once this handler has returned
+  for (std::function<void()> &waiter : completion_waiters_) {
+    boost::asio::post(timer_->strand(), std::move(waiter));
+  }
+  completion_waiters_.clear();
+  if (completion_handler_) {
+    boost::asio::post(timer_->strand(), completion_handler_);
+  }
+}
 
+const TaskStrand &Task::strand() const {
+  return timer_->strand();
+}
+
+Task::Summary Task::summary() {
   const std::lock_guard<std::mutex> lock(mutex_);
-  int64_t pending = pendingTasks();
-  summary_.cancelled += pending;
   return summary_;
 }
 
-// return true is no aborted
-bool Task::invokeCallback(const boost::system::error_code &e) {
+Task::Summary Task::terminate() {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  terminated_ = true;
+  timer_->cancel();
+
+  addCancelled(pendingTasks());
+  return summary_;
+}
 
+Task::Execution Task::invokeCallback(const boost::system::error_code &e) {
+  Execution execution = admit(e);
+  if (execution == Execution::Executed) {
+    execute();
+  }
+  return execution;
+}
+
+Task::Execution Task::admit(const boost::system::error_code &e) {
   if (e == boost::asio::error::operation_aborted) {
-    std::cout << "onTimeoutRepeat --> asio::error::operation_aborted" << std::endl;
-    return false;
+    return Execution::Aborted;
+  }
+
+  // the expiry could be already queued when the task was terminated
+  if (terminated_) {
+    return Execution::Aborted;
+  }
+
+  // the rejection handler is invoked without holding the lock
+  if (admission_ && !admission_->tryAcquire(task_id_)) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    ++summary_.skipped;
+    ++summary_.rejected;
+    return Execution::Rejected;
   }
+  return Execution::Executed;
+}
 
+void Task::execute() {
   // Timer was not cancelled, take necessary action: invoke callback
+  // the strand guarantees it does not overlap with itself, so it runs without holding the lock
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  bool succeeded = false;
   try {
     callback_();
-    ++summary_.succeded;
-  } catch (const std::exception &e) {
-    ++summary_.failed;
-    std::cerr << "onTimeoutRepeat exception: " << e.what() << std::endl;
+    succeeded = true;
   } catch (...) {
-    ++summary_.failed;
-    std::cerr << "onTimeoutRepeat unknown exception" << std::endl;
+    // the failure is reported by the summary
+  }
+  int64_t execution_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  SchedulerStats::recordExecution(execution_us, succeeded);
+  if (admission_) {
+    admission_->release();
   }
 
+  const std::lock_guard<std::mutex> lock(mutex_);
+  summary_.execution_us.record(execution_us);
+  if (succeeded) {
+    ++summary_.succeded;
+  } else {
+    ++summary_.failed;
+  }
   ++summary_.executed;
+}
+
+void Task::recordLateness(const int64_t &lateness_us) {
+  summary_.lateness_us.record(lateness_us);
+  SchedulerStats::recordLateness(lateness_us);
+}
 
-  return true;
+void Task::addCancelled(const int64_t &count) {
+  const int64_t max = std::numeric_limits<int64_t>::max();
+  summary_.cancelled = (count > max - summary_.cancelled) ? max : summary_.cancelled + count;
 }
 
 /////////////
-TimerTask::TimerTask(boost::asio::deadline_timer timer, std::function<void()> callback, const int64_t &microseconds, const int64_t &repetitions):
-  Task(std::move(timer), callback),
+TimerTask::TimerTask(std::unique_ptr<TaskTimer> timer, TaskCallback callback, const int64_t &microseconds, const int64_t &repetitions,
+                     const TimerMode &mode/* = TimerMode::Relative*/, const CatchUpPolicy &catch_up/* = CatchUpPolicy::FireAll*/,
+                     const OverlapPolicy &overlap/* = OverlapPolicy::Serial*/, const int64_t &max_in_flight/* = 1*/):
+  Task(std::move(timer), std::move(callback)),
   repetitions_(repetitions),
   interval_us_(microseconds),
   prev_interval_us_(microseconds),
-  interval_start_(std::chrono::steady_clock::now()) {
-
-  const std::lock_guard<std::mutex> lock(mutex_);
-
-  // schedule first one
-  schedule();
+  mode_(mode),
+  catch_up_(catch_up),
+  overlap_(overlap),
+  max_in_flight_(overlap == OverlapPolicy::RunConcurrently ? std::max(max_in_flight, static_cast<int64_t>(1)) : 1),
+  interval_start_(timer_->now()),
+  deadline_(interval_start_ + std::chrono::microseconds(interval_us_)) {
 }
 
 void TimerTask::schedule() {
   if (!terminated_ && pendingTasks() > 0) {
-    size_t cancelled_tasks_nb = timer_.expires_from_now(boost::posix_time::microseconds(prev_interval_us_));
+    std::chrono::steady_clock::time_point now = timer_->now();
+    int64_t expiry_us = prev_interval_us_;
+    if (mode_ == TimerMode::Absolute) {
+      // a missed deadline expires right away
+      expiry_us = std::chrono::duration_cast<std::chrono::microseconds>(deadline_ - now).count();
+    } else {
+      deadline_ = now + std::chrono::microseconds(expiry_us);
+    }
+    size_t cancelled_tasks_nb = timer_->expiresFromNow(expiry_us);
     if (cancelled_tasks_nb > 0) {
       std::cerr << "Cancelled 1" << cancelled_tasks_nb << " scheduled tasks" << std::endl;
     }
-    timer_.async_wait(boost::bind(&TimerTask::run, this, boost::asio::placeholders::error));
+    asyncWait(deadline_);
   }
 }
 
 void TimerTask::run(const boost::system::error_code &e) {
-  const std::lock_guard<std::mutex> lock(mutex_);
+  if (overlap_ != OverlapPolicy::Serial) {
+    runOverlapped(e);
+    return;
+  }
+
+  // 'deadline_' is only modified by the handlers of this task, which are serialized by the strand
+  std::chrono::steady_clock::time_point now = timer_->now();
+  int64_t lateness_us = std::chrono::duration_cast<std::chrono::microseconds>(now - deadline_).count();
 
   // invoke callback
-  if (!invokeCallback(e)) {
+  Execution execution = invokeCallback(e);
+  if (execution == Execution::Aborted) {
     return;
   }
 
-  // check & handle elapsed time
-  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
-  std::chrono::steady_clock::duration elapsed = now - interval_start_;
-  int64_t elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
-  int64_t deviation_us = prev_interval_us_ - elapsed_us;
-  int64_t deviation_total_us = interval_us_ - elapsed_us;
-  int64_t tolerance_us = 100'000LL; // 100 ms //interval_us_ / 10; // 10%
-  if (abs(deviation_total_us) > tolerance_us) {
-    std::cerr << "Callback is not called at the right periodicity. Elapsed between calls: " << elapsed_us / 1'000LL << " ms. Desired execution interval: " << interval_us_ / 1'000LL << " ms" << std::endl;
+  const std::lock_guard<std::mutex> lock(mutex_);
+  if (execution == Execution::Executed) {
+    recordLateness(lateness_us);
+  }
+
+  if (mode_ == TimerMode::Absolute) {
+    catchUp();
+  } else {
+    // check & handle elapsed time
+    now = timer_->now();
+    std::chrono::steady_clock::duration elapsed = now - interval_start_;
+    int64_t elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    int64_t deviation_us = prev_interval_us_ - elapsed_us;
+    interval_start_ =  now;
+    prev_interval_us_ = interval_us_ + deviation_us;
   }
-  interval_start_ =  now;
-  prev_interval_us_ = interval_us_ + deviation_us;
 
   // schedule the next one
   schedule();
 }
 
+void TimerTask::catchUp() {
+  deadline_ += std::chrono::microseconds(interval_us_);
+  std::chrono::steady_clock::time_point now = timer_->now();
+  // without a period, no deadline can be skipped: they are all fired
+  if (deadline_ > now || catch_up_ == CatchUpPolicy::FireAll || interval_us_ <= 0) {
+    return;
+  }
+
+  // deadlines already missed, 'deadline_' included
+  int64_t missed_nb = std::chrono::duration_cast<std::chrono::microseconds>(now - deadline_).count() / interval_us_ + 1;
+  int64_t skipped_nb = missed_nb;
+  int64_t pending_nb = pendingTasks();
+  if (catch_up_ == CatchUpPolicy::Coalesce) {
+    // the last missed deadline is executed on behalf of all of them
+    --skipped_nb;
+    --pending_nb;
+  }
+  skipped_nb = std::max(std::min(skipped_nb, pending_nb), static_cast<int64_t>(0));
+  summary_.skipped += skipped_nb;
+  deadline_ += std::chrono::microseconds(interval_us_ * skipped_nb);
+}
+
+void TimerTask::runOverlapped(const boost::system::error_code &e) {
+  if (e == boost::asio::error::operation_aborted || terminated_) {
+    return;
+  }
+
+  std::chrono::steady_clock::time_point now = timer_->now();
+  int64_t lateness_us = std::chrono::duration_cast<std::chrono::microseconds>(now - deadline_).count();
+  bool start = false;
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    if (running_ < max_in_flight_) {
+      start = true;
+      ++running_;
+    } else if (overlap_ == OverlapPolicy::QueueOne && !queued_) {
+      queued_ = true;
+      queued_deadline_ = deadline_;
+    } else {
+      ++summary_.skipped;
+    }
+
+    // the timer keeps its period, whatever the callback does
+    if (mode_ == TimerMode::Absolute) {
+      catchUp();
+    } else {
+      prev_interval_us_ = interval_us_;
+    }
+  }
+
+  if (start) {
+    if (admit(boost::system::error_code()) == Execution::Executed) {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      ++pending_waits_;
+      // out of the strand, so the next expiries are not delayed by the callback
+      boost::asio::post(strand().get_inner_executor(), [this, lateness_us]() {
+        executeOverlapped(lateness_us);
+      });
+    } else {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      --running_;
+    }
+  }
+
+  const std::lock_guard<std::mutex> lock(mutex_);
+  schedule();
+}
+
+void TimerTask::executeOverlapped(int64_t lateness_us) {
+  while (true) {
+    if (terminated_) {
+      // admitted before the task was terminated
+      if (admission_) {
+        admission_->release();
+      }
+      const std::lock_guard<std::mutex> lock(mutex_);
+      addCancelled(queued_ ? 2 : 1);
+      queued_ = false;
+      --running_;
+      releasePending();
+      return;
+    }
+    execute();
+
+    {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      recordLateness(lateness_us);
+      if (!queued_) {
+        --running_;
+        releasePending();
+        return;
+      }
+      // the queued expiry runs right after, on the same worker
+      queued_ = false;
+      lateness_us = std::chrono::duration_cast<std::chrono::microseconds>(timer_->now() - queued_deadline_).count();
+      if (terminated_) {
+        addCancelled(1);
+        --running_;
+        releasePending();
+        return;
+      }
+    }
+
+    if (admit(boost::system::error_code()) != Execution::Executed) {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      --running_;
+      releasePending();
+      return;
+    }
+  }
+}
+
+void TimerTask::save(TaskSnapshot::Writer &writer) {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  TaskSnapshot::Record &record = writer.addRecord();
+  saveTask(record);
+  record.kind = TaskSnapshot::TaskKind::Timer;
+  record.mode = static_cast<uint8_t>(mode_);
+  record.catch_up = static_cast<uint8_t>(catch_up_);
+  record.overlap = static_cast<uint8_t>(overlap_);
+  record.interval_us = interval_us_;
+  record.repetitions = repetitions_;
+  record.max_in_flight = max_in_flight_;
+  int64_t from_now_us = std::chrono::duration_cast<std::chrono::microseconds>(deadline_ - timer_->now()).count();
+  record.next_deadline_us = TaskSnapshot::microsecondsOf(timer_->universalTime()) + from_now_us;
+}
+
+void TimerTask::restore(const TaskSnapshot::Record &record) {
+  Task::restore(record);
+  const std::lock_guard<std::mutex> lock(mutex_);
+  interval_start_ = timer_->now();
+  deadline_ = steadyTimeOf(TaskSnapshot::timeOf(record.next_deadline_us));
+  // TimerMode::Relative resumes after the remaining time of its interval
+  prev_interval_us_ = std::max(std::chrono::duration_cast<std::chrono::microseconds>(deadline_ - interval_start_).count(), static_cast<int64_t>(0));
+}
+
 int64_t TimerTask::pendingTasks() {
   if (repetitions_ <= 0) {
     return std::numeric_limits<int64_t>::max();
   }
 
-  return repetitions_ - summary_.executed;
+  // the admitted and queued executions are not pending anymore
+  return repetitions_ - summary_.executed - summary_.skipped - running_ - (queued_ ? 1 : 0);
 }
 
 /////////////
-CalendarTask::CalendarTask(boost::asio::deadline_timer timer, std::function<void()> callback, const std::queue<boost::posix_time::ptime> &repetitions):
-  Task(std::move(timer), callback),
+CalendarTask::CalendarTask(std::unique_ptr<TaskTimer> timer, TaskCallback callback, const std::queue<boost::posix_time::ptime> &repetitions):
+  Task(std::move(timer), std::move(callback)),
   repetitions_(repetitions) {
-
-  const std::lock_guard<std::mutex> lock(mutex_);
-
-  // schedule first one
-  schedule();
 }
 
 void CalendarTask::schedule() {
   if (!terminated_ && pendingTasks() > 0) {
-    boost::posix_time::ptime expiry_time = repetitions_.front();
+    deadline_ = repetitions_.front();
     repetitions_.pop();
-    size_t cancelled_tasks_nb = timer_.expires_at(expiry_time);
+    size_t cancelled_tasks_nb = timer_->expiresAt(deadline_);
     if (cancelled_tasks_nb > 0) {
       std::cerr << "Cancelled 1" << cancelled_tasks_nb << " scheduled tasks" << std::endl;
     }
-    timer_.async_wait(boost::bind(&CalendarTask::run, this, boost::asio::placeholders::error));
+    asyncWait(steadyTimeOf(deadline_));
   }
 }
 
 void CalendarTask::run(const boost::system::error_code &e) {
-  const std::lock_guard<std::mutex> lock(mutex_);
+  int64_t lateness_us = (timer_->universalTime() - deadline_).total_microseconds();
 
   // invoke callback
-  if (!invokeCallback(e)) {
+  Execution execution = invokeCallback(e);
+  if (execution == Execution::Aborted) {
     return;
   }
 
+  const std::lock_guard<std::mutex> lock(mutex_);
+  if (execution == Execution::Executed) {
+    recordLateness(lateness_us);
+  }
+
   // re-schedule the next one
   schedule();
 }
 
+void CalendarTask::save(TaskSnapshot::Writer &writer) {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  TaskSnapshot::Record &record = writer.addRecord();
+  saveTask(record);
+  record.kind = TaskSnapshot::TaskKind::Calendar;
+  if (pending_waits_ > 0 && !terminated_) {
+    record.instants_offset = writer.addInstant(deadline_);
+    ++record.instants_nb;
+  }
+  std::queue<boost::posix_time::ptime> repetitions = repetitions_;
+  for (; !repetitions.empty(); repetitions.pop()) {
+    uint64_t offset = writer.addInstant(repetitions.front());
+    if (record.instants_nb++ == 0) {
+      record.instants_offset = offset;
+    }
+  }
+}
+
 int64_t CalendarTask::pendingTasks() {
   return repetitions_.size();
 }
 
+/////////////
+SharedCalendarTask::SharedCalendarTask(std::unique_ptr<CalendarBatch::Timer> timer, TaskCallback callback):
+  Task(std::move(timer), std::move(callback)),
+  batch_timer_(static_cast<CalendarBatch::Timer *>(timer_.get())),
+  next_instant_(batch_timer_->batch().nextInstant()) {
+}
+
+void SharedCalendarTask::schedule() {
+  if (!terminated_ && pendingTasks() > 0) {
+    const Calendar &calendar = batch_timer_->batch().calendar();
+    size_t instant = std::min(batch_timer_->batch().nextInstant(), calendar.size() - 1);
+    asyncWait(steadyTimeOf(calendar.at(instant)));
+  }
+}
+
+void SharedCalendarTask::run(const boost::system::error_code &e) {
+  if (e == boost::asio::error::operation_aborted && !terminated_) {
+    // the calendar has been exhausted while this task was running
+    const std::lock_guard<std::mutex> lock(mutex_);
+    summary_.skipped += pendingTasks();
+    next_instant_ = batch_timer_->batch().calendar().size();
+    return;
+  }
+
+  size_t instant = batch_timer_->instant();
+  int64_t lateness_us = (timer_->universalTime() - batch_timer_->batch().calendar().at(instant)).total_microseconds();
+
+  // invoke callback
+  Execution execution = invokeCallback(e);
+  if (execution == Execution::Aborted) {
+    return;
+  }
+
+  const std::lock_guard<std::mutex> lock(mutex_);
+  if (execution == Execution::Executed) {
+    recordLateness(lateness_us);
+  }
+  summary_.skipped += instant - next_instant_;
+  next_instant_ = instant + 1;
+
+  // wait for the next one
+  schedule();
+}
+
+void SharedCalendarTask::save(TaskSnapshot::Writer &writer) {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  TaskSnapshot::Record &record = writer.addRecord();
+  saveTask(record);
+  record.kind = TaskSnapshot::TaskKind::SharedCalendar;
+  const Calendar &calendar = batch_timer_->batch().calendar();
+  record.instants_offset = writer.addCalendar(calendar);
+  record.instants_nb = calendar.size();
+}
+
+int64_t SharedCalendarTask::pendingTasks() {
+  return batch_timer_->batch().calendar().size() - next_instant_;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////////////////////////////
 
-TaskScheduler::TaskScheduler(const int &num_threads): io_ctx_(num_threads), running(false), timer_(io_ctx_) {
+TaskScheduler::TaskScheduler(const int &num_threads, const TimerEngine &engine/* = TimerEngine::DeadlineTimer*/, const PurgePolicy &purge/* = PurgePolicy::Never*/,
+                             const DispatchPolicy &dispatch/* = DispatchPolicy::IoContext*/):
+  io_ctx_(num_threads), num_threads_(std::max(num_threads, 1)), stats_(num_threads_), running(false), strands_(io_ctx_), timer_(io_ctx_), engine_(engine), purge_(purge) {
+  if (engine_ == TimerEngine::TimingWheel) {
+    wheel_ = std::make_unique<TimingWheel>(io_ctx_);
+  } else if (engine_ == TimerEngine::Simulated) {
+    clock_ = std::make_unique<SimulatedClock>(io_ctx_);
+  }
+  if (dispatch == DispatchPolicy::Priority) {
+    dispatcher_ = std::make_unique<PriorityDispatcher>(io_ctx_, num_threads_);
+  }
 }
 
 TaskScheduler::~TaskScheduler() {
@@ -182,10 +564,67 @@ TaskScheduler::~TaskScheduler() {
 }
 
 void TaskScheduler::destroy() {
-  for (auto &it : tasks_) {
-    delete it.second;
-  }
   tasks_.clear();
+
+  const std::lock_guard<std::mutex> lock(coroutines_mutex_);
+  for (void *address : coroutines_) {
+    std::coroutine_handle<>::from_address(address).destroy();
+  }
+  coroutines_.clear();
+}
+
+std::unique_ptr<TaskTimer> TaskScheduler::createTaskTimer() {
+  TaskStrand strand = strands_.acquire();
+  if (engine_ == TimerEngine::TimingWheel) {
+    return std::make_unique<TimingWheel::Timer>(*wheel_, strand);
+  } else if (engine_ == TimerEngine::Simulated) {
+    return std::make_unique<SimulatedClock::Timer>(*clock_, strand);
+  }
+  return std::make_unique<DeadlineTaskTimer>(strand);
+}
+
+TaskId TaskScheduler::startTask(std::shared_ptr<Task> task, const TaskPriority &priority) {
+  TaskId task_id = tasks_.insert(task);
+  startTask(task_id, task, priority);
+  return task_id;
+}
+
+void TaskScheduler::startTask(const TaskId &task_id, const std::shared_ptr<Task> &task, const TaskPriority &priority) {
+  task->setId(task_id);
+  if (dispatcher_) {
+    task->setDispatcher(dispatcher_.get(), priority);
+  }
+  if (admission_) {
+    task->setAdmission(admission_.get());
+  }
+  if (purge_ == PurgePolicy::Completed) {
+    task->setCompletionHandler([this, task_id]() {
+      std::shared_ptr<Task> purged = tasks_.erase(task_id);
+      if (purged) {
+        purged_executed_nb_ += purged->summary().executed;
+        // no more handlers of this task are pending
+        strands_.release(purged->strand());
+      }
+    });
+  }
+  task->start();
+}
+
+std::shared_ptr<Task> TaskScheduler::findTask(const TaskId &task_id) {
+  std::shared_ptr<Task> task = tasks_.find(task_id);
+  if (!task) {
+    //not found
+    throw std::runtime_error("Task not found");
+  }
+  return task;
+}
+
+int64_t TaskScheduler::executedTasks() {
+  int64_t executed_nb = purged_executed_nb_;
+  tasks_.forEach([&executed_nb](const std::shared_ptr<Task> &task) {
+    executed_nb += task->summary().executed;
+  });
+  return executed_nb;
 }
 
 int64_t TaskScheduler::terminate() {
@@ -196,7 +635,7 @@ int64_t TaskScheduler::terminate() {
   }
   assert(!running);
 
-  return executed_handles_nb_;
+  return executedTasks() - executed_tasks_at_run_;
 }
 
 bool TaskScheduler::isRunning() {
@@ -205,10 +644,25 @@ bool TaskScheduler::isRunning() {
 
 void TaskScheduler::run() {
   running = true;
-  executed_handles_nb_ = 0;
+  executed_tasks_at_run_ = executedTasks();
   io_ctx_.restart(); // must called before run() sets stopped flag to false
   boost::asio::io_service::work work(io_ctx_); // forces io_ctx to keep running until explicitly stopped
-  executed_handles_nb_ =  io_ctx_.run();
+
+  // worker pool: the calling thread plus 'num_threads_ - 1' threads
+  std::vector<std::thread> workers;
+  for (int i = 1; i < num_threads_; ++i) {
+    workers.emplace_back([this, i]() {
+      stats_.attachWorker(i);
+      io_ctx_.run();
+      SchedulerStats::detachWorker();
+    });
+  }
+  stats_.attachWorker(0);
+  io_ctx_.run();
+  SchedulerStats::detachWorker();
+  for (auto &worker : workers) {
+    worker.join();
+  }
   running = false;
 }
 
@@ -217,34 +671,219 @@ void TaskScheduler::asyncRun() {
   thread_ = std::thread(&TaskScheduler::run, this);
 }
 
-std::string TaskScheduler::createTimerTask(std::function<void()> callback, const int64_t &milliseconds, const int64_t &repetitions/* = 0*/) {
-  TimerTask *task = new TimerTask(boost::asio::deadline_timer(io_ctx_), callback, milliseconds * 1'000LL, repetitions);
-  tasks_.insert(std::pair(task->id(), task));
-  return task->id();
+TaskId TaskScheduler::createTimerTask(TaskCallback callback, const int64_t &milliseconds, const int64_t &repetitions/* = 0*/,
+                                      const TimerMode &mode/* = TimerMode::Relative*/, const CatchUpPolicy &catch_up/* = CatchUpPolicy::FireAll*/,
+                                      const TaskPriority &priority/* = TaskPriority::Normal*/,
+                                      const OverlapPolicy &overlap/* = OverlapPolicy::Serial*/, const int64_t &max_in_flight/* = 1*/) {
+  return startTask(std::allocate_shared<TimerTask>(TaskAllocator<TimerTask>(), createTaskTimer(), std::move(callback), milliseconds * 1'000LL, repetitions, mode, catch_up,
+                                                   overlap, max_in_flight), priority);
 }
 
-std::string TaskScheduler::createCalendarTask(std::function<void()> callback, const std::queue<boost::posix_time::ptime> &repetitions) {
-  CalendarTask *task = new CalendarTask(boost::asio::deadline_timer(io_ctx_), callback, repetitions);
-  tasks_.insert(std::pair(task->id(), task));
-  return task->id();
+TaskId TaskScheduler::createCalendarTask(TaskCallback callback, const std::queue<boost::posix_time::ptime> &repetitions,
+                                         const TaskPriority &priority/* = TaskPriority::Normal*/) {
+  return startTask(std::allocate_shared<CalendarTask>(TaskAllocator<CalendarTask>(), createTaskTimer(), std::move(callback), repetitions), priority);
 }
 
-Task::Summary TaskScheduler::summaryTask(const std::string &task_id) {
-  auto it = tasks_.find(task_id);
-  if (it == tasks_.end()) {
-    //not found
-    throw std::runtime_error("Task not found");
+std::vector<TaskId> TaskScheduler::createCalendarTasks(std::vector<TaskCallback> callbacks, const std::shared_ptr<const Calendar> &calendar,
+                                                       const TaskPriority &priority/* = TaskPriority::Normal*/) {
+  std::shared_ptr<CalendarBatch> batch = calendarBatch(calendar);
+  std::vector<TaskId> task_ids;
+  task_ids.reserve(callbacks.size());
+  for (auto &callback : callbacks) {
+    auto timer = std::make_unique<CalendarBatch::Timer>(batch, strands_.acquire());
+    task_ids.push_back(startTask(std::allocate_shared<SharedCalendarTask>(TaskAllocator<SharedCalendarTask>(), std::move(timer), std::move(callback)), priority));
+  }
+  return task_ids;
+}
+
+std::shared_ptr<CalendarBatch> TaskScheduler::calendarBatch(const std::shared_ptr<const Calendar> &calendar) {
+  const std::lock_guard<std::mutex> lock(batches_mutex_);
+  std::shared_ptr<CalendarBatch> batch = batches_[calendar.get()].lock();
+  if (!batch) {
+    // forget the batches whose tasks are gone
+    for (auto it = batches_.begin(); it != batches_.end();) {
+      it = it->second.expired() ? batches_.erase(it) : std::next(it);
+    }
+    batch = std::make_shared<CalendarBatch>(calendar, createTaskTimer());
+    batches_[calendar.get()] = batch;
   }
+  return batch;
+}
 
-  return it->second->summary();
+Task::Summary TaskScheduler::summaryTask(const TaskId &task_id) {
+  return findTask(task_id)->summary();
 }
 
-Task::Summary TaskScheduler::terminateTask(const std::string &task_id) {
-  auto it = tasks_.find(task_id);
-  if (it == tasks_.end()) {
-    //not found
-    throw std::runtime_error("Task not found");
+Task::Summary TaskScheduler::terminateTask(const TaskId &task_id) {
+  return findTask(task_id)->terminate();
+}
+
+void TaskScheduler::reserveWorkers(const TaskPriority &priority, const int &workers_nb) {
+  if (!dispatcher_) {
+    throw std::logic_error("Workers can only be reserved with DispatchPolicy::Priority");
+  }
+  dispatcher_->reserveWorkers(priority, workers_nb);
+}
+
+void TaskScheduler::setAdmissionLimit(const int64_t &max_in_flight, AdmissionControl::RejectionHandler handler/* = nullptr*/) {
+  if (admission_) {
+    // the tasks already created refer to it
+    throw std::logic_error("The admission limit is already set");
+  }
+  admission_ = std::make_unique<AdmissionControl>(max_in_flight, std::move(handler));
+}
+
+size_t TaskScheduler::tasksNumber() {
+  return tasks_.size();
+}
+
+SchedulerStats::Snapshot TaskScheduler::statsSnapshot() {
+  SchedulerStats::Snapshot snapshot = stats_.snapshot();
+  if (admission_) {
+    snapshot.in_flight = admission_->inFlight();
+    snapshot.peak_in_flight = admission_->peakInFlight();
+    snapshot.rejected = admission_->rejected();
+  }
+  return snapshot;
+}
+
+size_t TaskScheduler::saveSnapshot(const std::string &path) {
+  TaskSnapshot::Writer writer;
+  tasks_.forEach([&writer](const std::shared_ptr<Task> &task) {
+    task->save(writer);
+  });
+  writer.write(path);
+  return writer.size();
+}
+
+size_t TaskScheduler::restoreSnapshot(const std::string &path, const std::function<TaskCallback(const TaskId &)> &callbacks) {
+  TaskSnapshot::Reader reader(path);
+  // every record is checked before the first task is restored
+  std::unordered_set<uint64_t> task_ids;
+  task_ids.reserve(reader.size());
+  for (size_t i = 0; i < reader.size(); ++i) {
+    const TaskSnapshot::Record &record = reader.record(i);
+    if (record.kind < TaskSnapshot::TaskKind::Timer || record.kind > TaskSnapshot::TaskKind::SharedCalendar ||
+        record.priority > static_cast<uint8_t>(TaskPriority::Low) || record.mode > static_cast<uint8_t>(TimerMode::Absolute) ||
+        record.catch_up > static_cast<uint8_t>(CatchUpPolicy::Coalesce) || record.overlap > static_cast<uint8_t>(OverlapPolicy::RunConcurrently) ||
+        record.interval_us < 0) {
+      throw std::runtime_error("TaskSnapshot: invalid record of the task " + std::to_string(record.task_id) + " in " + path);
+    }
+    if (!task_ids.insert(record.task_id).second) {
+      throw std::runtime_error("TaskSnapshot: the task " + std::to_string(record.task_id) + " appears twice in " + path);
+    }
+    if (!tasks_.isRestorable(TaskId::fromValue(record.task_id))) {
+      throw std::runtime_error("TaskSnapshot: the task " + std::to_string(record.task_id) + " already exists or its handle is invalid");
+    }
   }
 
-  return it->second->terminate();
-}
\ No newline at end of file
+  std::map<uint64_t, std::shared_ptr<const Calendar>> calendars; //!< by offset of their instants
+  size_t restored_nb = 0;
+  for (size_t i = 0; i < reader.size(); ++i) {
+    const TaskSnapshot::Record &record = reader.record(i);
+    TaskId task_id = TaskId::fromValue(record.task_id);
+    TaskCallback callback = callbacks(task_id);
+    if (!callback) {
+      continue;
+    }
+
+    const int64_t *instants = reader.instants(record.instants_offset);
+    std::shared_ptr<Task> task;
+    switch (record.kind) {
+    case TaskSnapshot::TaskKind::Timer:
+      task = std::allocate_shared<TimerTask>(TaskAllocator<TimerTask>(), createTaskTimer(), std::move(callback), record.interval_us, record.repetitions,
+                                             static_cast<TimerMode>(record.mode), static_cast<CatchUpPolicy>(record.catch_up),
+                                             static_cast<OverlapPolicy>(record.overlap), record.max_in_flight);
+      break;
+    case TaskSnapshot::TaskKind::Calendar: {
+      std::queue<boost::posix_time::ptime> repetitions;
+      for (uint64_t j = 0; j < record.instants_nb; ++j) {
+        repetitions.push(TaskSnapshot::timeOf(instants[j]));
+      }
+      task = std::allocate_shared<CalendarTask>(TaskAllocator<CalendarTask>(), createTaskTimer(), std::move(callback), repetitions);
+      break;
+    }
+    case TaskSnapshot::TaskKind::SharedCalendar: {
+      std::shared_ptr<const Calendar> &calendar = calendars[record.instants_offset];
+      if (!calendar) {
+        std::vector<boost::posix_time::ptime> calendar_instants;
+        calendar_instants.reserve(record.instants_nb);
+        for (uint64_t j = 0; j < record.instants_nb; ++j) {
+          calendar_instants.push_back(TaskSnapshot::timeOf(instants[j]));
+        }
+        calendar = std::make_shared<Calendar>(std::move(calendar_instants));
+      }
+      auto timer = std::make_unique<CalendarBatch::Timer>(calendarBatch(calendar), strands_.acquire());
+      task = std::allocate_shared<SharedCalendarTask>(TaskAllocator<SharedCalendarTask>(), std::move(timer), std::move(callback));
+      break;
+    }
+    default:
+      throw std::runtime_error("TaskSnapshot: unknown task kind in " + path);
+    }
+
+    task->restore(record);
+    if (!tasks_.insertAt(task_id, task)) {
+      throw std::runtime_error("TaskSnapshot: the task " + std::to_string(record.task_id) + " already exists");
+    }
+    startTask(task_id, task, static_cast<TaskPriority>(record.priority));
+    ++restored_nb;
+  }
+  return restored_nb;
+}
+
+size_t TaskScheduler::advance(const std::chrono::steady_clock::duration &duration) {
+  SimulatedClock &clock = simulatedClock();
+  // the calling thread is the worker of the simulation
+  stats_.attachWorker(0);
+  size_t dispatched_nb = clock.advance(duration);
+  SchedulerStats::detachWorker();
+  return dispatched_nb;
+}
+
+SimulatedClock &TaskScheduler::simulatedClock() {
+  if (!clock_) {
+    throw std::logic_error("The simulated clock requires TimerEngine::Simulated");
+  }
+  return *clock_;
+}
+
+void TaskScheduler::spawn(CoTask coroutine) {
+  CoTask::Handle handle = coroutine.release();
+  if (!handle) {
+    return;
+  }
+  CoTask::promise_type &promise = handle.promise();
+  promise.owned_timer_ = createTaskTimer();
+  promise.timer_ = promise.owned_timer_.get();
+  promise.scheduler_ = this;
+  {
+    const std::lock_guard<std::mutex> lock(coroutines_mutex_);
+    coroutines_.insert(handle.address());
+  }
+  boost::asio::post(promise.timer_->strand(), [handle]() {
+    handle.resume();
+  });
+}
+
+CompletionAwaiter TaskScheduler::completion(const TaskId &task_id) {
+  return CompletionAwaiter(findTask(task_id));
+}
+
+SleepAwaiter TaskScheduler::at(const boost::posix_time::ptime &expiry_time) {
+  return SleepAwaiter(expiry_time);
+}
+
+size_t TaskScheduler::coroutinesNumber() {
+  const std::lock_guard<std::mutex> lock(coroutines_mutex_);
+  return coroutines_.size();
+}
+
+void TaskScheduler::releaseCoroutine(CoTask::Handle handle) {
+  {
+    const std::lock_guard<std::mutex> lock(coroutines_mutex_);
+    coroutines_.erase(handle.address());
+  }
+  // no more handlers of this coroutine are pending
+  strands_.release(handle.promise().timer_->strand());
+  handle.destroy();
+}
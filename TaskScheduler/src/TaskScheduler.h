@@ -1,15 +1,32 @@
 
 #include <thread>
 #include <functional>
-#include <map>
 #include <queue>
+#include <map>
+#include <chrono>
+#include <unordered_set>
 
 #include <boost/asio.hpp>
 #include <boost/utility.hpp> // boost::noncopyable
 
+#include "TaskTimer.h"
+#include "TimingWheel.h"
+#include "SimulatedClock.h"
+#include "TaskRegistry.h"
+#include "TaskCallback.h"
+#include "Histogram.h"
+#include "SchedulerStats.h"
+#include "Calendar.h"
+#include "CoTask.h"
+#include "SingleShotTimer.h"
+#include "PriorityDispatcher.h"
+#include "AdmissionControl.h"
+#include "TaskSnapshot.h"
+
 /**
 * @brief Task is the assset of task scheduler (TaskScheduler). It is a base class.
-* It wraps the task's callback, id, and a summary of the execution report.
+* It wraps the task's callback, its timer, and a summary of the execution report.
+* The callback is invoked through the timer's strand, so it never overlaps with itself (see OverlapPolicy for the exceptions).
 */
 class Task: boost::noncopyable {
  public:
@@ -21,47 +38,152 @@ class Task: boost::noncopyable {
     int64_t succeded {0}; //!< number of times that callback has been executed successfully without exception
     int64_t failed {0}; //!< number of times that callback has been executed with exception thrown
     int64_t cancelled {0}; //!< number of scheduled tasks have been cancelled
+    int64_t skipped {0}; //!< number of missed deadlines that have not been executed, see CatchUpPolicy and OverlapPolicy
+    int64_t rejected {0}; //!< skipped ones that have been rejected by the scheduler's AdmissionControl
+    CoarseHistogram execution_us; //!< duration of the callback, in microseconds, statsSnapshot() has the full resolution
+    CoarseHistogram lateness_us; //!< delay of the executions from their expected time, in microseconds
   };
 
-  Task(boost::asio::deadline_timer timer, std::function<void()> callback);
+  Task(std::unique_ptr<TaskTimer> timer, TaskCallback callback);
+  virtual ~Task() = default;
 
-  std::string id();
+  void start(); //!< schedule the first execution
   Summary summary();
   Summary terminate();
+  const TaskStrand &strand() const; //!< where the callback is invoked
+
+  /**
+  * @brief The completion handler is posted to the task's strand once the task has no pending execution
+  * anymore: all of them have been executed or the task has been terminated. It must be set before start().
+  */
+  void setCompletionHandler(std::function<void()> handler);
+  /**
+  * @brief The waiter is posted to the task's strand once the task has completed, like the completion handler,
+  * or at once if it has completed already. Any number of waiters may be added, before or after start().
+  */
+  void addCompletionWaiter(std::function<void()> waiter);
+  /**
+  * @brief The expiries are ordered by the dispatcher instead of the io_context, which still runs them on the
+  * timer's strand, so the callback never overlaps with itself. It must be set before start().
+  */
+  void setDispatcher(PriorityDispatcher *dispatcher, const TaskPriority &priority);
+  /**
+  * @brief Every execution must be admitted by 'admission', the rejected ones are skipped. It must be set before start().
+  */
+  void setAdmission(AdmissionControl *admission);
+  void setId(const TaskId &task_id); //!< handle of the task in the scheduler, it must be set before start()
+  const TaskId &id() const;
+
+  virtual void save(TaskSnapshot::Writer &writer) = 0; //!< add the record of the task to the snapshot
+  virtual void restore(const TaskSnapshot::Record &record); //!< the counters and the state of a saved task, it must be called before start()
 
  protected:
-  bool invokeCallback(const boost::system::error_code &e); // return true is no aborted
+  enum class Execution {
+    Aborted, // the wait has been cancelled or the task terminated
+    Rejected, // by the AdmissionControl, it has been counted as skipped
+    Executed
+  };
+
+  Execution invokeCallback(const boost::system::error_code &e); // admit() and execute()
+  Execution admit(const boost::system::error_code &e);
+  void execute(); // invoke the callback of an admitted execution, without holding the lock
+  void releasePending(); // a pending wait or execution is over, not thread safe
+  void complete(); // no execution is pending anymore, post the completion handler and the waiters, not thread safe
+  void saveTask(TaskSnapshot::Record &record); // the common part of the record, not thread safe
+  void recordLateness(const int64_t &lateness_us); // not thread safe
+  void addCancelled(const int64_t &count); // saturated at INT64_MAX, the pending runs of an infinite task, not thread safe
+  void asyncWait(const std::chrono::steady_clock::time_point &deadline); // wait for the timer's expiry, not thread safe
+  std::chrono::steady_clock::time_point steadyTimeOf(const boost::posix_time::ptime &time) const; // time in UTC (Absolut Time), on the timer's clock
 
   virtual void run(const boost::system::error_code &e) = 0;
   virtual int64_t pendingTasks() = 0; // not thread safe
-  virtual void schedule() = 0;
+  virtual void schedule() = 0; // not thread safe
 
-  boost::asio::deadline_timer timer_;
-  std::function<void()> callback_;
-  std::string id_;
+  std::unique_ptr<TaskTimer> timer_;
+  TaskCallback callback_;
+  std::function<void()> completion_handler_;
+  std::vector<std::function<void()>> completion_waiters_;
+  bool completed_ {false};
   std::atomic_bool terminated_ {false};
+  int64_t pending_waits_ {0}; //!< pending waits and overlapped executions (see TimerTask)
   Summary summary_;
-  std::mutex mutex_;
+  AdmissionControl *admission_ {nullptr};
+  std::mutex mutex_; //!< it is not held while the callback runs
+
+ private:
+  friend class PriorityDispatcher;
+
+  void onExpiry(const boost::system::error_code &e);
+
+  PriorityDispatcher *dispatcher_ {nullptr};
+  TaskPriority priority_ {TaskPriority::Normal};
+  std::chrono::steady_clock::time_point wait_deadline_; //!< deadline of the pending expiry, orders the dispatch
+  TaskId task_id_;
+};
+
+/**
+* @brief TimerMode selects how a TimerTask computes its next expiry
+*/
+enum class TimerMode {
+  Relative, //!< next = previous execution + interval, corrected with the last deviation: periods drift under load
+  Absolute //!< next = creation + k * interval, drift-free: the deadlines missed under load follow the CatchUpPolicy
+};
+
+/**
+* @brief CatchUpPolicy selects what a TimerTask in TimerMode::Absolute does with the deadlines it has missed
+*/
+enum class CatchUpPolicy {
+  FireAll, //!< every missed deadline is executed, back to back
+  Skip, //!< missed deadlines are not executed, the task resumes at the next deadline in the future
+  Coalesce //!< missed deadlines are executed once, then the task resumes at the next deadline in the future
+};
+
+/**
+* @brief OverlapPolicy selects what a TimerTask does when it expires while its callback is still running
+*/
+enum class OverlapPolicy {
+  Serial, //!< the next expiry is scheduled once the callback has returned, so it never expires while running
+  SkipIfRunning, //!< the timer keeps its period, an expiry while the callback is running is skipped
+  QueueOne, //!< the timer keeps its period, one expiry while the callback is running is executed after it, the others are skipped
+  RunConcurrently //!< the timer keeps its period, the callback runs concurrently up to 'max_in_flight' times, the others are skipped
 };
 
 /**
 * @brief TimerTask triggers the task every 'interval_us_' microseconds 'repetitions_' times.
-* If 'repetitions_' is zero, the task will be invoked forever
+* If 'repetitions_' is zero, the task will be invoked forever.
+* In TimerMode::Absolute the skipped deadlines count as repetitions.
+* Except with OverlapPolicy::Serial, the callback runs out of the strand, on any worker.
 */
 class TimerTask: public Task {
  public:
-  TimerTask(boost::asio::deadline_timer timer, std::function<void()> callback, const int64_t &microseconds, const int64_t &repetitions);
+  TimerTask(std::unique_ptr<TaskTimer> timer, TaskCallback callback, const int64_t &microseconds, const int64_t &repetitions,
+            const TimerMode &mode = TimerMode::Relative, const CatchUpPolicy &catch_up = CatchUpPolicy::FireAll,
+            const OverlapPolicy &overlap = OverlapPolicy::Serial, const int64_t &max_in_flight = 1);
+
+  void save(TaskSnapshot::Writer &writer) override;
+  void restore(const TaskSnapshot::Record &record) override; //!< it resumes at the saved deadline
 
  protected:
   int64_t pendingTasks() override;;
   void run(const boost::system::error_code &e) override;
   void schedule() override;
+  void catchUp(); // TimerMode::Absolute: move 'deadline_' to the next one, according to 'catch_up_' (FireAll without interval). Not thread safe
+  void runOverlapped(const boost::system::error_code &e); // the expiry of a policy other than OverlapPolicy::Serial
+  void executeOverlapped(int64_t lateness_us); // an admitted execution, then the queued one if any
 
   int64_t repetitions_ {0}; // if (repetitions_ < 1) then repeats for ever
   int64_t interval_us_ {0};
   int64_t prev_interval_us_ {0};
+  const TimerMode mode_;
+  const CatchUpPolicy catch_up_;
+  const OverlapPolicy overlap_;
+  const int64_t max_in_flight_;
+  int64_t running_ {0}; //!< admitted executions not completed yet
+  bool queued_ {false}; //!< OverlapPolicy::QueueOne: an expiry waits for the running callback
+  std::chrono::steady_clock::time_point queued_deadline_;
 
   std::chrono::steady_clock::time_point interval_start_;
+  std::chrono::steady_clock::time_point deadline_; // expected time of the next execution
 };
 
 /**
@@ -70,7 +192,9 @@ class TimerTask: public Task {
 */
 class CalendarTask: public Task {
  public:
-  CalendarTask(boost::asio::deadline_timer timer, std::function<void()> callback, const std::queue<boost::posix_time::ptime> &repetitions);
+  CalendarTask(std::unique_ptr<TaskTimer> timer, TaskCallback callback, const std::queue<boost::posix_time::ptime> &repetitions);
+
+  void save(TaskSnapshot::Writer &writer) override; //!< the instant of the pending wait included
 
  protected:
   int64_t pendingTasks() override;
@@ -78,86 +202,195 @@ class CalendarTask: public Task {
   void schedule() override;
 
   std::queue<boost::posix_time::ptime> repetitions_;
+  boost::posix_time::ptime deadline_; // expected time of the next execution
+};
+
+/**
+* @brief SharedCalendarTask triggers the task at every instant of a Calendar shared with other tasks:
+* all the tasks of the calendar are dispatched as a batch by a single CalendarBatch timer.
+* The instants missed while the task is running are counted as skipped.
+*/
+class SharedCalendarTask: public Task {
+ public:
+  SharedCalendarTask(std::unique_ptr<CalendarBatch::Timer> timer, TaskCallback callback);
+
+  void save(TaskSnapshot::Writer &writer) override; //!< the calendar is saved once for all its tasks
+
+ protected:
+  int64_t pendingTasks() override;
+  void run(const boost::system::error_code &e) override;
+  void schedule() override;
+
+  CalendarBatch::Timer *batch_timer_; // same object as 'timer_'
+  size_t next_instant_ {0}; // index of the next instant to execute
+};
+
+/**
+* @brief TimerEngine selects how the TaskScheduler waits for the expiry of its tasks
+*/
+enum class TimerEngine {
+  DeadlineTimer, //!< every task owns a boost::asio::deadline_timer: O(log n) schedule/cancel in the io_context timer queue
+  TimingWheel, //!< all tasks share a TimingWheel: O(1) schedule/cancel, expiries are dispatched in batches per tick
+  Simulated //!< all tasks share a SimulatedClock: the time only moves with advance(), the scheduler is not run
+};
+
+/**
+* @brief PurgePolicy selects when the TaskScheduler removes the tasks from its registry
+*/
+enum class PurgePolicy {
+  Never, //!< tasks are kept until the scheduler is destroyed, their summary can be queried at any time
+  Completed //!< tasks are removed once completed or terminated, then their TaskId is not found anymore
+};
+
+/**
+* @brief DispatchPolicy selects the order in which the TaskScheduler runs the expired tasks
+*/
+enum class DispatchPolicy {
+  IoContext, //!< in the io_context completion order, the priority of the tasks is ignored
+  Priority //!< by TaskPriority, earliest deadline first within a priority, see PriorityDispatcher
 };
 
 /**
 * @brief TaskScheduler is the interface to schedule tasks: TimerTask or CalendarTask
 */
-// TODO: how to purgue 'tasks_' map
-// never purgue
-// auto-purgue: clean completed task
-// completion-handler: invoke completion handler and there you can remove the task
+/**
+* @brief CompletionAwaiter suspends a CoTask until a task has completed, without blocking the worker,
+* and returns its summary. See TaskScheduler::completion().
+*/
+class CompletionAwaiter {
+ public:
+  explicit CompletionAwaiter(std::shared_ptr<Task> task);
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+  void await_suspend(CoTask::Handle handle);
+  Task::Summary await_resume() const;
+
+ private:
+  std::shared_ptr<Task> task_;
+};
+
 class TaskScheduler {
  public:
   /**
   * Construct with a hint about the required level of concurrency.
   *
   * @param num_threads How many threads it should allow to run simultaneously.
+  * @param engine Timer engine used by all the tasks of this scheduler.
+  * @param purge When the completed tasks are removed.
+  * @param dispatch In which order the expired tasks are run.
   */
-  TaskScheduler(const int &num_threads);
+  TaskScheduler(const int &num_threads, const TimerEngine &engine = TimerEngine::DeadlineTimer, const PurgePolicy &purge = PurgePolicy::Never,
+                const DispatchPolicy &dispatch = DispatchPolicy::IoContext);
   ~TaskScheduler();
 
-  std::string createTimerTask(std::function<void()> callback, const int64_t &milliseconds, const int64_t &repetitions = 0);
-  std::string createCalendarTask(std::function<void()> callback, const std::queue<boost::posix_time::ptime> &repetitions); //!< repetitions must be in UTC (Absolut Time)
-  Task::Summary terminateTask(const std::string &task_id);
+  TaskId createTimerTask(TaskCallback callback, const int64_t &milliseconds, const int64_t &repetitions = 0,
+                         const TimerMode &mode = TimerMode::Relative, const CatchUpPolicy &catch_up = CatchUpPolicy::FireAll,
+                         const TaskPriority &priority = TaskPriority::Normal,
+                         const OverlapPolicy &overlap = OverlapPolicy::Serial, const int64_t &max_in_flight = 1);
+  TaskId createCalendarTask(TaskCallback callback, const std::queue<boost::posix_time::ptime> &repetitions,
+                            const TaskPriority &priority = TaskPriority::Normal); //!< repetitions must be in UTC (Absolut Time)
+  /**
+  * @brief Bulk creation of SharedCalendarTasks, one per callback. All the tasks of the same calendar,
+  * the ones of previous calls included, share a single timer and are dispatched as a batch.
+  */
+  std::vector<TaskId> createCalendarTasks(std::vector<TaskCallback> callbacks, const std::shared_ptr<const Calendar> &calendar,
+                                          const TaskPriority &priority = TaskPriority::Normal);
+  /**
+  * @brief DispatchPolicy::Priority only: the less urgent priorities never occupy the workers reserved for 'priority'.
+  * It throws std::logic_error with DispatchPolicy::IoContext, std::invalid_argument if no worker would be left.
+  */
+  void reserveWorkers(const TaskPriority &priority, const int &workers_nb);
+  /**
+  * @brief Bound the task executions in flight of the whole scheduler, see AdmissionControl.
+  * It must be called before the tasks are created, the ones created before are not bounded.
+  */
+  void setAdmissionLimit(const int64_t &max_in_flight, AdmissionControl::RejectionHandler handler = nullptr);
+  Task::Summary terminateTask(const TaskId &task_id);
 
-  int64_t terminate();
-  void run(); //!< it blocks until is terminated by 'terminate()' invocation
+  /**
+  * @brief Run a coroutine on the scheduler: it starts on a worker, and every co_await of sleep_for() or at()
+  * releases the worker until the expiry. Its frame is destroyed once it has completed, an exception that
+  * escapes it is dropped. The coroutines still suspended when the scheduler is destroyed are destroyed with it.
+  */
+  void spawn(CoTask coroutine);
+  template <typename Rep, typename Period>
+  SleepAwaiter sleep_for(const std::chrono::duration<Rep, Period> &timeout) {
+    return SleepAwaiter(std::chrono::duration_cast<std::chrono::microseconds>(timeout).count());
+  }
+  SleepAwaiter at(const boost::posix_time::ptime &expiry_time); //!< expiry_time must be in UTC (Absolut Time)
+  /**
+  * @brief Awaitable completion of a task: the CoTask resumes on its own strand once all the executions of the task
+  * are over or it has been terminated, even if it is purged meanwhile. It throws std::runtime_error if not found.
+  */
+  CompletionAwaiter completion(const TaskId &task_id);
+  size_t coroutinesNumber(); //!< number of spawned coroutines not completed yet
+
+  int64_t terminate(); //!< return the number of task executions since the last run
+  void run(); //!< it blocks until is terminated by 'terminate()' invocation, the calling thread is one of the 'num_threads' workers
   void asyncRun();
   bool isRunning();
-  Task::Summary summaryTask(const std::string &task_id);
+  Task::Summary summaryTask(const TaskId &task_id);
+  size_t tasksNumber(); //!< number of tasks in the registry
+  SchedulerStats::Snapshot statsSnapshot(); //!< aggregated executions of all the tasks, the purged ones included
+
+  /**
+  * @brief Save the task table to a TaskSnapshot file, the scheduler may be running: every task is saved
+  * in a consistent state, and an execution in progress may be executed again after the restore.
+  * It throws std::runtime_error if the file cannot be written.
+  * @return the number of tasks saved
+  */
+  size_t saveSnapshot(const std::string &path);
+  /**
+  * @brief Re-create the tasks of a TaskSnapshot file with their TaskId, their counters and their remaining
+  * repetitions: 'callbacks' provides the callback of every TaskId, the tasks without callback are not restored.
+  * The file is memory mapped and read in place. Every record is checked first: it throws std::runtime_error,
+  * without restoring any task, if the file is not a valid snapshot (sizes, offsets of the instants, enumerators,
+  * negative interval, a TaskId twice or out of the registry bounds) or a TaskId is already used.
+  * @return the number of tasks restored
+  */
+  size_t restoreSnapshot(const std::string &path, const std::function<TaskCallback(const TaskId &)> &callbacks);
+
+  /**
+  * @brief TimerEngine::Simulated only: move the virtual time forward and run the tasks expiring meanwhile
+  * on the calling thread, see SimulatedClock::advance(). It throws std::logic_error with the other engines.
+  * @return the number of expiries dispatched
+  */
+  size_t advance(const std::chrono::steady_clock::duration &duration);
+  SimulatedClock &simulatedClock(); //!< e.g. for a SingleShotTimer in the same virtual time, throw std::logic_error if not simulated
 
  private:
-  void destroy();
+  friend struct CoTask::FinalAwaiter;
 
+  void destroy();
+  std::unique_ptr<TaskTimer> createTaskTimer();
+  void releaseCoroutine(CoTask::Handle handle); //!< a spawned coroutine has completed
+  TaskId startTask(std::shared_ptr<Task> task, const TaskPriority &priority);
+  void startTask(const TaskId &task_id, const std::shared_ptr<Task> &task, const TaskPriority &priority); //!< already registered
+  std::shared_ptr<Task> findTask(const TaskId &task_id); //!< throw std::runtime_error if not found
+  std::shared_ptr<CalendarBatch> calendarBatch(const std::shared_ptr<const Calendar> &calendar); //!< the running batch of the calendar or a new one
+  int64_t executedTasks();
 
   boost::asio::io_context io_ctx_;
+  const int num_threads_;
+  SchedulerStats stats_;
   std::thread thread_; //!< asyncRun() thread
   std::atomic_bool running {false};
-  std::mutex mutex_;
-  size_t executed_handles_nb_ {0};
+  int64_t executed_tasks_at_run_ {0};
+  std::atomic<int64_t> purged_executed_nb_ {0}; //!< executions of the purged tasks
 
-  std::map<std::string, Task *> tasks_;
+  TaskRegistry tasks_;
+  TaskStrandPool strands_;
   boost::asio::deadline_timer timer_;
+  const TimerEngine engine_;
+  const PurgePolicy purge_;
+  std::unique_ptr<TimingWheel> wheel_; //!< only with TimerEngine::TimingWheel
+  std::unique_ptr<SimulatedClock> clock_; //!< only with TimerEngine::Simulated
+  std::unique_ptr<PriorityDispatcher> dispatcher_; //!< only with DispatchPolicy::Priority
+  std::unique_ptr<AdmissionControl> admission_; //!< only once setAdmissionLimit() has been called
+  std::map<const Calendar *, std::weak_ptr<CalendarBatch>> batches_; //!< owned by the tasks of the calendar
+  std::mutex batches_mutex_;
+  std::unordered_set<void *> coroutines_; //!< frames of the spawned coroutines
+  std::mutex coroutines_mutex_;
 };
-
-//////////////////////////////////////////////////
-//////////////////////////////////////////////////
-
-class SingleShotTimer {
-  std::thread thread_;
-  std::mutex mutex_;
-  std::condition_variable cv_;
-  std::atomic_bool shutdown_ {false};
-
- public:
-  SingleShotTimer() = default;
-  ~SingleShotTimer() {
-    shutdown();
-  }
-
-  void shutdown() {
-    {
-      std::unique_lock<std::mutex> locker(mutex_);
-      shutdown_ = true;
-      cv_.notify_one();
-    }
-    thread_.join();
-  }
-
-  void scheduleTask(unsigned int milliseconds, std::function<void()> callback) {
-    // we need a detached thread, IVSInterfaceImpl::streamReopenHandlerAvigilon() will delete *this
-    thread_ = std::thread([&](unsigned int milliseconds, std::function<void()> callback) {
-      bool timeout = false;
-      {
-        std::unique_lock<std::mutex> locker(mutex_);
-        if (!shutdown_) {
-          timeout = (cv_.wait_for(locker, std::chrono::milliseconds(milliseconds)) == std::cv_status::timeout);
-        }
-      }
-      if (timeout && !shutdown_) {
-        callback();
-      }
-    }, milliseconds, callback);
-  }
-};
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "TaskSnapshot.h"
+#include "Calendar.h"
+
+#include <fstream>
+#include <stdexcept>
+
+#include <boost/interprocess/exceptions.hpp>
+
+namespace TaskSnapshot {
+
+static const boost::posix_time::ptime EPOCH(boost::gregorian::date(1970, 1, 1));
+
+int64_t microsecondsOf(const boost::posix_time::ptime &time) {
+  return (time - EPOCH).total_microseconds();
+}
+
+boost::posix_time::ptime timeOf(const int64_t &microseconds) {
+  return EPOCH + boost::posix_time::microseconds(microseconds);
+}
+
+/////////////
+Record &Writer::addRecord() {
+  records_.emplace_back();
+  return records_.back();
+}
+
+uint64_t Writer::addInstant(const boost::posix_time::ptime &instant) {
+  instants_.push_back(microsecondsOf(instant));
+  return instants_.size() - 1;
+}
+
+uint64_t Writer::addCalendar(const Calendar &calendar) {
+  auto it = calendars_.find(&calendar);
+  if (it != calendars_.end()) {
+    return it->second;
+  }
+  uint64_t offset = instants_.size();
+  instants_.reserve(instants_.size() + calendar.size());
+  for (size_t i = 0; i < calendar.size(); ++i) {
+    instants_.push_back(microsecondsOf(calendar.at(i)));
+  }
+  calendars_.emplace(&calendar, offset);
+  return offset;
+}
+
+void Writer::write(const std::string &path) const {
+  Header header;
+  header.records_nb = records_.size();
+  header.instants_nb = instants_.size();
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(records_.data()), records_.size() * sizeof(Record));
+  file.write(reinterpret_cast<const char *>(instants_.data()), instants_.size() * sizeof(int64_t));
+  file.close();
+  if (!file) {
+    throw std::runtime_error("TaskSnapshot: cannot write " + path);
+  }
+}
+
+size_t Writer::size() const {
+  return records_.size();
+}
+
+/////////////
+Reader::Reader(const std::string &path) {
+  try {
+    file_ = boost::interprocess::file_mapping(path.c_str(), boost::interprocess::read_only);
+    region_ = boost::interprocess::mapped_region(file_, boost::interprocess::read_only);
+  } catch (const boost::interprocess::interprocess_exception &e) {
+    throw std::runtime_error("TaskSnapshot: cannot map " + path + ": " + e.what());
+  }
+
+  const char *data = static_cast<const char *>(region_.get_address());
+  size_t size = region_.get_size();
+  header_ = reinterpret_cast<const Header *>(data);
+  if (size < sizeof(Header) || header_->magic != MAGIC || header_->version != VERSION) {
+    throw std::runtime_error("TaskSnapshot: " + path + " is not a valid snapshot");
+  }
+  // the counts are read from the file: they are compared to the size without overflowing
+  size_t body_size = size - sizeof(Header);
+  if (header_->records_nb > body_size / sizeof(Record) ||
+      header_->instants_nb != (body_size - header_->records_nb * sizeof(Record)) / sizeof(int64_t) ||
+      (body_size - header_->records_nb * sizeof(Record)) % sizeof(int64_t) != 0) {
+    throw std::runtime_error("TaskSnapshot: " + path + " is not a valid snapshot");
+  }
+  records_ = reinterpret_cast<const Record *>(data + sizeof(Header));
+  instants_ = reinterpret_cast<const int64_t *>(data + sizeof(Header) + header_->records_nb * sizeof(Record));
+  for (size_t i = 0; i < header_->records_nb; ++i) {
+    if (records_[i].instants_offset > header_->instants_nb || records_[i].instants_nb > header_->instants_nb - records_[i].instants_offset) {
+      throw std::runtime_error("TaskSnapshot: " + path + " is not a valid snapshot");
+    }
+  }
+}
+
+size_t Reader::size() const {
+  return header_->records_nb;
+}
+
+const Record &Reader::record(const size_t &idx) const {
+  return records_[idx];
+}
+
+const int64_t *Reader::instants(const uint64_t &offset) const {
+  return instants_ + offset;
+}
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/utility.hpp> // boost::noncopyable
+
+class Calendar;
+
+/**
+* @brief TaskSnapshot is the binary file format of the task table of a TaskScheduler:
+* a Header, then one fixed-size Record per task, then the instants (UTC microseconds since the epoch)
+* referred by the calendar records. It is read in place from a memory mapped file.
+* The execution counters of the summaries are saved, their histograms are not.
+*/
+namespace TaskSnapshot {
+
+const uint64_t MAGIC = 0x31504e534b534154ULL; //!< "TASKSNP1"
+const uint32_t VERSION = 1;
+
+enum class TaskKind: uint8_t {
+  Timer = 1,
+  Calendar,
+  SharedCalendar
+};
+
+struct Header {
+  uint64_t magic {MAGIC};
+  uint32_t version {VERSION};
+  uint32_t reserved {0};
+  uint64_t records_nb {0};
+  uint64_t instants_nb {0};
+};
+
+struct Record {
+  uint64_t task_id {0}; //!< TaskId::value(), it is kept by the restore
+  TaskKind kind {TaskKind::Timer};
+  uint8_t priority {0}; //!< TaskPriority
+  uint8_t mode {0}; //!< TimerMode
+  uint8_t catch_up {0}; //!< CatchUpPolicy
+  uint8_t overlap {0}; //!< OverlapPolicy
+  uint8_t terminated {0};
+  uint16_t reserved {0};
+  int64_t interval_us {0};
+  int64_t repetitions {0};
+  int64_t max_in_flight {0};
+  int64_t next_deadline_us {0}; //!< TimerTask: expected time of the next execution, UTC microseconds since the epoch
+  uint64_t instants_offset {0}; //!< CalendarTask: remaining instants, SharedCalendarTask: its whole calendar
+  uint64_t instants_nb {0};
+  int64_t executed {0};
+  int64_t succeded {0};
+  int64_t failed {0};
+  int64_t cancelled {0};
+  int64_t skipped {0};
+  int64_t rejected {0};
+};
+
+int64_t microsecondsOf(const boost::posix_time::ptime &time); //!< since the epoch
+boost::posix_time::ptime timeOf(const int64_t &microseconds);
+
+/**
+* @brief Writer collects the records of the tasks, then writes the file at once
+*/
+class Writer: boost::noncopyable {
+ public:
+  Record &addRecord();
+  uint64_t addInstant(const boost::posix_time::ptime &instant); //!< return its offset
+  uint64_t addCalendar(const Calendar &calendar); //!< return the offset of its instants, a calendar is written once
+  void write(const std::string &path) const; //!< throw std::runtime_error on failure
+  size_t size() const; //!< number of records
+
+ private:
+  std::vector<Record> records_;
+  std::vector<int64_t> instants_;
+  std::map<const Calendar *, uint64_t> calendars_;
+};
+
+/**
+* @brief Reader maps a file written by a Writer, the records and the instants are read in place
+*/
+class Reader: boost::noncopyable {
+ public:
+  explicit Reader(const std::string &path); //!< throw std::runtime_error if the file is not a valid snapshot
+
+  size_t size() const; //!< number of records
+  const Record &record(const size_t &idx) const;
+  const int64_t *instants(const uint64_t &offset) const;
+
+ private:
+  boost::interprocess::file_mapping file_;
+  boost::interprocess::mapped_region region_;
+  const Header *header_ {nullptr};
+  const Record *records_ {nullptr};
+  const int64_t *instants_ {nullptr};
+};
+
+}
@@ -0,0 +1,55 @@
+#include "TaskTimer.h"
+
+std::chrono::steady_clock::time_point TaskTimer::now() const {
+  return std::chrono::steady_clock::now();
+}
+
+boost::posix_time::ptime TaskTimer::universalTime() const {
+  return boost::posix_time::microsec_clock::universal_time();
+}
+
+/////////////
+
+DeadlineTaskTimer::DeadlineTaskTimer(const TaskStrand &strand): strand_(strand), timer_(strand) {
+}
+
+size_t DeadlineTaskTimer::expiresFromNow(const int64_t &microseconds) {
+  return timer_.expires_from_now(boost::posix_time::microseconds(microseconds));
+}
+
+size_t DeadlineTaskTimer::expiresAt(const boost::posix_time::ptime &expiry_time) {
+  return timer_.expires_at(expiry_time);
+}
+
+void DeadlineTaskTimer::asyncWait(Handler handler) {
+  timer_.async_wait(std::move(handler));
+}
+
+size_t DeadlineTaskTimer::cancel() {
+  return timer_.cancel();
+}
+
+const TaskStrand &DeadlineTaskTimer::strand() const {
+  return strand_;
+}
+
+/////////////
+TaskStrandPool::TaskStrandPool(boost::asio::io_context &io_ctx): io_ctx_(io_ctx) {
+}
+
+TaskStrand TaskStrandPool::acquire() {
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    if (!strands_.empty()) {
+      TaskStrand strand = std::move(strands_.back());
+      strands_.pop_back();
+      return strand;
+    }
+  }
+  return boost::asio::make_strand(io_ctx_);
+}
+
+void TaskStrandPool::release(const TaskStrand &strand) {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  strands_.push_back(strand);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <functional>
+
+#include <boost/asio.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/utility.hpp> // boost::noncopyable
+
+#include "TaskPool.h"
+
+/**
+* @brief TaskStrand serializes the handlers of a task: a task never runs concurrently with itself,
+* while different tasks run in parallel on the io_context threads.
+*/
+using TaskStrand = boost::asio::strand<boost::asio::io_context::executor_type>;
+
+/**
+* @brief TaskStrandPool recycles the strands of the destroyed tasks. Creating a strand allocates its
+* implementation and locks the io_context's strand service, a recycled one is only a shared_ptr copy.
+* A released strand must not have pending handlers of its former task, otherwise they would delay the new one.
+*/
+class TaskStrandPool: boost::noncopyable {
+ public:
+  explicit TaskStrandPool(boost::asio::io_context &io_ctx);
+
+  TaskStrand acquire();
+  void release(const TaskStrand &strand);
+
+ private:
+  boost::asio::io_context &io_ctx_;
+  std::vector<TaskStrand> strands_;
+  std::mutex mutex_;
+};
+
+/**
+* @brief TaskTimer is the timer interface used by a Task to schedule its next execution.
+* It mimics the subset of boost::asio::deadline_timer used by the tasks, so the scheduler
+* can select the timer engine (see TimerEngine) without changing the tasks.
+* Handlers are always invoked through the task's strand.
+* The timer is also the clock of its task: a simulated engine (see SimulatedClock) provides a virtual time.
+*/
+class TaskTimer: boost::noncopyable {
+ public:
+  using Handler = std::function<void(const boost::system::error_code &)>;
+
+  virtual ~TaskTimer() = default;
+
+  virtual size_t expiresFromNow(const int64_t &microseconds) = 0; //!< return the number of pending waits cancelled
+  virtual size_t expiresAt(const boost::posix_time::ptime &expiry_time) = 0; //!< expiry_time must be in UTC (Absolut Time)
+  virtual void asyncWait(Handler handler) = 0;
+  virtual size_t cancel() = 0; //!< pending waits are completed with boost::asio::error::operation_aborted
+  virtual const TaskStrand &strand() const = 0; //!< where the handlers are invoked
+
+  virtual std::chrono::steady_clock::time_point now() const; //!< clock of expiresFromNow(), std::chrono::steady_clock by default
+  virtual boost::posix_time::ptime universalTime() const; //!< clock of expiresAt(), in UTC (Absolut Time)
+};
+
+/**
+* @brief DeadlineTaskTimer is a TaskTimer that owns its own boost::asio::deadline_timer,
+* so every pending task is an entry of the io_context timer queue.
+* The timer is bound to the strand type itself: a type-erased executor would allocate on every wait.
+*/
+class DeadlineTaskTimer: public TaskTimer, public Pooled<DeadlineTaskTimer> {
+ public:
+  explicit DeadlineTaskTimer(const TaskStrand &strand);
+
+  size_t expiresFromNow(const int64_t &microseconds) override;
+  size_t expiresAt(const boost::posix_time::ptime &expiry_time) override;
+  void asyncWait(Handler handler) override;
+  size_t cancel() override;
+  const TaskStrand &strand() const override;
+
+ private:
+  using StrandDeadlineTimer = boost::asio::basic_deadline_timer<boost::posix_time::ptime, boost::asio::time_traits<boost::posix_time::ptime>, TaskStrand>;
+
+  TaskStrand strand_;
+  StrandDeadlineTimer timer_;
+};
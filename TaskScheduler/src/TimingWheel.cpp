@@ -0,0 +1,188 @@
+#include "TimingWheel.h"
+
+#include <cassert>
+#include <algorithm>
+
+TimingWheel::Timer::Timer(TimingWheel &wheel, const TaskStrand &strand): wheel_(wheel), strand_(strand) {
+}
+
+TimingWheel::Timer::~Timer() {
+  const std::lock_guard<std::mutex> lock(wheel_.mutex_);
+  if (slot_) {
+    wheel_.unlink(this);
+  }
+}
+
+size_t TimingWheel::Timer::expiresFromNow(const int64_t &microseconds) {
+  size_t cancelled_nb = cancel();
+  const std::lock_guard<std::mutex> lock(wheel_.mutex_);
+  expiry_ = Clock::now() + std::chrono::microseconds(microseconds);
+  return cancelled_nb;
+}
+
+size_t TimingWheel::Timer::expiresAt(const boost::posix_time::ptime &expiry_time) {
+  int64_t from_now_us = (expiry_time - boost::posix_time::microsec_clock::universal_time()).total_microseconds();
+  return expiresFromNow(from_now_us);
+}
+
+void TimingWheel::Timer::asyncWait(Handler handler) {
+  const std::lock_guard<std::mutex> lock(wheel_.mutex_);
+  assert(!slot_);
+  if (wheel_.size_ == 0) {
+    // the wheel has been idle, move it forward without cascading empty slots
+    wheel_.current_tick_ = std::max(wheel_.current_tick_, wheel_.tickOf(Clock::now(), false));
+  }
+  // the current slot has been already dispatched
+  expiry_tick_ = std::max(wheel_.tickOf(expiry_, true), wheel_.current_tick_ + 1);
+  handler_ = std::move(handler);
+  wheel_.link(this);
+  ++wheel_.size_;
+  if (!wheel_.ticking_) {
+    wheel_.startTicking();
+  }
+}
+
+size_t TimingWheel::Timer::cancel() {
+  Handler handler;
+  {
+    const std::lock_guard<std::mutex> lock(wheel_.mutex_);
+    if (!slot_) {
+      return 0;
+    }
+    handler = wheel_.release(this);
+  }
+  boost::asio::post(strand_, std::bind(std::move(handler), boost::asio::error::operation_aborted));
+  return 1;
+}
+
+const TaskStrand &TimingWheel::Timer::strand() const {
+  return strand_;
+}
+
+/////////////
+TimingWheel::TimingWheel(boost::asio::io_context &io_ctx, const int64_t &tick_us/* = 1'000LL*/):
+  driver_(io_ctx),
+  tick_us_(tick_us),
+  origin_(Clock::now()) {
+  assert(tick_us_ > 0);
+}
+
+int64_t TimingWheel::tickMicroseconds() const {
+  return tick_us_;
+}
+
+size_t TimingWheel::size() {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  return size_;
+}
+
+uint64_t TimingWheel::tickOf(const Clock::time_point &time, const bool &round_up) const {
+  int64_t elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(time - origin_).count();
+  if (elapsed_us <= 0) {
+    return 0;
+  }
+  return static_cast<uint64_t>(round_up ? (elapsed_us + tick_us_ - 1) / tick_us_ : elapsed_us / tick_us_);
+}
+
+void TimingWheel::link(Timer *timer) {
+  // find the level whose span contains the expiry, the last one takes the overflow
+  uint64_t delta = timer->expiry_tick_ - current_tick_;
+  unsigned int level = 0;
+  while (level < LEVELS - 1 && delta >= (1ULL << (LEVEL_BITS * (level + 1)))) {
+    ++level;
+  }
+  uint64_t slot_tick = timer->expiry_tick_;
+  if (delta >= (1ULL << (LEVEL_BITS * LEVELS))) {
+    slot_tick = current_tick_ + (1ULL << (LEVEL_BITS * LEVELS)) - 1; // it will be cascaded again
+  }
+  Timer **slot = &slots_[level][(slot_tick >> (LEVEL_BITS * level)) & (LEVEL_SLOTS - 1)];
+
+  // push front
+  timer->prev_ = nullptr;
+  timer->next_ = *slot;
+  if (*slot) {
+    (*slot)->prev_ = timer;
+  }
+  *slot = timer;
+  timer->slot_ = slot;
+}
+
+void TimingWheel::unlink(Timer *timer) {
+  if (timer->prev_) {
+    timer->prev_->next_ = timer->next_;
+  } else {
+    *timer->slot_ = timer->next_;
+  }
+  if (timer->next_) {
+    timer->next_->prev_ = timer->prev_;
+  }
+  timer->prev_ = nullptr;
+  timer->next_ = nullptr;
+  timer->slot_ = nullptr;
+  --size_;
+}
+
+TimingWheel::Handler TimingWheel::release(Timer *timer) {
+  unlink(timer);
+  Handler handler = std::move(timer->handler_);
+  timer->handler_ = nullptr;
+  return handler;
+}
+
+void TimingWheel::advance(std::vector<std::pair<TaskStrand, Handler>> &expired) {
+  ++current_tick_;
+
+  // cascade the upper levels' slots that come into range when the lower level wraps around
+  for (unsigned int level = 1; level < LEVELS; ++level) {
+    if ((current_tick_ & ((1ULL << (LEVEL_BITS * level)) - 1)) != 0) {
+      break;
+    }
+    Timer **slot = &slots_[level][(current_tick_ >> (LEVEL_BITS * level)) & (LEVEL_SLOTS - 1)];
+    Timer *timer = *slot;
+    *slot = nullptr;
+    while (timer) {
+      Timer *next = timer->next_;
+      link(timer);
+      timer = next;
+    }
+  }
+
+  // the whole slot expires now
+  Timer **slot = &slots_[0][current_tick_ & (LEVEL_SLOTS - 1)];
+  while (*slot) {
+    Timer *timer = *slot;
+    expired.emplace_back(timer->strand_, release(timer));
+  }
+}
+
+void TimingWheel::startTicking() {
+  ticking_ = true;
+  driver_.expires_at(origin_ + std::chrono::microseconds(tick_us_ * static_cast<int64_t>(current_tick_ + 1)));
+  driver_.async_wait([this](const boost::system::error_code & e) {
+    onTick(e);
+  });
+}
+
+void TimingWheel::onTick(const boost::system::error_code &e) {
+  if (e == boost::asio::error::operation_aborted) {
+    return;
+  }
+
+  std::vector<std::pair<TaskStrand, Handler>> expired;
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t now_tick = tickOf(Clock::now(), false);
+    while (current_tick_ < now_tick && size_ > 0) {
+      advance(expired);
+    }
+    ticking_ = false;
+    if (size_ > 0) {
+      startTicking();
+    }
+  }
+
+  // batched dispatch of the expired timers
+  for (auto &it : expired) {
+    boost::asio::post(it.first, std::bind(std::move(it.second), boost::system::error_code()));
+  }
+}
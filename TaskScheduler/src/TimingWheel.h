@@ -0,0 +1,83 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <chrono>
+
+#include "TaskTimer.h"
+
+/**
+* @brief TimingWheel is a hierarchical timing wheel driven by a single boost::asio::steady_timer,
+* which ticks every 'tick_us' microseconds while there are pending timers.
+* Schedule and cancel are O(1) and all the timers expiring in the same tick are dispatched as a batch,
+* every handler is posted to its timer's strand.
+* A timer never fires before its expiry, and at most one tick after it.
+* The Timers must be destroyed before their TimingWheel.
+*/
+class TimingWheel: boost::noncopyable {
+ public:
+  using Handler = TaskTimer::Handler;
+
+  static const unsigned int LEVEL_BITS = 8;
+  static const unsigned int LEVEL_SLOTS = 1 << LEVEL_BITS;
+  static const unsigned int LEVELS = 4; //!< with 1 ms ticks, levels span: 256 ms, 65 s, 4.6 h and 49.7 days
+
+  /**
+  * @brief Timer is an entry of the TimingWheel. It is an intrusive node of a slot list,
+  * so scheduling it does not allocate, and its memory is recycled from a pool.
+  */
+  class Timer: public TaskTimer, public Pooled<Timer> {
+   public:
+    Timer(TimingWheel &wheel, const TaskStrand &strand);
+    ~Timer() override; // pending wait is dropped without invoking its handler
+
+    size_t expiresFromNow(const int64_t &microseconds) override;
+    size_t expiresAt(const boost::posix_time::ptime &expiry_time) override;
+    void asyncWait(Handler handler) override;
+    size_t cancel() override;
+    const TaskStrand &strand() const override;
+
+   private:
+    friend class TimingWheel;
+
+    TimingWheel &wheel_;
+    TaskStrand strand_;
+    std::chrono::steady_clock::time_point expiry_;
+    uint64_t expiry_tick_ {0};
+    Handler handler_;
+    Timer *prev_ {nullptr};
+    Timer *next_ {nullptr};
+    Timer **slot_ {nullptr}; //!< head of the slot list where it is linked, nullptr if it is not pending
+  };
+
+  /**
+  * @param tick_us resolution of the wheel in microseconds
+  */
+  TimingWheel(boost::asio::io_context &io_ctx, const int64_t &tick_us = 1'000LL);
+
+  int64_t tickMicroseconds() const;
+  size_t size(); //!< number of pending timers
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  uint64_t tickOf(const Clock::time_point &time, const bool &round_up) const;
+
+  // not thread safe, 'mutex_' must be locked
+  void link(Timer *timer);
+  void unlink(Timer *timer);
+  Handler release(Timer *timer); // unlink and return its handler
+  void advance(std::vector<std::pair<TaskStrand, Handler>> &expired); // one tick
+  void startTicking();
+
+  void onTick(const boost::system::error_code &e);
+
+  boost::asio::steady_timer driver_;
+  const int64_t tick_us_;
+  const Clock::time_point origin_;
+  uint64_t current_tick_ {0};
+  size_t size_ {0};
+  bool ticking_ {false};
+  Timer *slots_[LEVELS][LEVEL_SLOTS] = {};
+  std::mutex mutex_;
+};
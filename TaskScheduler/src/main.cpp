@@ -1,15 +1,32 @@
 #include <iostream>
 #include <climits>
+#include <limits>
 #include <cstdlib>
 #include <chrono>
+#include <ctime>
 #include <thread>
+#include <atomic>
+#include <numeric>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <map>
+#include <set>
+#include <random>
+#include <fstream>
+#include <iterator>
+#include <cstdio>
 
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <boost/uuid/uuid_io.hpp>
 
 #include "gtest/gtest.h"
 
 #include "TaskScheduler.h"
 #include "../include/utils.h"
+#include "../include/allocation_counter.h"
 
 void printMsg(const std::string &msg) {
   std::cout << "msg: " << msg << std::endl;
@@ -98,7 +115,7 @@ TEST(TaskScheduler, timer_task_limited) {
   const int64_t ITERATIONS_NB = 10;
 
   // with lambda
-  std::string task_id = scheduler.createTimerTask([&theClass]() {
+  TaskId task_id = scheduler.createTimerTask([&theClass]() {
     theClass.printMsg("hello!");
   }, PERIOD_MS, ITERATIONS_NB);
 
@@ -126,7 +143,7 @@ TEST(TaskScheduler, timer_task_infinite) {
   const int64_t ITERATIONS_NB = 10;
 
   // with lambda
-  std::string task_id = scheduler.createTimerTask([&theClass]() {
+  TaskId task_id = scheduler.createTimerTask([&theClass]() {
     theClass.printMsg("hello!");
   }, PERIOD_MS);
 
@@ -156,12 +173,12 @@ TEST(TaskScheduler, two_timer_task_infinite) {
   const int64_t tolerance =  std::max(1LL, ITERATIONS_NB / 10LL); // 10% of deviation
 
   // with lambda
-  std::string task_id = scheduler.createTimerTask([&theClass]() {
+  TaskId task_id = scheduler.createTimerTask([&theClass]() {
     theClass.printMsg("hello!");
   }, PERIOD_MS);
 
   // with lambda
-  std::string task_id2 = scheduler.createTimerTask([&theClass2]() {
+  TaskId task_id2 = scheduler.createTimerTask([&theClass2]() {
     theClass2.printMsg("hello 2!");
   }, PERIOD_MS);
 
@@ -189,7 +206,7 @@ TEST(TaskScheduler, cancel_timer_task_limited) {
   const int64_t ITERATIONS_DONE_NB = ITERATIONS_NB / 2;
 
   // with lambda
-  std::string task_id = scheduler.createTimerTask([&theClass]() {
+  TaskId task_id = scheduler.createTimerTask([&theClass]() {
     theClass.printMsg("hello!");
   }, PERIOD_MS, ITERATIONS_NB);
 
@@ -229,7 +246,7 @@ TEST(TaskScheduler, many_calendar_tasks) {
     repetitions_.push(boost::posix_time::microsec_clock::universal_time() + boost::posix_time::seconds(1) + boost::posix_time::milliseconds(i * PERIOD_MS));
   }
 
-  std::string task_id = scheduler.createCalendarTask([&theClass]() {
+  TaskId task_id = scheduler.createCalendarTask([&theClass]() {
     theClass.printMsg("hello!");
   }, repetitions_);
 
@@ -241,6 +258,1502 @@ TEST(TaskScheduler, many_calendar_tasks) {
   EXPECT_EQ(executed_nb, ITERATIONS_NB);
 }
 
+// timing wheel engine
+TEST(TimingWheel, expiry_across_levels) {
+  boost::asio::io_context io_ctx;
+  TaskStrand strand = boost::asio::make_strand(io_ctx);
+  TimingWheel wheel(io_ctx);
+
+  // first level spans 256 ticks (ms), the next ones are cascaded
+  const std::vector<int64_t> DELAYS_MS = {5, 255, 256, 300, 1'000};
+  const int64_t TOLERANCE_MS = 50;
+
+  std::vector<std::unique_ptr<TimingWheel::Timer>> timers;
+  std::vector<int64_t> elapsed_ms(DELAYS_MS.size(), -1);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < DELAYS_MS.size(); ++i) {
+    timers.push_back(std::make_unique<TimingWheel::Timer>(wheel, strand));
+    timers.back()->expiresFromNow(DELAYS_MS[i] * 1'000LL);
+    timers.back()->asyncWait([&elapsed_ms, start, i](const boost::system::error_code & e) {
+      if (!e) {
+        elapsed_ms[i] = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+      }
+    });
+  }
+
+  // far away timer, cancelled before expiry
+  bool aborted = false;
+  TimingWheel::Timer far_timer(wheel, strand);
+  far_timer.expiresFromNow(70'000'000LL);
+  far_timer.asyncWait([&aborted](const boost::system::error_code & e) {
+    aborted = (e == boost::asio::error::operation_aborted);
+  });
+  EXPECT_EQ(wheel.size(), DELAYS_MS.size() + 1);
+  EXPECT_EQ(far_timer.cancel(), 1);
+  EXPECT_EQ(far_timer.cancel(), 0);
+
+  io_ctx.run(); // it returns when the wheel is empty
+
+  EXPECT_TRUE(aborted);
+  EXPECT_EQ(wheel.size(), 0);
+  for (size_t i = 0; i < DELAYS_MS.size(); ++i) {
+    std::cout << "Delay: " << DELAYS_MS[i] << " ms, elapsed: " << elapsed_ms[i] << " ms" << std::endl;
+    EXPECT_GE(elapsed_ms[i], DELAYS_MS[i]);
+    EXPECT_LE(elapsed_ms[i], DELAYS_MS[i] + TOLERANCE_MS);
+  }
+}
+
+TEST(TaskScheduler, timing_wheel_timer_task_limited) {
+  TaskScheduler scheduler(1, TimerEngine::TimingWheel);
+  scheduler.asyncRun();
+
+  const int64_t PERIOD_MS = 100;
+  const int64_t ITERATIONS_NB = 10;
+
+  std::atomic<int64_t> counter {0};
+  TaskId task_id = scheduler.createTimerTask([&counter]() {
+    ++counter;
+  }, PERIOD_MS, ITERATIONS_NB);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(ITERATIONS_NB * PERIOD_MS + PERIOD_MS / 2));
+  Task::Summary summary = scheduler.summaryTask(task_id);
+  scheduler.terminate();
+
+  std::cout << "Executed " << summary.executed << " of " << ITERATIONS_NB << std::endl;
+  EXPECT_EQ(summary.executed, ITERATIONS_NB);
+  EXPECT_EQ(counter, ITERATIONS_NB);
+}
+
+TEST(TaskScheduler, timing_wheel_cancel_and_calendar) {
+  TaskScheduler scheduler(1, TimerEngine::TimingWheel);
+  scheduler.asyncRun();
+
+  const int64_t PERIOD_MS = 100;
+  const int64_t ITERATIONS_NB = 10;
+
+  TaskId timer_id = scheduler.createTimerTask([]() {}, PERIOD_MS, ITERATIONS_NB);
+
+  std::queue<boost::posix_time::ptime> repetitions;
+  for (int i = 0; i < ITERATIONS_NB; ++i) {
+    repetitions.push(boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds((i + 1) * PERIOD_MS));
+  }
+  TaskId calendar_id = scheduler.createCalendarTask([]() {}, repetitions);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(ITERATIONS_NB / 2 * PERIOD_MS + PERIOD_MS / 2));
+  Task::Summary timer_summary = scheduler.terminateTask(timer_id);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(ITERATIONS_NB / 2 * PERIOD_MS + PERIOD_MS / 2));
+  Task::Summary calendar_summary = scheduler.summaryTask(calendar_id);
+  scheduler.terminate();
+
+  EXPECT_EQ(timer_summary.executed + timer_summary.cancelled, ITERATIONS_NB);
+  EXPECT_EQ(scheduler.summaryTask(timer_id).executed, timer_summary.executed);
+  EXPECT_EQ(calendar_summary.executed, ITERATIONS_NB);
+}
+
+// thread pool
+TEST(TaskScheduler, thread_pool_strands) {
+  const int THREADS_NB = 4;
+  const int64_t TASKS_NB = 4;
+  TaskScheduler scheduler(THREADS_NB);
+  scheduler.asyncRun();
+
+  // every task is slower than its period: it is delayed but it never overlaps with itself
+  std::vector<std::atomic_bool> in_flight(TASKS_NB);
+  std::atomic_bool self_overlap {false};
+  std::atomic<int> concurrency {0};
+  std::atomic<int> max_concurrency {0};
+  for (int64_t i = 0; i < TASKS_NB; ++i) {
+    scheduler.createTimerTask([&, i]() {
+      if (in_flight[i].exchange(true)) {
+        self_overlap = true;
+      }
+      int current = ++concurrency;
+      int max = max_concurrency;
+      while (current > max && !max_concurrency.compare_exchange_weak(max, current)) {}
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      --concurrency;
+      in_flight[i] = false;
+    }, 5);
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  scheduler.terminate();
+
+  std::cout << "Max concurrency: " << max_concurrency << " of " << THREADS_NB << " threads" << std::endl;
+  EXPECT_FALSE(self_overlap);
+  EXPECT_GT(max_concurrency, 1);
+  EXPECT_LE(max_concurrency, THREADS_NB);
+}
+
+// task registry
+TEST(TaskRegistry, generational_handles) {
+  TaskRegistry registry;
+  std::shared_ptr<Task> task = std::make_shared<CalendarTask>(nullptr, []() {}, std::queue<boost::posix_time::ptime>());
+
+  TaskId first_id = registry.insert(task);
+  EXPECT_EQ(registry.find(first_id), task);
+  EXPECT_EQ(registry.erase(first_id), task);
+  EXPECT_FALSE(registry.find(first_id));
+  EXPECT_FALSE(registry.erase(first_id));
+
+  // the slot is recycled but the stale handle does not alias the new task
+  TaskId second_id = registry.insert(task);
+  EXPECT_EQ(second_id.index, first_id.index);
+  EXPECT_NE(second_id, first_id);
+  EXPECT_FALSE(registry.find(first_id));
+  EXPECT_EQ(registry.find(second_id), task);
+  EXPECT_EQ(registry.size(), 1);
+
+  registry.clear();
+  EXPECT_EQ(registry.size(), 0);
+  EXPECT_FALSE(registry.find(second_id));
+}
+
+TEST(TaskRegistry, restored_handles) {
+  TaskRegistry registry;
+  std::shared_ptr<Task> task = std::make_shared<CalendarTask>(nullptr, []() {}, std::queue<boost::posix_time::ptime>());
+  TaskId first_id = registry.insert(task);
+
+  // a restored handle in the shard of this thread, the slots before it become free
+  const uint32_t RESTORED_SLOT = 4;
+  TaskId restored_id;
+  restored_id.index = (RESTORED_SLOT << TaskRegistry::SHARD_BITS) | (first_id.index & (TaskRegistry::SHARDS - 1));
+  restored_id.generation = 7;
+  EXPECT_TRUE(registry.isRestorable(restored_id));
+  EXPECT_TRUE(registry.insertAt(restored_id, task));
+  EXPECT_FALSE(registry.isRestorable(restored_id));
+  EXPECT_FALSE(registry.insertAt(restored_id, task));
+
+  // the free slots are recycled, the restored one is skipped
+  std::vector<TaskId> task_ids;
+  for (uint32_t i = 0; i < RESTORED_SLOT + 2; ++i) {
+    task_ids.push_back(registry.insert(task));
+    EXPECT_NE(task_ids.back().index, restored_id.index);
+  }
+  EXPECT_EQ(registry.find(restored_id), task);
+  EXPECT_EQ(registry.size(), RESTORED_SLOT + 4);
+
+  // a slot index read from a file is bounded
+  TaskId out_of_bounds_id;
+  out_of_bounds_id.index = std::numeric_limits<uint32_t>::max();
+  out_of_bounds_id.generation = 1;
+  EXPECT_FALSE(registry.isRestorable(out_of_bounds_id));
+  EXPECT_FALSE(registry.insertAt(out_of_bounds_id, task));
+  TaskId null_id;
+  EXPECT_FALSE(registry.insertAt(null_id, task));
+}
+
+TEST(TaskScheduler, purge_completed_tasks) {
+  const int64_t TASKS_NB = 100;
+  const int64_t ITERATIONS_NB = 3;
+  TaskScheduler scheduler(2, TimerEngine::DeadlineTimer, PurgePolicy::Completed);
+  scheduler.asyncRun();
+
+  std::vector<TaskId> task_ids;
+  for (int64_t i = 0; i < TASKS_NB; ++i) {
+    task_ids.push_back(scheduler.createTimerTask([]() {}, 10, ITERATIONS_NB));
+  }
+  // an infinite task is purged once it is terminated
+  TaskId infinite_id = scheduler.createTimerTask([]() {}, 10);
+  EXPECT_EQ(scheduler.tasksNumber(), TASKS_NB + 1);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  scheduler.terminateTask(infinite_id);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  int64_t executed_nb = scheduler.terminate();
+
+  EXPECT_EQ(scheduler.tasksNumber(), 0);
+  EXPECT_GE(executed_nb, TASKS_NB * ITERATIONS_NB);
+  EXPECT_THROW(scheduler.summaryTask(task_ids.front()), std::runtime_error);
+  EXPECT_THROW(scheduler.terminateTask(infinite_id), std::runtime_error);
+}
+
+// allocation-free creation
+TEST(TaskCallback, inline_and_heap_storage) {
+  int counter = 0;
+  TaskCallback small([&counter]() {
+    ++counter;
+  });
+  std::array<int64_t, 16> big_capture {};
+  TaskCallback big([&counter, big_capture]() {
+    counter += static_cast<int>(big_capture.size());
+  });
+  auto move_only = std::make_unique<int>(100);
+  TaskCallback owner([&counter, ptr = std::move(move_only)]() {
+    counter += *ptr;
+  });
+
+  int64_t allocations_nb = thread_allocations_nb;
+  TaskCallback moved(std::move(small));
+  moved();
+  EXPECT_EQ(thread_allocations_nb, allocations_nb);
+  EXPECT_FALSE(small);
+  EXPECT_THROW(small(), std::bad_function_call);
+
+  big();
+  owner();
+  EXPECT_EQ(counter, 1 + 16 + 100);
+}
+
+// create 'tasks_nb' single shot tasks and wait until they are purged, return the allocations of the calling thread.
+// The scheduler has one more task, which keeps the wheel ticking: restarting it would allocate an asio operation
+int64_t createAndPurgeTasks(TaskScheduler &scheduler, const int64_t &tasks_nb, const int64_t &milliseconds, int64_t &elapsed_ns) {
+  int64_t allocations_nb = thread_allocations_nb;
+  auto start = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i < tasks_nb; ++i) {
+    scheduler.createTimerTask([]() {}, milliseconds, 1);
+  }
+  elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  allocations_nb = thread_allocations_nb - allocations_nb;
+
+  while (scheduler.tasksNumber() > 1) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return allocations_nb;
+}
+
+TEST(TaskScheduler, allocation_free_creation) {
+  const int64_t TASKS_NB = 1'000;
+  TaskScheduler scheduler(1, TimerEngine::TimingWheel, PurgePolicy::Completed);
+  scheduler.asyncRun();
+  scheduler.createTimerTask([]() {}, 60'000);
+
+  // warm up: all the tasks are alive at once, so the pools, the registry slots and the strands reach their maximum size
+  int64_t elapsed_ns = 0;
+  int64_t warmup_allocations_nb = createAndPurgeTasks(scheduler, TASKS_NB, 200, elapsed_ns);
+  int64_t allocations_nb = createAndPurgeTasks(scheduler, TASKS_NB, 1, elapsed_ns);
+  scheduler.terminate();
+
+  std::cout << "Allocations, warm up: " << warmup_allocations_nb << ", steady state: " << allocations_nb << std::endl;
+  EXPECT_EQ(allocations_nb, 0);
+}
+
+// drift-free scheduling
+TEST(Histogram, percentiles) {
+  Histogram histogram;
+  EXPECT_EQ(histogram.percentile(99), 0);
+  for (int64_t value = 1; value <= 1'000; ++value) {
+    histogram.record(value);
+  }
+  histogram.record(-5); // recorded as zero
+
+  EXPECT_EQ(histogram.count(), 1'001);
+  EXPECT_EQ(histogram.min(), 0);
+  EXPECT_EQ(histogram.max(), 1'000);
+  EXPECT_NEAR(histogram.mean(), 500'500.0 / 1'001, 0.001);
+  // relative error below 2 / SUB_BUCKETS
+  for (double percentile : {50.0, 90.0, 99.0}) {
+    double expected = percentile * 10;
+    EXPECT_GE(histogram.percentile(percentile), expected);
+    EXPECT_LE(histogram.percentile(percentile), expected * (1 + 2.0 / Histogram::SUB_BUCKETS));
+  }
+
+  Histogram other;
+  other.record(Histogram::MAX_VALUE + 1);
+  histogram.merge(other);
+  EXPECT_EQ(histogram.count(), 1'002);
+  EXPECT_EQ(histogram.percentile(100), Histogram::MAX_VALUE);
+}
+
+// the layout of the task summaries: half the buckets, a bigger relative error
+TEST(Histogram, coarse_layout) {
+  CoarseHistogram histogram;
+  for (int64_t value = 1; value <= 1'000; ++value) {
+    histogram.record(value);
+  }
+  EXPECT_EQ(histogram.count(), 1'000);
+  EXPECT_EQ(histogram.max(), 1'000);
+  for (double percentile : {50.0, 90.0, 99.0}) {
+    double expected = percentile * 10;
+    EXPECT_GE(histogram.percentile(percentile), expected);
+    EXPECT_LE(histogram.percentile(percentile), expected * (1 + 2.0 / CoarseHistogram::SUB_BUCKETS));
+  }
+  EXPECT_EQ(CoarseHistogram::BUCKETS, 124);
+  EXPECT_LT(sizeof(Task::Summary), sizeof(Histogram) * 6 / 5);
+}
+
+// a single worker is blocked in bursts: the absolute deadlines keep the long-run firing count of the wall time
+TEST(TaskScheduler, absolute_deadlines_under_saturation) {
+  const int64_t PERIOD_MS = 10;
+  const int64_t BURST_PERIOD_MS = 500;
+  const int64_t BURST_MS = 200;
+  const int64_t RUN_MS = 2'350; // it ends out of a burst, with time to catch up
+  const int64_t DEADLINES_NB = RUN_MS / PERIOD_MS;
+
+  TaskScheduler scheduler(1);
+  scheduler.createTimerTask([BURST_MS]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(BURST_MS));
+  }, BURST_PERIOD_MS);
+  TaskId relative_id = scheduler.createTimerTask([]() {}, PERIOD_MS);
+  TaskId fire_all_id = scheduler.createTimerTask([]() {}, PERIOD_MS, 0, TimerMode::Absolute, CatchUpPolicy::FireAll);
+  TaskId skip_id = scheduler.createTimerTask([]() {}, PERIOD_MS, 0, TimerMode::Absolute, CatchUpPolicy::Skip);
+  TaskId coalesce_id = scheduler.createTimerTask([]() {}, PERIOD_MS, 0, TimerMode::Absolute, CatchUpPolicy::Coalesce);
+
+  scheduler.asyncRun();
+  std::this_thread::sleep_for(std::chrono::milliseconds(RUN_MS));
+  scheduler.terminate();
+
+  auto print = [](const std::string & name, const Task::Summary & summary) {
+    std::cout << name << " - executed: " << summary.executed << ", skipped: " << summary.skipped <<
+              ", lateness p50: " << summary.lateness_us.percentile(50) << " us, p99: " << summary.lateness_us.percentile(99) <<
+              " us, max: " << summary.lateness_us.max() << " us" << std::endl;
+  };
+  Task::Summary relative = scheduler.summaryTask(relative_id);
+  Task::Summary fire_all = scheduler.summaryTask(fire_all_id);
+  Task::Summary skip = scheduler.summaryTask(skip_id);
+  Task::Summary coalesce = scheduler.summaryTask(coalesce_id);
+  std::cout << "Deadlines: " << DEADLINES_NB << std::endl;
+  print("relative", relative);
+  print("fire all", fire_all);
+  print("skip", skip);
+  print("coalesce", coalesce);
+
+  EXPECT_NEAR(fire_all.executed, DEADLINES_NB, 2);
+  EXPECT_EQ(fire_all.skipped, 0);
+  EXPECT_NEAR(skip.executed + skip.skipped, DEADLINES_NB, 2);
+  EXPECT_NEAR(coalesce.executed + coalesce.skipped, DEADLINES_NB, 2);
+  EXPECT_GT(skip.skipped, 0);
+  // one execution per burst on behalf of the missed deadlines
+  EXPECT_GT(coalesce.executed, skip.executed);
+  EXPECT_GE(fire_all.lateness_us.max(), (BURST_MS - PERIOD_MS) * 1'000LL);
+}
+
+TEST(TaskScheduler, absolute_deadlines_limited) {
+  const int64_t PERIOD_MS = 20;
+  const int64_t ITERATIONS_NB = 10;
+
+  TaskScheduler scheduler(1);
+  // the first deadlines are missed before the scheduler runs
+  TaskId skip_id = scheduler.createTimerTask([]() {}, PERIOD_MS, ITERATIONS_NB, TimerMode::Absolute, CatchUpPolicy::Skip);
+  std::this_thread::sleep_for(std::chrono::milliseconds(3 * PERIOD_MS + PERIOD_MS / 2));
+  scheduler.asyncRun();
+  std::this_thread::sleep_for(std::chrono::milliseconds(ITERATIONS_NB * PERIOD_MS));
+  scheduler.terminate();
+
+  // the skipped deadlines count as repetitions: the task ends on time
+  Task::Summary summary = scheduler.summaryTask(skip_id);
+  EXPECT_EQ(summary.executed + summary.skipped, ITERATIONS_NB);
+  EXPECT_GE(summary.skipped, 2);
+  EXPECT_EQ(summary.lateness_us.count(), summary.executed);
+}
+
+// a zero interval has no deadline to skip: Skip and Coalesce fire them all
+TEST(TaskScheduler, absolute_deadlines_zero_interval) {
+  const int64_t ITERATIONS_NB = 5;
+
+  TaskScheduler scheduler(1, TimerEngine::Simulated);
+  TaskId skip_id = scheduler.createTimerTask([]() {}, 0, ITERATIONS_NB, TimerMode::Absolute, CatchUpPolicy::Skip);
+  TaskId coalesce_id = scheduler.createTimerTask([]() {}, 0, ITERATIONS_NB, TimerMode::Absolute, CatchUpPolicy::Coalesce);
+  scheduler.advance(std::chrono::milliseconds(1));
+
+  EXPECT_EQ(scheduler.summaryTask(skip_id).executed, ITERATIONS_NB);
+  EXPECT_EQ(scheduler.summaryTask(skip_id).skipped, 0);
+  EXPECT_EQ(scheduler.summaryTask(coalesce_id).executed, ITERATIONS_NB);
+  EXPECT_EQ(scheduler.summaryTask(coalesce_id).skipped, 0);
+}
+
+// execution statistics
+TEST(Histogram, atomic_histogram_merge) {
+  Histogram histogram;
+  AtomicHistogram atomic_histogram;
+  for (int64_t value = 0; value < 10'000; value += 7) {
+    histogram.record(value);
+    atomic_histogram.record(value);
+  }
+
+  Histogram merged;
+  atomic_histogram.mergeInto(merged);
+  EXPECT_EQ(merged.count(), histogram.count());
+  EXPECT_EQ(merged.min(), histogram.min());
+  EXPECT_EQ(merged.max(), histogram.max());
+  EXPECT_EQ(merged.mean(), histogram.mean());
+  EXPECT_EQ(merged.percentile(99), histogram.percentile(99));
+}
+
+TEST(TaskScheduler, execution_stats) {
+  const int64_t TASKS_NB = 8;
+  const int64_t ITERATIONS_NB = 5;
+  const int64_t CALLBACK_MS = 2;
+  TaskScheduler scheduler(2, TimerEngine::DeadlineTimer, PurgePolicy::Completed);
+  scheduler.asyncRun();
+
+  // the stats of the purged tasks are kept by the scheduler
+  for (int64_t i = 0; i < TASKS_NB; ++i) {
+    scheduler.createTimerTask([CALLBACK_MS]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(CALLBACK_MS));
+    }, 10, ITERATIONS_NB);
+  }
+  TaskId failing_id = scheduler.createTimerTask([]() {
+    throw std::runtime_error("failing task");
+  }, 10);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(ITERATIONS_NB * 10 + 100));
+  Task::Summary failing = scheduler.summaryTask(failing_id);
+  SchedulerStats::Snapshot snapshot = scheduler.statsSnapshot();
+  scheduler.terminate();
+
+  std::cout << "Executed: " << snapshot.executed << ", execution p50: " << snapshot.execution_us.percentile(50) <<
+            " us, p99: " << snapshot.execution_us.percentile(99) << " us, lateness p50: " << snapshot.lateness_us.percentile(50) <<
+            " us, p99: " << snapshot.lateness_us.percentile(99) << " us" << std::endl;
+  EXPECT_GT(failing.failed, 0);
+  EXPECT_EQ(failing.execution_us.count(), failing.executed);
+  EXPECT_GE(snapshot.failed, failing.failed);
+  EXPECT_EQ(snapshot.succeded, TASKS_NB * ITERATIONS_NB);
+  EXPECT_EQ(snapshot.execution_us.count(), snapshot.executed);
+  EXPECT_EQ(snapshot.lateness_us.count(), snapshot.executed);
+  EXPECT_GE(snapshot.execution_us.percentile(50), CALLBACK_MS * 1'000LL);
+}
+
+// shared calendars
+TEST(Calendar, sorted_and_unique) {
+  boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+  std::vector<boost::posix_time::ptime> instants;
+  for (int i : {3, 1, 2, 3, 1}) {
+    instants.push_back(now + boost::posix_time::seconds(i));
+  }
+  Calendar calendar(instants);
+  ASSERT_EQ(calendar.size(), 3);
+  EXPECT_EQ(calendar.at(0), now + boost::posix_time::seconds(1));
+  EXPECT_EQ(calendar.at(2), now + boost::posix_time::seconds(3));
+  EXPECT_EQ(calendar.firstAfter(now + boost::posix_time::seconds(1)), 1);
+  EXPECT_EQ(calendar.firstAfter(now + boost::posix_time::seconds(3)), 3);
+
+  Calendar regular(now, boost::posix_time::minutes(1), 60 * 24 * 365);
+  EXPECT_EQ(regular.at(60), now + boost::posix_time::hours(1));
+  EXPECT_LT(regular.memoryBytes(), 60 * 24 * 365 * 8 + 1'024);
+
+  EXPECT_THROW(Calendar(now, boost::posix_time::seconds(0), 10), std::invalid_argument);
+  EXPECT_THROW(Calendar(now, boost::posix_time::seconds(-1), 10), std::invalid_argument);
+}
+
+TEST(TaskScheduler, shared_calendar_batch) {
+  const int64_t TASKS_NB = 100;
+  const int64_t INSTANTS_NB = 10;
+  const int64_t PERIOD_MS = 50;
+  TaskScheduler scheduler(2, TimerEngine::DeadlineTimer, PurgePolicy::Completed);
+  scheduler.asyncRun();
+
+  // the first instant is in the past, it is ignored
+  boost::posix_time::ptime first = boost::posix_time::microsec_clock::universal_time() - boost::posix_time::milliseconds(PERIOD_MS / 2);
+  auto calendar = std::make_shared<Calendar>(first, boost::posix_time::milliseconds(PERIOD_MS), INSTANTS_NB + 1);
+
+  std::atomic<int64_t> executed_nb {0};
+  std::vector<TaskCallback> callbacks;
+  for (int64_t i = 0; i < TASKS_NB; ++i) {
+    callbacks.emplace_back([&executed_nb]() {
+      ++executed_nb;
+    });
+  }
+  std::vector<TaskId> task_ids = scheduler.createCalendarTasks(std::move(callbacks), calendar);
+  ASSERT_EQ(task_ids.size(), TASKS_NB);
+  // a later call joins the same batch
+  std::vector<TaskCallback> more_callbacks;
+  more_callbacks.emplace_back([&executed_nb]() {
+    ++executed_nb;
+  });
+  TaskId last_id = scheduler.createCalendarTasks(std::move(more_callbacks), calendar).front();
+  Task::Summary summary = scheduler.terminateTask(last_id);
+  EXPECT_EQ(summary.cancelled, INSTANTS_NB);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(INSTANTS_NB * PERIOD_MS + 100));
+  SchedulerStats::Snapshot snapshot = scheduler.statsSnapshot();
+  scheduler.terminate();
+
+  std::cout << "Executed: " << executed_nb << ", lateness p50: " << snapshot.lateness_us.percentile(50) <<
+            " us, p99: " << snapshot.lateness_us.percentile(99) << " us" << std::endl;
+  EXPECT_EQ(executed_nb, TASKS_NB * INSTANTS_NB);
+  EXPECT_EQ(snapshot.lateness_us.count(), TASKS_NB * INSTANTS_NB);
+  EXPECT_EQ(scheduler.tasksNumber(), 0);
+}
+
+CoTask sleepAndCount(TaskScheduler &scheduler, std::atomic<int64_t> &counter, const int64_t &milliseconds) {
+  co_await scheduler.sleep_for(std::chrono::milliseconds(milliseconds));
+  ++counter;
+}
+
+CoTask failAfter(TaskScheduler &scheduler, const int64_t &milliseconds) {
+  co_await scheduler.sleep_for(std::chrono::milliseconds(milliseconds));
+  throw std::runtime_error("child failed");
+}
+
+TEST(TaskScheduler, coroutines) {
+  const int64_t SLEEP_MS = 100;
+  const int64_t COROUTINES_NB = 10;
+  TaskScheduler scheduler(1);
+  scheduler.asyncRun();
+
+  // suspended coroutines do not hold the single worker
+  std::atomic<int64_t> counter {0};
+  auto start = std::chrono::steady_clock::now();
+  for (int64_t i = 0; i < COROUTINES_NB; ++i) {
+    scheduler.spawn(sleepAndCount(scheduler, counter, SLEEP_MS));
+  }
+  EXPECT_EQ(scheduler.coroutinesNumber(), COROUTINES_NB);
+
+  // awaitable completion, absolute time and exception propagation
+  std::atomic_bool caught {false};
+  std::atomic<int64_t> parent_counter {0};
+  boost::posix_time::ptime expiry_time;
+  auto parent = [&]() -> CoTask {
+    co_await sleepAndCount(scheduler, parent_counter, SLEEP_MS);
+    co_await sleepAndCount(scheduler, parent_counter, SLEEP_MS);
+    try {
+      co_await failAfter(scheduler, 0);
+    } catch (const std::runtime_error &) {
+      caught = true;
+    }
+    co_await scheduler.at(boost::posix_time::microsec_clock::universal_time() + boost::posix_time::milliseconds(SLEEP_MS));
+    expiry_time = boost::posix_time::microsec_clock::universal_time();
+  };
+  boost::posix_time::ptime spawn_time = boost::posix_time::microsec_clock::universal_time();
+  scheduler.spawn(parent());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(SLEEP_MS * 3 / 2));
+  EXPECT_EQ(counter, COROUTINES_NB);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(SLEEP_MS * 2));
+  std::this_thread::sleep_for(std::chrono::milliseconds(SLEEP_MS * 2));
+  EXPECT_EQ(parent_counter, 2);
+  EXPECT_TRUE(caught);
+  EXPECT_GE((expiry_time - spawn_time).total_milliseconds(), SLEEP_MS * 3);
+  EXPECT_EQ(scheduler.coroutinesNumber(), 0);
+
+  // a suspended coroutine is destroyed with the scheduler
+  scheduler.spawn(sleepAndCount(scheduler, counter, SLEEP_MS * 100));
+  EXPECT_EQ(scheduler.coroutinesNumber(), 1);
+  scheduler.terminate();
+}
+
+TEST(TaskScheduler, coroutine_awaits_task_completion) {
+  const int64_t PERIOD_MS = 20;
+  const int64_t REPETITIONS = 3;
+  TaskScheduler scheduler(2, TimerEngine::DeadlineTimer, PurgePolicy::Completed);
+  scheduler.asyncRun();
+
+  // a finite task, purged once it has completed, and an infinite one terminated by the coroutine
+  std::atomic<int64_t> executed_nb {0};
+  TaskId finite_id = scheduler.createTimerTask([&executed_nb]() {
+    ++executed_nb;
+  }, PERIOD_MS, REPETITIONS);
+  TaskId infinite_id = scheduler.createTimerTask([]() {}, PERIOD_MS);
+  std::atomic_bool done {false};
+  Task::Summary finite_summary;
+  Task::Summary infinite_summary;
+  auto waiter = [&]() -> CoTask {
+    finite_summary = co_await scheduler.completion(finite_id);
+    EXPECT_EQ(executed_nb, REPETITIONS);
+    CompletionAwaiter infinite_completion = scheduler.completion(infinite_id);
+    scheduler.terminateTask(infinite_id);
+    infinite_summary = co_await infinite_completion;
+    done = true;
+  };
+  scheduler.spawn(waiter());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(PERIOD_MS * (REPETITIONS + 5)));
+  EXPECT_TRUE(done);
+  EXPECT_EQ(finite_summary.executed, REPETITIONS);
+  EXPECT_GT(infinite_summary.cancelled, 0);
+  EXPECT_THROW(scheduler.summaryTask(finite_id), std::runtime_error);
+  EXPECT_THROW(scheduler.completion(finite_id), std::runtime_error);
+  EXPECT_EQ(scheduler.coroutinesNumber(), 0);
+
+  scheduler.terminate();
+
+  // a task completed already, and not purged, resumes its waiter at once
+  TaskScheduler unpurged(1);
+  unpurged.asyncRun();
+  TaskId empty_id = unpurged.createCalendarTask([]() {}, std::queue<boost::posix_time::ptime>());
+  std::this_thread::sleep_for(std::chrono::milliseconds(PERIOD_MS));
+  std::atomic_bool resumed {false};
+  auto late_waiter = [&]() -> CoTask {
+    co_await unpurged.completion(empty_id);
+    resumed = true;
+  };
+  unpurged.spawn(late_waiter());
+  std::this_thread::sleep_for(std::chrono::milliseconds(PERIOD_MS));
+  EXPECT_TRUE(resumed);
+  unpurged.terminate();
+}
+
+TEST(SingleShotTimer, rearm_and_cancel) {
+  std::atomic<int64_t> first_nb {0};
+  std::atomic<int64_t> second_nb {0};
+  SingleShotTimer singleshot;
+  singleshot.scheduleTask(50, [&first_nb]() {
+    ++first_nb;
+  });
+  // re-armed before the expiry, only the last callback is invoked
+  singleshot.scheduleTask(100, [&second_nb]() {
+    ++second_nb;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  EXPECT_EQ(first_nb, 0);
+  EXPECT_EQ(second_nb, 1);
+  EXPECT_FALSE(singleshot.cancel());
+
+  singleshot.scheduleTask(50, [&first_nb]() {
+    ++first_nb;
+  });
+  EXPECT_TRUE(singleshot.cancel());
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(first_nb, 0);
+
+  // the callback destroys its own timer
+  std::atomic_bool deleted {false};
+  SingleShotTimer *owned = new SingleShotTimer();
+  owned->scheduleTask(10, [owned, &deleted]() {
+    delete owned;
+    deleted = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_TRUE(deleted);
+}
+
+TEST(SingleShotTimer, many_single_shots) {
+  const int64_t TIMERS_NB = 100'000;
+  std::atomic<int64_t> executed_nb {0};
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+
+  std::vector<std::unique_ptr<SingleShotTimer>> timers;
+  timers.reserve(TIMERS_NB);
+  for (int64_t i = 0; i < TIMERS_NB; ++i) {
+    timers.push_back(std::make_unique<SingleShotTimer>());
+    timers.back()->scheduleTask(100 + i % 100, [&]() {
+      ++executed_nb;
+      const std::lock_guard<std::mutex> lock(mutex);
+      threads.insert(std::this_thread::get_id());
+    });
+    // half of them are cancelled
+    if (i % 2 == 0) {
+      EXPECT_TRUE(timers.back()->cancel());
+    }
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (executed_nb < TIMERS_NB / 2 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  timers.clear();
+
+  EXPECT_EQ(executed_nb, TIMERS_NB / 2);
+  // all the callbacks are invoked by the thread of the shared service
+  EXPECT_EQ(threads.size(), 1);
+}
+
+TEST(TaskScheduler, priority_dispatch_order) {
+  TaskScheduler scheduler(1, TimerEngine::DeadlineTimer, PurgePolicy::Never, DispatchPolicy::Priority);
+  std::mutex mutex;
+  std::string order;
+  auto append = [&mutex, &order](const char &name) {
+    return [&mutex, &order, name]() {
+      const std::lock_guard<std::mutex> lock(mutex);
+      order += name;
+    };
+  };
+
+  // all the others expire while the single worker is busy
+  scheduler.createTimerTask([]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  }, 10, 1);
+  scheduler.createTimerTask(append('A'), 60, 1);
+  scheduler.createTimerTask(append('B'), 30, 1);
+  scheduler.createTimerTask(append('C'), 45, 1);
+  scheduler.createTimerTask(append('D'), 80, 1, TimerMode::Relative, CatchUpPolicy::FireAll, TaskPriority::High);
+  scheduler.createTimerTask(append('E'), 20, 1, TimerMode::Relative, CatchUpPolicy::FireAll, TaskPriority::Low);
+  scheduler.asyncRun();
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  EXPECT_EQ(scheduler.terminate(), 6);
+
+  // by priority, then earliest deadline first
+  EXPECT_EQ(order, "DBCAE");
+}
+
+TEST(PriorityDispatcher, expiry_on_task_strand) {
+  const int64_t REPETITIONS = 20;
+  boost::asio::io_context io_ctx;
+  PriorityDispatcher dispatcher(io_ctx, 4);
+  std::queue<boost::posix_time::ptime> repetitions;
+  for (int64_t i = 0; i < REPETITIONS; ++i) {
+    repetitions.push(boost::posix_time::microsec_clock::universal_time());
+  }
+  std::shared_ptr<Task> task;
+  std::atomic<int64_t> in_strand_nb {0};
+  task = std::make_shared<CalendarTask>(std::make_unique<DeadlineTaskTimer>(boost::asio::make_strand(io_ctx)), [&task, &in_strand_nb]() {
+    if (task->strand().running_in_this_thread()) {
+      ++in_strand_nb;
+    }
+  }, repetitions);
+  task->setDispatcher(&dispatcher, TaskPriority::Normal);
+  task->start();
+
+  // the expiries are dispatched by several workers, each one on the strand of the task
+  std::vector<std::thread> workers;
+  for (int i = 0; i < 4; ++i) {
+    workers.emplace_back([&io_ctx]() {
+      io_ctx.run();
+    });
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  EXPECT_EQ(task->summary().executed, REPETITIONS);
+  EXPECT_EQ(in_strand_nb, REPETITIONS);
+  EXPECT_EQ(dispatcher.size(), 0);
+}
+
+TEST(TaskScheduler, priority_reserved_workers) {
+  const int64_t PERIOD_MS = 10;
+  const int64_t REPETITIONS = 30;
+  TaskScheduler scheduler(2, TimerEngine::DeadlineTimer, PurgePolicy::Never, DispatchPolicy::Priority);
+  EXPECT_THROW(scheduler.reserveWorkers(TaskPriority::High, 2), std::invalid_argument);
+  scheduler.reserveWorkers(TaskPriority::High, 1);
+
+  // the low priority tasks overload the scheduler, they can only use the non-reserved worker
+  for (int i = 0; i < 4; ++i) {
+    scheduler.createTimerTask([]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }, PERIOD_MS, 0, TimerMode::Relative, CatchUpPolicy::FireAll, TaskPriority::Low);
+  }
+  TaskId heartbeat = scheduler.createTimerTask([]() {}, PERIOD_MS, REPETITIONS, TimerMode::Absolute, CatchUpPolicy::FireAll, TaskPriority::High);
+  scheduler.asyncRun();
+  std::this_thread::sleep_for(std::chrono::milliseconds(PERIOD_MS * REPETITIONS + 100));
+  scheduler.terminate();
+
+  Task::Summary summary = scheduler.summaryTask(heartbeat);
+  std::cout << "High priority lateness p99: " << summary.lateness_us.percentile(99) << " us" << std::endl;
+  EXPECT_EQ(summary.executed, REPETITIONS);
+  EXPECT_LT(summary.lateness_us.percentile(99), 10'000);
+
+  TaskScheduler io_context_scheduler(1);
+  EXPECT_THROW(io_context_scheduler.reserveWorkers(TaskPriority::High, 0), std::logic_error);
+}
+
+TEST(TaskScheduler, admission_control_chaos) {
+  const int64_t TASKS_NB = 12;
+  const int64_t PERIOD_MS = 5;
+  const int64_t REPETITIONS = 200;
+  const int64_t MAX_IN_FLIGHT = 3;
+  const OverlapPolicy POLICIES[] = {OverlapPolicy::Serial, OverlapPolicy::SkipIfRunning, OverlapPolicy::QueueOne, OverlapPolicy::RunConcurrently};
+
+  TaskScheduler scheduler(2);
+  std::atomic<int64_t> rejected_nb {0};
+  scheduler.setAdmissionLimit(MAX_IN_FLIGHT, [&rejected_nb](const TaskId &) {
+    ++rejected_nb;
+  });
+  EXPECT_THROW(scheduler.setAdmissionLimit(MAX_IN_FLIGHT), std::logic_error);
+
+  // randomly slow callbacks, up to 4 periods
+  std::mutex random_mutex;
+  std::mt19937 random(42);
+  std::uniform_int_distribution<int> duration_us(0, PERIOD_MS * 4'000);
+  std::vector<TaskId> task_ids;
+  for (int64_t i = 0; i < TASKS_NB; ++i) {
+    task_ids.push_back(scheduler.createTimerTask([&]() {
+      int sleep_us = 0;
+      {
+        const std::lock_guard<std::mutex> lock(random_mutex);
+        sleep_us = duration_us(random);
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(sleep_us));
+    }, PERIOD_MS, REPETITIONS, TimerMode::Absolute, CatchUpPolicy::Skip, TaskPriority::Normal, POLICIES[i % 4], 2));
+  }
+  scheduler.asyncRun();
+  std::this_thread::sleep_for(std::chrono::milliseconds(PERIOD_MS * REPETITIONS / 2));
+  SchedulerStats::Snapshot running = scheduler.statsSnapshot();
+  std::this_thread::sleep_for(std::chrono::milliseconds(PERIOD_MS * REPETITIONS / 2 + 100));
+
+  // the in-flight executions complete after the termination
+  std::vector<Task::Summary> summaries;
+  for (const TaskId &task_id : task_ids) {
+    scheduler.terminateTask(task_id);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(PERIOD_MS * 4 + 100));
+  for (const TaskId &task_id : task_ids) {
+    summaries.push_back(scheduler.summaryTask(task_id));
+  }
+  SchedulerStats::Snapshot snapshot = scheduler.statsSnapshot();
+  scheduler.terminate();
+
+  std::cout << "Executed: " << snapshot.executed << ", rejected: " << snapshot.rejected << ", peak in flight: " << snapshot.peak_in_flight <<
+            ", lateness p99: " << snapshot.lateness_us.percentile(99) << " us" << std::endl;
+  EXPECT_LE(running.in_flight, MAX_IN_FLIGHT);
+  EXPECT_LE(snapshot.peak_in_flight, MAX_IN_FLIGHT);
+  EXPECT_EQ(snapshot.in_flight, 0);
+  EXPECT_GT(snapshot.rejected, 0);
+  EXPECT_EQ(snapshot.rejected, rejected_nb);
+  // the queues do not grow: the executions are not later than a few slow callbacks
+  EXPECT_LT(snapshot.lateness_us.percentile(99), 100'000);
+
+  int64_t rejected_in_summaries = 0;
+  for (const Task::Summary &summary : summaries) {
+    EXPECT_EQ(summary.executed + summary.skipped + summary.cancelled, REPETITIONS);
+    rejected_in_summaries += summary.rejected;
+  }
+  EXPECT_EQ(rejected_in_summaries, rejected_nb);
+}
+
+TEST(TaskScheduler, terminate_infinite_overlapped) {
+  const int64_t PERIOD_MS = 5;
+  const OverlapPolicy POLICIES[] = {OverlapPolicy::QueueOne, OverlapPolicy::RunConcurrently};
+
+  TaskScheduler scheduler(2);
+  std::vector<TaskId> task_ids;
+  for (const OverlapPolicy &policy : POLICIES) {
+    task_ids.push_back(scheduler.createTimerTask([]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(PERIOD_MS * 4));
+    }, PERIOD_MS, -1, TimerMode::Relative, CatchUpPolicy::FireAll, TaskPriority::Normal, policy, 2));
+  }
+  scheduler.asyncRun();
+  std::this_thread::sleep_for(std::chrono::milliseconds(PERIOD_MS * 3));
+
+  // the executions in flight are cancelled after the infinite pending runs
+  for (const TaskId &task_id : task_ids) {
+    scheduler.terminateTask(task_id);
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(PERIOD_MS * 8 + 100));
+  for (const TaskId &task_id : task_ids) {
+    EXPECT_EQ(scheduler.summaryTask(task_id).cancelled, std::numeric_limits<int64_t>::max());
+  }
+  scheduler.terminate();
+}
+
+TEST(TaskScheduler, snapshot_and_restore) {
+  const int64_t PERIOD_MS = 50;
+  const int64_t REPETITIONS = 6;
+  const std::string path = "task_scheduler_snapshot.bin";
+  std::atomic<int64_t> executed_nb {0};
+  auto count = [&executed_nb]() {
+    ++executed_nb;
+  };
+
+  TaskId timer_id, calendar_id, terminated_id;
+  std::vector<TaskId> shared_ids;
+  {
+    TaskScheduler scheduler(1);
+    timer_id = scheduler.createTimerTask(count, PERIOD_MS, REPETITIONS, TimerMode::Absolute, CatchUpPolicy::FireAll, TaskPriority::High);
+    boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+    std::queue<boost::posix_time::ptime> repetitions;
+    for (int64_t i = 1; i <= REPETITIONS; ++i) {
+      repetitions.push(now + boost::posix_time::milliseconds(i * PERIOD_MS));
+    }
+    calendar_id = scheduler.createCalendarTask(count, repetitions);
+    terminated_id = scheduler.createTimerTask(count, PERIOD_MS);
+    scheduler.terminateTask(terminated_id);
+    auto calendar = std::make_shared<Calendar>(now + boost::posix_time::milliseconds(PERIOD_MS / 2), boost::posix_time::milliseconds(PERIOD_MS), REPETITIONS);
+    std::vector<TaskCallback> callbacks;
+    callbacks.emplace_back(count);
+    callbacks.emplace_back(count);
+    shared_ids = scheduler.createCalendarTasks(std::move(callbacks), calendar);
+
+    scheduler.asyncRun();
+    std::this_thread::sleep_for(std::chrono::milliseconds(PERIOD_MS * 2 + PERIOD_MS / 4));
+    EXPECT_EQ(scheduler.saveSnapshot(path), 5);
+    scheduler.terminate();
+  }
+  int64_t executed_before = executed_nb;
+  EXPECT_EQ(executed_before, 2 * 4);
+
+  TaskScheduler scheduler(1);
+  EXPECT_THROW(scheduler.restoreSnapshot("missing_snapshot.bin", [](const TaskId &) {
+    return TaskCallback();
+  }), std::runtime_error);
+  // the callbacks are provided by TaskId, the tasks without one are not restored
+  EXPECT_EQ(scheduler.restoreSnapshot(path, [&](const TaskId & task_id) {
+    return task_id == shared_ids.back() ? TaskCallback() : TaskCallback(count);
+  }), 4);
+  EXPECT_THROW(scheduler.restoreSnapshot(path, [&](const TaskId &) {
+    return TaskCallback(count);
+  }), std::runtime_error);
+  EXPECT_EQ(scheduler.summaryTask(timer_id).executed, 2);
+  EXPECT_EQ(scheduler.summaryTask(calendar_id).executed, 2);
+  EXPECT_GT(scheduler.summaryTask(terminated_id).cancelled, 0);
+  EXPECT_THROW(scheduler.summaryTask(shared_ids.back()), std::runtime_error);
+
+  // the remaining repetitions
+  scheduler.asyncRun();
+  std::this_thread::sleep_for(std::chrono::milliseconds(PERIOD_MS * REPETITIONS));
+  scheduler.terminate();
+  EXPECT_EQ(scheduler.summaryTask(timer_id).executed, REPETITIONS);
+  EXPECT_EQ(scheduler.summaryTask(calendar_id).executed, REPETITIONS);
+  EXPECT_EQ(scheduler.summaryTask(shared_ids.front()).executed + scheduler.summaryTask(shared_ids.front()).skipped, REPETITIONS);
+  EXPECT_EQ(scheduler.summaryTask(terminated_id).executed, 0);
+  std::remove(path.c_str());
+}
+
+TEST(TaskScheduler, corrupted_snapshot) {
+  const std::string path = "task_scheduler_snapshot.bin";
+  const std::string corrupted_path = "task_scheduler_corrupted.bin";
+  {
+    TaskScheduler scheduler(1, TimerEngine::Simulated);
+    scheduler.createTimerTask([]() {}, 10, 5);
+    std::queue<boost::posix_time::ptime> repetitions;
+    repetitions.push(boost::posix_time::microsec_clock::universal_time() + boost::posix_time::seconds(1));
+    scheduler.createCalendarTask([]() {}, repetitions);
+    EXPECT_EQ(scheduler.saveSnapshot(path), 2);
+  }
+  std::string content;
+  {
+    std::ifstream file(path, std::ios::binary);
+    content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+  ASSERT_EQ(content.size(), sizeof(TaskSnapshot::Header) + 2 * sizeof(TaskSnapshot::Record) + sizeof(int64_t));
+
+  // restore a copy of the file altered by 'corrupt' in a new scheduler
+  int64_t callbacks_nb = 0;
+  auto restore = [&](const std::function<void(TaskSnapshot::Header &, TaskSnapshot::Record *)> &corrupt) {
+    std::string corrupted = content;
+    corrupt(*reinterpret_cast<TaskSnapshot::Header *>(&corrupted[0]),
+            reinterpret_cast<TaskSnapshot::Record *>(&corrupted[sizeof(TaskSnapshot::Header)]));
+    {
+      std::ofstream file(corrupted_path, std::ios::binary | std::ios::trunc);
+      file.write(corrupted.data(), corrupted.size());
+    }
+    TaskScheduler scheduler(1, TimerEngine::Simulated);
+    return scheduler.restoreSnapshot(corrupted_path, [&](const TaskId &) {
+      ++callbacks_nb;
+      return TaskCallback([]() {});
+    });
+  };
+  EXPECT_EQ(restore([](TaskSnapshot::Header &, TaskSnapshot::Record *) {}), 2);
+  EXPECT_EQ(callbacks_nb, 2);
+  callbacks_nb = 0;
+
+  // the counts overflow the size computed from them
+  EXPECT_THROW(restore([](TaskSnapshot::Header &header, TaskSnapshot::Record *) {
+    header.records_nb += std::numeric_limits<uint64_t>::max() / sizeof(TaskSnapshot::Record) + 1;
+  }), std::runtime_error);
+  EXPECT_THROW(restore([](TaskSnapshot::Header &header, TaskSnapshot::Record *) {
+    header.instants_nb += std::numeric_limits<uint64_t>::max() / sizeof(int64_t) + 1;
+  }), std::runtime_error);
+  EXPECT_THROW(restore([](TaskSnapshot::Header &header, TaskSnapshot::Record *) {
+    header.magic = 0;
+  }), std::runtime_error);
+  // the instants of a record are out of the file
+  EXPECT_THROW(restore([](TaskSnapshot::Header &, TaskSnapshot::Record *records) {
+    records[1].instants_offset = std::numeric_limits<uint64_t>::max();
+    records[1].instants_nb = 2;
+  }), std::runtime_error);
+  EXPECT_THROW(restore([](TaskSnapshot::Header &, TaskSnapshot::Record *records) {
+    records[1].instants_nb = 2;
+  }), std::runtime_error);
+
+  // the enums are checked against their last enumerator
+  EXPECT_THROW(restore([](TaskSnapshot::Header &, TaskSnapshot::Record *records) {
+    records[0].priority = static_cast<uint8_t>(TaskPriority::Low) + 1;
+  }), std::runtime_error);
+  EXPECT_THROW(restore([](TaskSnapshot::Header &, TaskSnapshot::Record *records) {
+    records[0].mode = static_cast<uint8_t>(TimerMode::Absolute) + 1;
+  }), std::runtime_error);
+  EXPECT_THROW(restore([](TaskSnapshot::Header &, TaskSnapshot::Record *records) {
+    records[0].catch_up = static_cast<uint8_t>(CatchUpPolicy::Coalesce) + 1;
+  }), std::runtime_error);
+  EXPECT_THROW(restore([](TaskSnapshot::Header &, TaskSnapshot::Record *records) {
+    records[0].overlap = static_cast<uint8_t>(OverlapPolicy::RunConcurrently) + 1;
+  }), std::runtime_error);
+  EXPECT_THROW(restore([](TaskSnapshot::Header &, TaskSnapshot::Record *records) {
+    records[1].kind = static_cast<TaskSnapshot::TaskKind>(0);
+  }), std::runtime_error);
+  EXPECT_THROW(restore([](TaskSnapshot::Header &, TaskSnapshot::Record *records) {
+    records[0].interval_us = -1;
+  }), std::runtime_error);
+
+  // a TaskId twice in the file, or out of the registry bounds
+  EXPECT_THROW(restore([](TaskSnapshot::Header &, TaskSnapshot::Record *records) {
+    records[1].task_id = records[0].task_id;
+  }), std::runtime_error);
+  EXPECT_THROW(restore([](TaskSnapshot::Header &, TaskSnapshot::Record *records) {
+    TaskId task_id = TaskId::fromValue(records[1].task_id);
+    task_id.index = std::numeric_limits<uint32_t>::max();
+    records[1].task_id = task_id.value();
+  }), std::runtime_error);
+  // every record is checked before the first task is restored: the valid first one was not
+  EXPECT_EQ(callbacks_nb, 0);
+
+  // a truncated file
+  content.pop_back();
+  EXPECT_THROW(restore([](TaskSnapshot::Header &, TaskSnapshot::Record *) {}), std::runtime_error);
+  std::remove(path.c_str());
+  std::remove(corrupted_path.c_str());
+}
+
+TEST(TaskScheduler, simulated_clock) {
+  const int64_t HOURS_NB = 24;
+  TaskScheduler scheduler(1, TimerEngine::Simulated);
+  SimulatedClock &clock = scheduler.simulatedClock();
+  boost::posix_time::ptime start = clock.universalTime();
+
+  // a day of schedule: every minute, every hour, and a single shot
+  std::vector<boost::posix_time::ptime> minutes;
+  TaskId minute_id = scheduler.createTimerTask([&]() {
+    minutes.push_back(clock.universalTime());
+  }, 60'000, 0, TimerMode::Absolute);
+  auto calendar = std::make_shared<Calendar>(start + boost::posix_time::hours(1), boost::posix_time::hours(1), HOURS_NB);
+  std::vector<boost::posix_time::ptime> hours;
+  std::vector<TaskCallback> callbacks;
+  callbacks.emplace_back([&]() {
+    hours.push_back(clock.universalTime());
+  });
+  TaskId hour_id = scheduler.createCalendarTasks(std::move(callbacks), calendar).front();
+  int64_t single_shots_nb = 0;
+  SingleShotTimer single_shot(clock);
+  single_shot.scheduleTask(90 * 60'000, [&]() {
+    ++single_shots_nb;
+    EXPECT_EQ(clock.universalTime(), start + boost::posix_time::minutes(90));
+  });
+  SingleShotTimer cancelled(clock);
+  cancelled.scheduleTask(60'000, [&]() {
+    ++single_shots_nb;
+  });
+  EXPECT_TRUE(cancelled.cancel());
+
+  // nothing moves until the time is advanced
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(scheduler.summaryTask(minute_id).executed, 0);
+  EXPECT_EQ(scheduler.advance(std::chrono::seconds(59)), 0);
+
+  auto wall_start = std::chrono::steady_clock::now();
+  scheduler.advance(std::chrono::hours(HOURS_NB) - std::chrono::seconds(59));
+  auto wall_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - wall_start).count();
+  std::cout << "Simulated " << HOURS_NB << " hours in " << wall_ms << " ms" << std::endl;
+
+  EXPECT_EQ(clock.universalTime(), start + boost::posix_time::hours(HOURS_NB));
+  ASSERT_EQ(minutes.size(), HOURS_NB * 60);
+  ASSERT_EQ(hours.size(), HOURS_NB);
+  for (size_t i = 0; i < minutes.size(); ++i) {
+    EXPECT_EQ(minutes[i], start + boost::posix_time::minutes(i + 1));
+  }
+  for (size_t i = 0; i < hours.size(); ++i) {
+    EXPECT_EQ(hours[i], calendar->at(i));
+  }
+  EXPECT_EQ(single_shots_nb, 1);
+  EXPECT_EQ(scheduler.summaryTask(hour_id).executed, HOURS_NB);
+  // in virtual time the tasks are never late
+  SchedulerStats::Snapshot snapshot = scheduler.statsSnapshot();
+  EXPECT_EQ(snapshot.lateness_us.count(), HOURS_NB * 61);
+  EXPECT_EQ(snapshot.lateness_us.max(), 0);
+
+  TaskScheduler real_time(1);
+  EXPECT_THROW(real_time.advance(std::chrono::seconds(1)), std::logic_error);
+}
+
+// Benchmarks are disabled by default, run them with:
+// main --gtest_also_run_disabled_tests --gtest_filter=TaskSchedulerBenchmark.*
+void benchmarkTimerEngine(const TimerEngine &engine, const std::string &engine_name, const int64_t &timers_nb) {
+  using Clock = std::chrono::steady_clock;
+  auto nanosPerTimer = [timers_nb](const Clock::duration & elapsed) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / timers_nb;
+  };
+
+  // schedule & cancel cost, the scheduler is not running so the io thread does not disturb the measure
+  {
+    TaskScheduler scheduler(1, engine);
+    std::vector<TaskId> task_ids;
+    task_ids.reserve(timers_nb);
+
+    auto start = Clock::now();
+    for (int64_t i = 0; i < timers_nb; ++i) {
+      task_ids.push_back(scheduler.createTimerTask([]() {}, 1'000 + i % 60'000, 1));
+    }
+    auto scheduled = Clock::now();
+    for (const auto &task_id : task_ids) {
+      scheduler.terminateTask(task_id);
+    }
+    auto cancelled = Clock::now();
+
+    std::cout << engine_name << " - " << timers_nb << " timers, schedule: " << nanosPerTimer(scheduled - start) <<
+              " ns/timer, cancel: " << nanosPerTimer(cancelled - scheduled) << " ns/timer" << std::endl;
+  }
+
+  // firing jitter: timers spread along a few seconds
+  {
+    const int64_t FIRST_DELAY_MS = 2'000;
+    const int64_t SPREAD_MS = 4'000;
+
+    TaskScheduler scheduler(1, engine);
+    scheduler.asyncRun();
+
+    std::vector<int64_t> lateness_us(timers_nb, 0);
+    std::atomic<int64_t> fired_nb {0};
+    for (int64_t i = 0; i < timers_nb; ++i) {
+      int64_t delay_ms = FIRST_DELAY_MS + i % SPREAD_MS;
+      Clock::time_point expected = Clock::now() + std::chrono::milliseconds(delay_ms);
+      scheduler.createTimerTask([&lateness_us, &fired_nb, expected, i]() {
+        lateness_us[i] = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - expected).count();
+        ++fired_nb;
+      }, delay_ms, 1);
+    }
+
+    auto deadline = Clock::now() + std::chrono::milliseconds(FIRST_DELAY_MS + SPREAD_MS + 30'000);
+    while (fired_nb < timers_nb && Clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    scheduler.terminate();
+    EXPECT_EQ(fired_nb, timers_nb);
+
+    std::sort(lateness_us.begin(), lateness_us.end());
+    int64_t mean_us = std::accumulate(lateness_us.begin(), lateness_us.end(), 0LL) / timers_nb;
+    std::cout << engine_name << " - " << timers_nb << " timers, lateness mean: " << mean_us <<
+              " us, p50: " << lateness_us[timers_nb / 2] <<
+              " us, p99: " << lateness_us[timers_nb * 99 / 100] <<
+              " us, max: " << lateness_us.back() << " us" << std::endl;
+  }
+}
+
+TEST(TaskSchedulerBenchmark, DISABLED_timer_engines) {
+  for (int64_t timers_nb : {100'000LL, 1'000'000LL}) {
+    benchmarkTimerEngine(TimerEngine::DeadlineTimer, "deadline_timer", timers_nb);
+    benchmarkTimerEngine(TimerEngine::TimingWheel, "timing_wheel", timers_nb);
+  }
+}
+
+TEST(TaskSchedulerBenchmark, DISABLED_thread_pool_cpu_bound_scaling) {
+  const int CORES_NB = std::max(1U, std::thread::hardware_concurrency());
+  const int64_t TASKS_NB = 64;
+  const int64_t RUN_MS = 500;
+
+  // every callback burns 1 ms of CPU and its period is shorter, so the workers are always busy
+  auto throughput = [&](const int &threads_nb) {
+    TaskScheduler scheduler(threads_nb);
+    std::atomic<int64_t> executed_nb {0};
+    for (int64_t i = 0; i < TASKS_NB; ++i) {
+      scheduler.createTimerTask([&executed_nb]() {
+        auto start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(1)) {}
+        ++executed_nb;
+      }, 1);
+    }
+    scheduler.asyncRun();
+    std::this_thread::sleep_for(std::chrono::milliseconds(RUN_MS));
+    scheduler.terminate();
+    return executed_nb * 1'000LL / RUN_MS;
+  };
+
+  const int64_t single_thread = throughput(1);
+  std::cout << "1 thread: " << single_thread << " executions/s" << std::endl;
+  for (int threads_nb = 2; threads_nb <= CORES_NB; threads_nb *= 2) {
+    const int64_t multi_thread = throughput(threads_nb);
+    const double speedup = static_cast<double>(multi_thread) / single_thread;
+    // wall-clock scaling depends on the host, it is only printed
+    std::cout << threads_nb << " threads: " << multi_thread << " executions/s, speedup: " << speedup << std::endl;
+  }
+}
+
+// the former registry: a std::map keyed by an uuid string under a single lock
+class LegacyTaskRegistry {
+ public:
+  std::string insert(std::shared_ptr<Task> task) {
+    std::string id = boost::uuids::to_string(boost::uuids::random_generator()());
+    const std::lock_guard<std::mutex> lock(mutex_);
+    tasks_[id] = task;
+    return id;
+  }
+  std::shared_ptr<Task> erase(const std::string &id) {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    auto it = tasks_.find(id);
+    if (it == tasks_.end()) {
+      return std::shared_ptr<Task>();
+    }
+    std::shared_ptr<Task> task = it->second;
+    tasks_.erase(it);
+    return task;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::map<std::string, std::shared_ptr<Task>> tasks_;
+};
+
+// every thread creates tasks, queries and terminates them, return operations per second
+template <typename Registry>
+int64_t benchmarkRegistry(Registry &registry, const int &threads_nb, const int64_t &tasks_per_thread) {
+  std::shared_ptr<Task> task = std::make_shared<CalendarTask>(nullptr, []() {}, std::queue<boost::posix_time::ptime>());
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threads_nb; ++t) {
+    threads.emplace_back([&]() {
+      for (int64_t i = 0; i < tasks_per_thread; ++i) {
+        auto task_id = registry.insert(task);
+        registry.erase(task_id);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  return threads_nb * tasks_per_thread * 1'000'000LL / std::max<int64_t>(elapsed_us, 1);
+}
+
+TEST(TaskSchedulerBenchmark, DISABLED_registry_contention) {
+  const int THREADS_NB = 16;
+  const int64_t TASKS_PER_THREAD = 100'000;
+
+  LegacyTaskRegistry legacy;
+  std::cout << "std::map + uuid - " << THREADS_NB << " threads: " << benchmarkRegistry(legacy, THREADS_NB, TASKS_PER_THREAD) << " create/terminate per second" << std::endl;
+  TaskRegistry registry;
+  std::cout << "TaskRegistry - " << THREADS_NB << " threads: " << benchmarkRegistry(registry, THREADS_NB, TASKS_PER_THREAD) << " create/terminate per second" << std::endl;
+
+  // end to end: the scheduler creates the timers too
+  TaskScheduler scheduler(1);
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS_NB; ++t) {
+    threads.emplace_back([&scheduler]() {
+      for (int64_t i = 0; i < TASKS_PER_THREAD / 10; ++i) {
+        scheduler.terminateTask(scheduler.createTimerTask([]() {}, 60'000, 1));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "TaskScheduler - " << THREADS_NB << " threads: " << THREADS_NB * TASKS_PER_THREAD / 10 * 1'000'000LL / elapsed_us << " create/terminate per second" << std::endl;
+}
+
+TEST(TaskSchedulerBenchmark, DISABLED_task_creation_allocations) {
+  const int64_t TASKS_NB = 100'000;
+  for (auto engine : {TimerEngine::DeadlineTimer, TimerEngine::TimingWheel}) {
+    TaskScheduler scheduler(1, engine, PurgePolicy::Completed);
+    scheduler.asyncRun();
+    scheduler.createTimerTask([]() {}, 60'000);
+
+    // warm up with all the tasks alive at once, then steady state
+    for (auto phase : {std::make_pair("warm up", 2'000), std::make_pair("steady state", 1)}) {
+      int64_t elapsed_ns = 0;
+      int64_t allocations_nb = createAndPurgeTasks(scheduler, TASKS_NB, phase.second, elapsed_ns);
+      std::cout << (engine == TimerEngine::TimingWheel ? "timing_wheel" : "deadline_timer") << " - " << phase.first <<
+                ": " << static_cast<double>(allocations_nb) / TASKS_NB << " allocations/task, " <<
+                elapsed_ns / TASKS_NB << " ns/task" << std::endl;
+    }
+    scheduler.terminate();
+  }
+}
+
+// CPU time of the process, all threads included
+int64_t processCpuMicroseconds() {
+  return static_cast<int64_t>(std::clock()) * 1'000'000LL / CLOCKS_PER_SEC;
+}
+
+TEST(TaskSchedulerBenchmark, DISABLED_calendar_batch) {
+  const int64_t TASKS_NB = 10'000;
+  const int64_t INSTANTS_NB = 500'000;
+  // only the first instants are dispatched during the benchmark, the others are one per minute
+  const int64_t DISPATCHED_NB = 50;
+  const int64_t DISPATCH_PERIOD_MS = 20;
+
+  boost::posix_time::ptime first = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::seconds(2);
+  std::vector<boost::posix_time::ptime> instants;
+  instants.reserve(INSTANTS_NB);
+  for (int64_t i = 0; i < INSTANTS_NB; ++i) {
+    instants.push_back(i < DISPATCHED_NB ? first + boost::posix_time::milliseconds(i * DISPATCH_PERIOD_MS) :
+                       first + boost::posix_time::minutes(i));
+  }
+  std::atomic<int64_t> executed_nb {0};
+  auto waitDispatches = [&executed_nb, TASKS_NB, DISPATCHED_NB]() {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (executed_nb < TASKS_NB * DISPATCHED_NB && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  };
+
+  // shared calendar
+  {
+    TaskScheduler scheduler(1);
+    int64_t allocated_bytes = thread_allocated_bytes;
+    auto start = std::chrono::steady_clock::now();
+    auto calendar = std::make_shared<Calendar>(instants);
+    std::vector<TaskCallback> callbacks;
+    for (int64_t i = 0; i < TASKS_NB; ++i) {
+      callbacks.emplace_back([&executed_nb]() {
+        ++executed_nb;
+      });
+    }
+    scheduler.createCalendarTasks(std::move(callbacks), calendar);
+    auto created = std::chrono::steady_clock::now();
+    allocated_bytes = thread_allocated_bytes - allocated_bytes;
+
+    int64_t cpu_us = processCpuMicroseconds();
+    scheduler.asyncRun();
+    waitDispatches();
+    cpu_us = processCpuMicroseconds() - cpu_us;
+    scheduler.terminate();
+    EXPECT_EQ(executed_nb, TASKS_NB * DISPATCHED_NB);
+
+    std::cout << "shared calendar - " << TASKS_NB << " tasks x " << INSTANTS_NB << " instants, memory: " << allocated_bytes / 1'024 <<
+              " KB, creation: " << std::chrono::duration_cast<std::chrono::milliseconds>(created - start).count() <<
+              " ms, dispatch CPU: " << cpu_us * 1'000 / executed_nb << " ns/execution" << std::endl;
+  }
+
+  // a queue per task: only the dispatched instants, the memory of the whole calendar is extrapolated
+  {
+    executed_nb = 0;
+    first = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::seconds(2);
+    std::queue<boost::posix_time::ptime> repetitions;
+    for (int64_t i = 0; i < DISPATCHED_NB; ++i) {
+      repetitions.push(first + boost::posix_time::milliseconds(i * DISPATCH_PERIOD_MS));
+    }
+
+    TaskScheduler scheduler(1);
+    int64_t allocated_bytes = thread_allocated_bytes;
+    for (int64_t i = 0; i < TASKS_NB; ++i) {
+      scheduler.createCalendarTask([&executed_nb]() {
+        ++executed_nb;
+      }, repetitions);
+    }
+    allocated_bytes = thread_allocated_bytes - allocated_bytes;
+
+    int64_t cpu_us = processCpuMicroseconds();
+    scheduler.asyncRun();
+    waitDispatches();
+    cpu_us = processCpuMicroseconds() - cpu_us;
+    scheduler.terminate();
+    EXPECT_EQ(executed_nb, TASKS_NB * DISPATCHED_NB);
+
+    std::cout << "queue per task - " << TASKS_NB << " tasks x " << DISPATCHED_NB << " instants, memory: " << allocated_bytes / 1'024 <<
+              " KB (x " << INSTANTS_NB << " instants: " << TASKS_NB * INSTANTS_NB * static_cast<int64_t>(sizeof(boost::posix_time::ptime)) / (1'024 * 1'024) <<
+              " MB), dispatch CPU: " << cpu_us * 1'000 / executed_nb << " ns/execution" << std::endl;
+  }
+}
+
+CoTask periodicLoop(TaskScheduler &scheduler, std::atomic<int64_t> &counter, const int64_t &milliseconds, const int64_t &repetitions) {
+  for (int64_t i = 0; i < repetitions; ++i) {
+    co_await scheduler.sleep_for(std::chrono::milliseconds(milliseconds));
+    ++counter;
+  }
+}
+
+TEST(TaskSchedulerBenchmark, DISABLED_coroutine_loops) {
+  const int64_t LOOPS_NB = 100'000;
+  const int64_t REPETITIONS = 10;
+  const int64_t PERIOD_MS = 200;
+
+  auto benchmark = [&](const std::string & name, const std::function<void(TaskScheduler &, std::atomic<int64_t> &)> &create) {
+    TaskScheduler scheduler(1, TimerEngine::TimingWheel);
+    std::atomic<int64_t> executed_nb {0};
+    int64_t allocated_bytes = thread_allocated_bytes;
+    create(scheduler, executed_nb);
+    allocated_bytes = thread_allocated_bytes - allocated_bytes;
+
+    int64_t cpu_us = processCpuMicroseconds();
+    scheduler.asyncRun();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+    while (executed_nb < LOOPS_NB * REPETITIONS && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    cpu_us = processCpuMicroseconds() - cpu_us;
+    scheduler.terminate();
+    EXPECT_EQ(executed_nb, LOOPS_NB * REPETITIONS);
+
+    std::cout << name << " - " << LOOPS_NB << " loops x " << REPETITIONS << ", memory: " << allocated_bytes / LOOPS_NB <<
+              " bytes/loop, CPU: " << cpu_us * 1'000 / std::max<int64_t>(executed_nb, 1) << " ns/iteration" << std::endl;
+  };
+
+  benchmark("coroutines", [&](TaskScheduler & scheduler, std::atomic<int64_t> &executed_nb) {
+    for (int64_t i = 0; i < LOOPS_NB; ++i) {
+      scheduler.spawn(periodicLoop(scheduler, executed_nb, PERIOD_MS, REPETITIONS));
+    }
+  });
+  benchmark("timer tasks", [&](TaskScheduler & scheduler, std::atomic<int64_t> &executed_nb) {
+    for (int64_t i = 0; i < LOOPS_NB; ++i) {
+      scheduler.createTimerTask([&executed_nb]() {
+        ++executed_nb;
+      }, PERIOD_MS, REPETITIONS);
+    }
+  });
+}
+TEST(TaskSchedulerBenchmark, DISABLED_priority_overload) {
+  const int THREADS_NB = 4;
+  const int64_t LOW_TASKS_NB = 64;
+  const int64_t HIGH_TASKS_NB = 8;
+  const int64_t PERIOD_MS = 10;
+  const int64_t DURATION_MS = 3'000;
+
+  auto benchmark = [&](const std::string & name, const DispatchPolicy & dispatch) {
+    TaskScheduler scheduler(THREADS_NB, TimerEngine::DeadlineTimer, PurgePolicy::Never, dispatch);
+    if (dispatch == DispatchPolicy::Priority) {
+      scheduler.reserveWorkers(TaskPriority::High, 1);
+    }
+    // maintenance: 64 tasks x 2 ms every 10 ms need 12.8 workers
+    for (int64_t i = 0; i < LOW_TASKS_NB; ++i) {
+      scheduler.createTimerTask([]() {
+        auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(2);
+        while (std::chrono::steady_clock::now() < end);
+      }, PERIOD_MS, 0, TimerMode::Relative, CatchUpPolicy::FireAll, TaskPriority::Low);
+    }
+    std::vector<TaskId> heartbeats;
+    for (int64_t i = 0; i < HIGH_TASKS_NB; ++i) {
+      heartbeats.push_back(scheduler.createTimerTask([]() {}, PERIOD_MS, 0, TimerMode::Absolute, CatchUpPolicy::FireAll, TaskPriority::High));
+    }
+    scheduler.asyncRun();
+    std::this_thread::sleep_for(std::chrono::milliseconds(DURATION_MS));
+    scheduler.terminate();
+
+    CoarseHistogram lateness_us;
+    for (const TaskId &task_id : heartbeats) {
+      lateness_us.merge(scheduler.summaryTask(task_id).lateness_us);
+    }
+    std::cout << name << " - high priority executions: " << lateness_us.count() << ", lateness p50: " << lateness_us.percentile(50) <<
+              " us, p99: " << lateness_us.percentile(99) << " us, max: " << lateness_us.max() << " us" << std::endl;
+  };
+
+  benchmark("io_context order", DispatchPolicy::IoContext);
+  benchmark("priority + 1 reserved worker", DispatchPolicy::Priority);
+}
+TEST(TaskSchedulerBenchmark, DISABLED_snapshot_restore) {
+  const int64_t TASKS_NB = 1'000'000;
+  const std::string path = "task_scheduler_benchmark.bin";
+  using Clock = std::chrono::steady_clock;
+  auto millisSince = [](const Clock::time_point & start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+  };
+
+  // every task has been running for a while, its state and its counters are saved
+  {
+    TaskScheduler scheduler(1, TimerEngine::TimingWheel);
+    auto start = Clock::now();
+    for (int64_t i = 0; i < TASKS_NB; ++i) {
+      scheduler.createTimerTask([]() {}, 60'000 + i % 1'000, 1'000, TimerMode::Absolute);
+    }
+    std::cout << "create from config - " << TASKS_NB << " tasks: " << millisSince(start) << " ms" << std::endl;
+
+    start = Clock::now();
+    scheduler.saveSnapshot(path);
+    std::cout << "save - " << TASKS_NB << " tasks: " << millisSince(start) << " ms, " <<
+              std::ifstream(path, std::ios::binary | std::ios::ate).tellg() / (1'024 * 1'024) << " MB" << std::endl;
+  }
+
+  TaskScheduler scheduler(1, TimerEngine::TimingWheel);
+  auto start = Clock::now();
+  size_t restored_nb = scheduler.restoreSnapshot(path, [](const TaskId &) {
+    return TaskCallback([]() {});
+  });
+  std::cout << "restore - " << restored_nb << " tasks: " << millisSince(start) << " ms" << std::endl;
+  EXPECT_EQ(restored_nb, TASKS_NB);
+  EXPECT_EQ(scheduler.tasksNumber(), TASKS_NB);
+  std::remove(path.c_str());
+}
+
+TEST(TaskSchedulerBenchmark, DISABLED_simulated_firings) {
+  const int64_t TASKS_NB = 1'000;
+  const int64_t HOURS_NB = 1;
+  TaskScheduler scheduler(1, TimerEngine::Simulated);
+  int64_t executed_nb = 0;
+  for (int64_t i = 0; i < TASKS_NB; ++i) {
+    scheduler.createTimerTask([&executed_nb]() {
+      ++executed_nb;
+    }, 1'000 + i % 100, 0, TimerMode::Absolute);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  size_t dispatched_nb = scheduler.advance(std::chrono::hours(HOURS_NB));
+  int64_t wall_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  EXPECT_EQ(dispatched_nb, executed_nb);
+  std::cout << "simulated clock - " << TASKS_NB << " tasks over " << HOURS_NB << " hour: " << executed_nb << " firings in " <<
+            wall_us / 1'000 << " ms, " << executed_nb * 1'000'000 / std::max<int64_t>(wall_us, 1) << " firings/s" << std::endl;
+}
 
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
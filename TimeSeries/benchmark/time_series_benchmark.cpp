@@ -0,0 +1,269 @@
+#include <vector>
+#include <memory>
+
+#include <benchmark/benchmark.h>
+
+#include "time_series.hpp"
+
+// ns per addSample(): TimeSeries<T, U> (heap algorithm, two virtual calls per sample)
+// against StaticTimeSeries<SIZE, T, Algo> (algorithm held by value, calls inlined)
+const std::size_t MAX_SIZE = 64;
+const std::size_t CONFIDENCES_SIZE = 18;
+
+// the virtual version of AccumulatedConfidences, which is not a BestAlgorithm
+class VirtualAccumulatedConfidences : public BestAlgorithm<std::vector<float>, float> {
+public:
+  void clear() override { acc_.clear(); }
+  void removeOldValue(const std::vector<float>& value) override { acc_.removeOldValue(value); }
+  void addNewValue(const std::vector<float>& value) override { acc_.addNewValue(value); }
+  float getBestValue() const override { return 0.f; }
+  AccumulatedConfidences<CONFIDENCES_SIZE> acc_;
+};
+
+// a few distinct track ids
+std::vector<unsigned int> trackIds() {
+  std::vector<unsigned int> values;
+  for (unsigned int i = 0; i < 1024; ++i) {
+    values.push_back((i * 7) % 16);
+  }
+  return values;
+}
+
+std::vector<unsigned int> bitmasks() {
+  std::vector<unsigned int> values;
+  for (unsigned int i = 0; i < 1024; ++i) {
+    values.push_back((1u << (i % 5)) | (1u << (i % 3 + 10)));
+  }
+  return values;
+}
+
+std::vector<float> floats() {
+  std::vector<float> values;
+  for (unsigned int i = 0; i < 1024; ++i) {
+    values.push_back(i * 0.1f);
+  }
+  return values;
+}
+
+std::vector<std::vector<float>> confidences() {
+  std::vector<std::vector<float>> values;
+  for (unsigned int i = 0; i < 64; ++i) {
+    values.push_back(std::vector<float>(CONFIDENCES_SIZE, i * 0.01f));
+  }
+  return values;
+}
+
+template <typename TimeSeriesType, typename T>
+void addSamples(benchmark::State& state, TimeSeriesType& ts, const std::vector<T>& values) {
+  uint64_t timestamp = 0;
+  for (auto _ : state) {
+    ts.addSample(values[timestamp % values.size()], timestamp);
+    ++timestamp;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/// NewestValue
+static void BM_NewestValue_Virtual(benchmark::State& state) {
+  TimeSeries<float, float> ts(MAX_SIZE, std::make_unique<NewestValue<float, float>>());
+  addSamples(state, ts, floats());
+  benchmark::DoNotOptimize(ts.getBestValue());
+}
+BENCHMARK(BM_NewestValue_Virtual);
+
+static void BM_NewestValue_Static(benchmark::State& state) {
+  StaticTimeSeries<MAX_SIZE, float, NewestValue<float, float>> ts;
+  addSamples(state, ts, floats());
+  benchmark::DoNotOptimize(ts.getBestValue());
+}
+BENCHMARK(BM_NewestValue_Static);
+
+/// TopFrequency
+static void BM_TopFrequency_Virtual(benchmark::State& state) {
+  TimeSeries<unsigned int, unsigned int> ts(MAX_SIZE, std::make_unique<TopFrequency<unsigned int, unsigned int>>());
+  addSamples(state, ts, trackIds());
+  benchmark::DoNotOptimize(ts.getBestValue());
+}
+BENCHMARK(BM_TopFrequency_Virtual);
+
+static void BM_TopFrequency_Static(benchmark::State& state) {
+  StaticTimeSeries<MAX_SIZE, unsigned int, TopFrequency<unsigned int, unsigned int>> ts;
+  addSamples(state, ts, trackIds());
+  benchmark::DoNotOptimize(ts.getBestValue());
+}
+BENCHMARK(BM_TopFrequency_Static);
+
+/// TopFrequencyBitmask
+static void BM_TopFrequencyBitmask_Virtual(benchmark::State& state) {
+  TimeSeries<unsigned int, unsigned int> ts(MAX_SIZE, std::make_unique<TopFrequencyBitmask>(2));
+  addSamples(state, ts, bitmasks());
+  benchmark::DoNotOptimize(ts.getBestValue());
+}
+BENCHMARK(BM_TopFrequencyBitmask_Virtual);
+
+static void BM_TopFrequencyBitmask_Static(benchmark::State& state) {
+  StaticTimeSeries<MAX_SIZE, unsigned int, TopFrequencyBitmask> ts(2);
+  addSamples(state, ts, bitmasks());
+  benchmark::DoNotOptimize(ts.getBestValue());
+}
+BENCHMARK(BM_TopFrequencyBitmask_Static);
+
+/// AccumulatedConfidences
+static void BM_AccumulatedConfidences_Virtual(benchmark::State& state) {
+  TimeSeries<std::vector<float>, float> ts(MAX_SIZE, std::make_unique<VirtualAccumulatedConfidences>());
+  addSamples(state, ts, confidences());
+  benchmark::DoNotOptimize(ts.samples().back().value_.data());
+}
+BENCHMARK(BM_AccumulatedConfidences_Virtual);
+
+static void BM_AccumulatedConfidences_Static(benchmark::State& state) {
+  StaticTimeSeries<MAX_SIZE, std::vector<float>, AccumulatedConfidences<CONFIDENCES_SIZE>> ts;
+  addSamples(state, ts, confidences());
+  benchmark::DoNotOptimize(ts.algorithm().acc_confidences_.data());
+}
+BENCHMARK(BM_AccumulatedConfidences_Static);
+
+/// Storage: a scan over the values of a full series, and addSample()
+const std::size_t SCAN_SIZE = 4096;
+
+template <typename TimeSeriesType>
+void fill(TimeSeriesType& ts) {
+  for (uint64_t i = 0; i < SCAN_SIZE + SCAN_SIZE / 3; ++i) {
+    ts.addSample(i * 0.5f, i);
+  }
+}
+
+static void BM_ScanValues_Circular(benchmark::State& state) {
+  StaticTimeSeries<SCAN_SIZE, float, NullAlgorithm<float, float>, CircularStorage<float>> ts;
+  fill(ts);
+  for (auto _ : state) {
+    float sum = 0.f;
+    for (const auto& sample : ts.samples()) {
+      sum += sample.value_;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * SCAN_SIZE);
+}
+BENCHMARK(BM_ScanValues_Circular);
+
+static void BM_ScanValues_CircularCopy(benchmark::State& state) {
+  StaticTimeSeries<SCAN_SIZE, float, NullAlgorithm<float, float>, CircularStorage<float>> ts;
+  fill(ts);
+  for (auto _ : state) {
+    float sum = 0.f;
+    for (const float& value : ts.valuesCopy()) {
+      sum += value;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * SCAN_SIZE);
+}
+BENCHMARK(BM_ScanValues_CircularCopy);
+
+static void BM_ScanValues_Columnar(benchmark::State& state) {
+  StaticTimeSeries<SCAN_SIZE, float, NullAlgorithm<float, float>, ColumnarStorage<float>> ts;
+  fill(ts);
+  for (auto _ : state) {
+    // span by span: the compiler vectorizes the contiguous loops
+    float sum = 0.f;
+    auto values = ts.values();
+    for (const float& value : values.first()) {
+      sum += value;
+    }
+    for (const float& value : values.second()) {
+      sum += value;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * SCAN_SIZE);
+}
+BENCHMARK(BM_ScanValues_Columnar);
+
+static void BM_AddSample_Circular(benchmark::State& state) {
+  StaticTimeSeries<MAX_SIZE, float, NewestValue<float, float>, CircularStorage<float>> ts;
+  addSamples(state, ts, floats());
+}
+BENCHMARK(BM_AddSample_Circular);
+
+static void BM_AddSample_Columnar(benchmark::State& state) {
+  StaticTimeSeries<MAX_SIZE, float, NewestValue<float, float>, ColumnarStorage<float>> ts;
+  addSamples(state, ts, floats());
+}
+BENCHMARK(BM_AddSample_Columnar);
+
+/// Time ranges: binary searches over a full series, the timestamps are 0, 1, 2...
+static void BM_Window_Circular(benchmark::State& state) {
+  StaticTimeSeries<SCAN_SIZE, float, NullAlgorithm<float, float>, CircularStorage<float>> ts;
+  fill(ts);
+  uint64_t duration = 1;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ts.window(duration).size());
+    duration = duration % SCAN_SIZE + 7;
+  }
+}
+BENCHMARK(BM_Window_Circular);
+
+static void BM_Window_Columnar(benchmark::State& state) {
+  StaticTimeSeries<SCAN_SIZE, float, NullAlgorithm<float, float>, ColumnarStorage<float>> ts;
+  fill(ts);
+  uint64_t duration = 1;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ts.window(duration).size());
+    duration = duration % SCAN_SIZE + 7;
+  }
+}
+BENCHMARK(BM_Window_Columnar);
+
+/// TopFrequency with high cardinality: 10k distinct track ids, getBestValue() after every sample
+// the former TopFrequency, a scan of all the counts ever seen
+class ScanTopFrequency final : public BestAlgorithm<unsigned int, unsigned int> {
+public:
+  void clear() override { count_map_.clear(); }
+  void removeOldValue(const unsigned int& value) override { count_map_[value]--; }
+  void addNewValue(const unsigned int& value) override { count_map_[value]++; }
+  unsigned int getBestValue() const override {
+    unsigned int best_value = 0;
+    std::size_t max_count = 0;
+    for (const auto& pair : count_map_) {
+      if (pair.second > max_count) {
+        max_count = pair.second;
+        best_value = pair.first;
+      }
+    }
+    return best_value;
+  }
+private:
+  std::unordered_map<unsigned int, unsigned int> count_map_;
+};
+
+std::vector<unsigned int> manyTrackIds() {
+  std::vector<unsigned int> values;
+  for (unsigned int i = 0; i < 10000; ++i) {
+    values.push_back((i * 7919) % 10000);
+  }
+  return values;
+}
+
+template <typename TimeSeriesType>
+void addSamplesAndGetBest(benchmark::State& state, TimeSeriesType& ts, const std::vector<unsigned int>& values) {
+  uint64_t timestamp = 0;
+  for (auto _ : state) {
+    ts.addSample(values[timestamp % values.size()], timestamp);
+    benchmark::DoNotOptimize(ts.getBestValue());
+    ++timestamp;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_TopFrequency_HighCardinality_Scan(benchmark::State& state) {
+  StaticTimeSeries<MAX_SIZE, unsigned int, ScanTopFrequency> ts;
+  addSamplesAndGetBest(state, ts, manyTrackIds());
+}
+BENCHMARK(BM_TopFrequency_HighCardinality_Scan);
+
+static void BM_TopFrequency_HighCardinality(benchmark::State& state) {
+  StaticTimeSeries<MAX_SIZE, unsigned int, TopFrequency<unsigned int, unsigned int>> ts;
+  addSamplesAndGetBest(state, ts, manyTrackIds());
+}
+BENCHMARK(BM_TopFrequency_HighCardinality);
@@ -0,0 +1,22 @@
+#include "allocation_counter.h"
+
+#include <new>
+#include <cstdlib>
+
+thread_local int64_t thread_allocations_nb = 0;
+
+void* operator new(std::size_t size) {
+  ++thread_allocations_nb;
+  if (void* ptr = std::malloc(size ? size : 1)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+  std::free(ptr);
+}
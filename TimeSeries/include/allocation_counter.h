@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstdint>
+
+// Allocations of the calling thread, counted by the global operator new replaced in allocation_counter.cpp,
+// to check the accessors which must not allocate.
+// The replacement lives in its own translation unit: no new-expression of the tests is compiled
+// next to the free() of the replaced operator delete, so -Wmismatched-new-delete stays quiet.
+extern thread_local int64_t thread_allocations_nb;
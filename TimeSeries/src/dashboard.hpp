@@ -30,7 +30,7 @@ public:
   // returns empty std::shared_ptr if doesn't exists
   std::shared_ptr<TimeSeries<T, U>> getTimeSeries(const std::string& key) {
     auto it = map_.find(key);
-    if (it == map.enmd()) { //not found
+    if (it == map_.end()) { //not found
       return std::shared_ptr<TimeSeries<T, U>>(); // return empty ptr
     }
     return it->second;
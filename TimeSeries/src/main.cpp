@@ -13,6 +13,7 @@
 #include "time_series.hpp"
 #include "dashboard.hpp"
 #include "../include/utils.h"
+#include "../include/allocation_counter.h"
 
 void printMsg(const std::string &msg) {
   std::cout << "msg: " << msg << std::endl;
@@ -29,11 +30,10 @@ struct MyClass {
   }
 };
 
-/*
-TEST(TimeSeries, out_of_range) {
+TEST(StaticTimeSeries, out_of_range) {
   const size_t MAX_SIZE = 13;
   int NB_SAMPLES = 2370;
-  TimeSeries<MAX_SIZE, int> timeseries;
+  StaticTimeSeries<MAX_SIZE, int> timeseries;
 
   try {
     Sample<int> newest = timeseries.newestSample();
@@ -57,10 +57,10 @@ TEST(TimeSeries, out_of_range) {
 
 }
 
-TEST(TimeSeries, fill_and_retrieve) {
+TEST(StaticTimeSeries, fill_and_retrieve) {
   const size_t MAX_SIZE = 13;
   int NB_SAMPLES = 2370;
-  TimeSeries<MAX_SIZE, int> timeseries;
+  StaticTimeSeries<MAX_SIZE, int> timeseries;
 
   EXPECT_EQ(timeseries.capacity(), MAX_SIZE);
 
@@ -81,12 +81,12 @@ TEST(TimeSeries, fill_and_retrieve) {
 }
 
 
-TEST(TimeSeries, interator_oldest_first) {
+TEST(StaticTimeSeries, interator_oldest_first) {
   const size_t MAX_SIZE = 13;
   int NB_SAMPLES = 2370;
 
 
-  TimeSeries<MAX_SIZE, int> timeseries;
+  StaticTimeSeries<MAX_SIZE, int> timeseries;
 
   for (int i = 1; i <= NB_SAMPLES; ++i) {
     timeseries.addSample(i, i);
@@ -113,12 +113,12 @@ TEST(TimeSeries, interator_oldest_first) {
 
 }
 
-TEST(TimeSeries, interator_newest_first) {
+TEST(StaticTimeSeries, interator_newest_first) {
   const size_t MAX_SIZE = 13;
   int NB_SAMPLES = 2370;
 
 
-  TimeSeries<MAX_SIZE, int> timeseries;
+  StaticTimeSeries<MAX_SIZE, int> timeseries;
 
   for (int i = 1; i <= NB_SAMPLES; ++i) {
     timeseries.addSample(i, i);
@@ -164,7 +164,331 @@ TEST(TimeSeries, interator_newest_first) {
   EXPECT_EQ(nb_iterations, (MAX_SIZE - 1)/2);
 
 }
-*/
+
+TEST(StaticTimeSeries, inlined_algorithms) {
+  const size_t MAX_SIZE = 3;
+
+  StaticTimeSeries<MAX_SIZE, float, NewestValue<float, float>> newest;
+  newest.addSample(0.1f, 1);
+  newest.addSample(0.2f, 2);
+  EXPECT_EQ(0.2f, newest.getBestValue());
+
+  StaticTimeSeries<MAX_SIZE, unsigned int, TopFrequency<unsigned int, unsigned int>> top;
+  top.addSample(7, 1);
+  top.addSample(7, 2);
+  top.addSample(3, 3);
+  EXPECT_EQ(7u, top.getBestValue());
+  // the first 7 is removed
+  top.addSample(3, 4);
+  EXPECT_EQ(3u, top.getBestValue());
+
+  // max_flags is forwarded to the algorithm
+  StaticTimeSeries<6, unsigned int, TopFrequencyBitmask> bitmask(2);
+  bitmask.addSample(0x00000001 << 5, 1);
+  bitmask.addSample(0x00000001 << 5, 2);
+  bitmask.addSample(0x00000001 << 3, 3);
+  bitmask.addSample(0x00000001 << 3, 4);
+  bitmask.addSample(0x00000001 << 0, 5);
+  bitmask.addSample(0x00000001 << 1, 6);
+  EXPECT_EQ((0x00000001 << 5) | (0x00000001 << 3), bitmask.getBestValue());
+
+  StaticTimeSeries<MAX_SIZE, std::vector<float>, AccumulatedConfidences<2>> confidences;
+  confidences.addSample({ 0.5f, 0.25f }, 1);
+  confidences.addSample({ 0.5f, 0.25f }, 2);
+  confidences.addSample({ 0.5f, 0.25f }, 3);
+  confidences.addSample({ 1.f, 0.f }, 4);
+  EXPECT_EQ(std::vector<float>({ 2.f, 0.5f }), confidences.algorithm().acc_confidences_);
+}
+
+
+TEST(ColumnarStorage, fill_and_views) {
+  const size_t MAX_SIZE = 13;
+  int NB_SAMPLES = 2370;
+  StaticTimeSeries<MAX_SIZE, int, NullAlgorithm<int, int>, ColumnarStorage<int>> timeseries;
+
+  EXPECT_EQ(timeseries.capacity(), MAX_SIZE);
+  EXPECT_TRUE(timeseries.values().empty());
+  EXPECT_THROW(timeseries.newestSample(), std::out_of_range);
+
+  bool wrapped = false;
+  for (int i = 1; i <= NB_SAMPLES; ++i) {
+    timeseries.addSample(i, 1000 + i);
+    EXPECT_EQ(timeseries.size(), std::min<size_t>(i, MAX_SIZE));
+
+    // the views hold the same samples as the copy, oldest first
+    auto values = timeseries.values();
+    auto timestamps = timeseries.timestamps();
+    ASSERT_EQ(values.size(), timeseries.size());
+    ASSERT_EQ(values.first().size() + values.second().size(), timeseries.size());
+    wrapped = wrapped || !values.second().empty();
+    const std::vector<int> copy = timeseries.valuesCopy();
+    int pos = 0;
+    for (const int& value : values) {
+      ASSERT_EQ(value, copy[pos]);
+      ASSERT_EQ(timestamps[pos], 1000 + value);
+      ++pos;
+    }
+    ASSERT_EQ(pos, (int)timeseries.size());
+  }
+  // 13 samples in 16 slots: the views are split once the ring wraps
+  EXPECT_TRUE(wrapped);
+
+  EXPECT_EQ(timeseries.oldestSample().value_, NB_SAMPLES - MAX_SIZE + 1);
+  EXPECT_EQ(timeseries.newestSample().value_, NB_SAMPLES);
+  EXPECT_EQ(timeseries.at(1).timestamp_, 1000 + NB_SAMPLES - MAX_SIZE + 2);
+
+  timeseries.clear();
+  EXPECT_TRUE(timeseries.empty());
+  EXPECT_TRUE(timeseries.values().empty());
+  EXPECT_EQ(timeseries.values().begin(), timeseries.values().end());
+
+  // a power of two samples fill every slot: the second span ends where the first one begins
+  StaticTimeSeries<8, int, NullAlgorithm<int, int>, ColumnarStorage<int>> full;
+  for (int i = 1; i <= 13; ++i) {
+    full.addSample(i, i);
+  }
+  EXPECT_EQ(8, std::distance(full.values().begin(), full.values().end()));
+  EXPECT_EQ(6, *full.values().begin());
+}
+
+TEST(ColumnarStorage, drop_in_backend) {
+  const size_t MAX_SIZE = 13;
+  unsigned int NB_SAMPLES = 2370;
+  TimeSeries<unsigned int, unsigned int, ColumnarStorage<unsigned int>> ts(MAX_SIZE,
+    std::make_unique<TopFrequency<unsigned int, unsigned int>>());
+
+  for (unsigned int i = 1; i <= NB_SAMPLES; ++i) {
+    ts.addSample(i, i);
+  }
+  ts.addSample(NB_SAMPLES, NB_SAMPLES + 1);
+  EXPECT_EQ(ts.oldestSample().value_, NB_SAMPLES - MAX_SIZE + 2);
+  EXPECT_EQ(NB_SAMPLES, ts.getBestValue());
+
+  StaticTimeSeries<3, std::vector<float>, AccumulatedConfidences<2>, ColumnarStorage<std::vector<float>>> confidences;
+  for (int i = 0; i < 10; ++i) {
+    confidences.addSample({ 0.5f, 0.25f }, i);
+  }
+  EXPECT_EQ(std::vector<float>({ 1.5f, 0.75f }), confidences.algorithm().acc_confidences_);
+  EXPECT_EQ(std::vector<float>({ 0.5f, 0.25f }), confidences.values()[2]);
+}
+
+TEST(ZeroCopy, reference_accessors) {
+  const size_t MAX_SIZE = 10;
+  const size_t ATTR_SIZE = 42;
+  TimeSeries<std::vector<float>, std::vector<float>> ts(MAX_SIZE);
+
+  for (int i = 1; i <= 25; ++i) {
+    ts.addSample(std::vector<float>(ATTR_SIZE, (float)i), i);
+  }
+
+  int64_t allocations = thread_allocations_nb;
+  const Sample<std::vector<float>>& oldest = ts.oldestSample();
+  const Sample<std::vector<float>>& newest = ts.newestSample();
+  const Sample<std::vector<float>>& middle = ts.at(5);
+  const std::vector<float>& newest_value = ts.newestValue();
+  float sum = 0.f;
+  for (const auto& sample : ts.samplesView()) {
+    sum += sample.value_[0];
+  }
+  auto view = ts.samplesView();
+  for (std::size_t pos = 0; pos < view.size(); ++pos) {
+    sum += view[pos].value_[1];
+  }
+  EXPECT_EQ(allocations, thread_allocations_nb);
+
+  // they refer to the samples of the ring
+  EXPECT_EQ(&ts.samples().front(), &oldest);
+  EXPECT_EQ(&ts.samples().back(), &newest);
+  EXPECT_EQ(&ts.samples()[5], &middle);
+  EXPECT_EQ(&newest.value_, &newest_value);
+  EXPECT_EQ(16.f, oldest.value_[0]);
+  EXPECT_EQ(21.f, middle.value_[0]);
+  EXPECT_EQ(2.f * (16 + 25) * MAX_SIZE / 2, sum);
+  // 10 samples in 10 slots, after 25 insertions the ring has wrapped
+  EXPECT_EQ(MAX_SIZE, view.first().size() + view.second().size());
+  EXPECT_FALSE(view.second().empty());
+
+  // one vector per sample and the vector of vectors
+  ts.valuesCopy();
+  EXPECT_EQ(allocations + static_cast<int64_t>(MAX_SIZE) + 1, thread_allocations_nb);
+}
+
+TEST(ZeroCopy, columnar_steady_state) {
+  const size_t MAX_SIZE = 10;
+  const size_t ATTR_SIZE = 42;
+  StaticTimeSeries<MAX_SIZE, std::vector<float>, AccumulatedConfidences<ATTR_SIZE>,
+    ColumnarStorage<std::vector<float>>> ts;
+  const std::vector<float> detection(ATTR_SIZE, 0.5f);
+
+  // the slots get their vectors during the first lap
+  for (int i = 1; i <= 16; ++i) {
+    ts.addSample(detection, i);
+  }
+
+  int64_t allocations = thread_allocations_nb;
+  for (int i = 17; i <= 1000; ++i) {
+    ts.addSample(detection, i);
+  }
+  float sum = 0.f;
+  for (const auto& value : ts.values()) {
+    sum += value[0];
+  }
+  uint64_t last = 0;
+  for (const auto& timestamp : ts.timestamps()) {
+    EXPECT_LT(last, timestamp);
+    last = timestamp;
+  }
+  sum += ts.oldestValue()[0] + ts.newestValue()[0];
+  EXPECT_EQ(allocations, thread_allocations_nb);
+
+  EXPECT_EQ(0.5f * (MAX_SIZE + 2), sum);
+  EXPECT_EQ(1000u, last);
+  EXPECT_EQ(0.5f * MAX_SIZE, ts.algorithm().acc_confidences_[ATTR_SIZE - 1]);
+}
+
+TEST(TimeRange, range_since_window) {
+  const size_t MAX_SIZE = 13;
+  StaticTimeSeries<MAX_SIZE, int> circular;
+  StaticTimeSeries<MAX_SIZE, int, NullAlgorithm<int, int>, ColumnarStorage<int>> columnar;
+
+  // timestamps 10, 20, ... 300, the rings have wrapped: 180 to 300 remain
+  for (int i = 1; i <= 30; ++i) {
+    circular.addSample(i, 10 * i);
+    columnar.addSample(i, 10 * i);
+  }
+
+  auto range = circular.range(195, 250);
+  ASSERT_EQ(5u, range.size());
+  EXPECT_EQ(200u, range[0].timestamp_);
+  EXPECT_EQ(240u, range[4].timestamp_);
+  // [begin, end)
+  EXPECT_EQ(6u, circular.range(190, 250).size());
+  EXPECT_EQ(0u, circular.range(250, 250).size());
+  EXPECT_EQ(0u, circular.range(260, 250).size());
+  EXPECT_EQ(MAX_SIZE, circular.range(0, 1000).size());
+  EXPECT_EQ(0u, circular.range(310, 1000).size());
+
+  int expected = 20;
+  for (const auto& sample : circular.range(195, 250)) {
+    EXPECT_EQ(expected++, sample.value_);
+  }
+  EXPECT_EQ(25, expected);
+
+  auto columns = columnar.range(195, 250);
+  ASSERT_EQ(5u, columns.size());
+  EXPECT_EQ(200u, columns.timestamps_[0]);
+  EXPECT_EQ(24, columns.values_[4]);
+  expected = 20;
+  for (const auto& value : columns.values_) {
+    EXPECT_EQ(expected++, value);
+  }
+  EXPECT_EQ(25, expected);
+
+  EXPECT_EQ(4u, circular.since(270).size());
+  EXPECT_EQ(4u, columnar.since(270).size());
+  EXPECT_EQ(27, columnar.since(270).values_[0]);
+  EXPECT_EQ(MAX_SIZE, columnar.since(0).size());
+
+  // younger than 35: 300, 290, 280, 270
+  EXPECT_EQ(4u, circular.window(35).size());
+  EXPECT_EQ(3u, columnar.window(30).size());
+  EXPECT_EQ(28, columnar.window(30).values_[0]);
+  EXPECT_EQ(0u, columnar.window(0).size());
+  EXPECT_EQ(MAX_SIZE, circular.window(1000).size());
+
+  circular.clear();
+  EXPECT_EQ(0u, circular.window(1000).size());
+  EXPECT_EQ(0u, circular.range(0, 1000).size());
+}
+
+TEST(TimeRange, max_age) {
+  const size_t MAX_SIZE = 100;
+  TimeSeries<unsigned int, unsigned int> ts(MAX_SIZE, std::make_unique<TopFrequency<unsigned int, unsigned int>>());
+  StaticTimeSeries<MAX_SIZE, unsigned int, TopFrequency<unsigned int, unsigned int>, ColumnarStorage<unsigned int>> columnar;
+  // the last 50 ms, timestamps in microseconds
+  ts.setMaxAge(50000);
+  columnar.setMaxAge(50000);
+
+  // a sample every 10 ms, the value 7 first, then the value 3
+  for (unsigned int i = 0; i < 20; ++i) {
+    ts.addSample(i < 12 ? 7 : 3, 10000 * i);
+    columnar.addSample(i < 12 ? 7 : 3, 10000 * i);
+    EXPECT_EQ(std::min(i + 1, 5u), ts.size());
+    EXPECT_EQ(std::min(i + 1, 5u), columnar.size());
+  }
+  EXPECT_EQ(150000u, ts.oldestSample().timestamp_);
+  EXPECT_EQ(150000u, columnar.oldestSample().timestamp_);
+  // the evicted samples have been removed from the algorithm
+  EXPECT_EQ(3u, ts.getBestValue());
+  EXPECT_EQ(3u, columnar.getBestValue());
+
+  // a gap: everything but the new sample is too old
+  ts.addSample(7, 1000000);
+  EXPECT_EQ(1u, ts.size());
+  EXPECT_EQ(7u, ts.getBestValue());
+
+  // a timestamp going backwards evicts nothing
+  ts.addSample(7, 990000);
+  EXPECT_EQ(2u, ts.size());
+  // zero is NO_MAX_AGE, the new sample is kept
+  columnar.setMaxAge(0);
+  columnar.addSample(3, 200000);
+  columnar.addSample(3, 2000000);
+  EXPECT_EQ(7u, columnar.size());
+
+  // the capacity still applies
+  ts.setMaxAge(NO_MAX_AGE);
+  for (unsigned int i = 0; i < 2 * MAX_SIZE; ++i) {
+    ts.addSample(i, 2000000 + i);
+  }
+  EXPECT_EQ(MAX_SIZE, ts.size());
+}
+
+TEST(TopFrequency, incremental_mode) {
+  const size_t MAX_SIZE = 13;
+  int NB_SAMPLES = 20000;
+  StaticTimeSeries<MAX_SIZE, unsigned int, TopFrequency<unsigned int, unsigned int>> ts;
+
+  std::srand(42);
+  for (int i = 1; i <= NB_SAMPLES; ++i) {
+    // a few frequent values among many rare ones
+    unsigned int value = std::rand() % 3 == 0 ? std::rand() % 4 : std::rand() % 10000;
+    ts.addSample(value, i);
+
+    // the mode by brute force
+    std::unordered_map<unsigned int, std::size_t> counts;
+    std::size_t max_count = 0;
+    for (const auto& sample : ts.samples()) {
+      max_count = std::max(max_count, ++counts[sample.value_]);
+    }
+    ASSERT_EQ(max_count, counts[ts.getBestValue()]);
+    // the values which left the TimeSeries are not kept
+    ASSERT_EQ(counts.size(), ts.algorithm().distinctValues());
+  }
+
+  // the copy has its own buckets
+  auto copy = ts;
+  ts.clear();
+  EXPECT_EQ(0u, ts.getBestValue());
+  EXPECT_EQ(0u, ts.algorithm().distinctValues());
+  copy.addSample(123456, NB_SAMPLES + 1);
+  copy.addSample(123456, NB_SAMPLES + 2);
+  copy.addSample(123456, NB_SAMPLES + 3);
+  copy.addSample(123456, NB_SAMPLES + 4);
+  EXPECT_EQ(123456u, copy.getBestValue());
+
+  // the moved-from algorithm is empty and still usable
+  auto moved = std::move(copy);
+  EXPECT_EQ(123456u, moved.getBestValue());
+  EXPECT_EQ(0u, copy.getBestValue());
+  EXPECT_EQ(0u, copy.algorithm().distinctValues());
+  TopFrequency<unsigned int, unsigned int> algorithm;
+  algorithm = std::move(moved.algorithm());
+  EXPECT_EQ(123456u, algorithm.getBestValue());
+  EXPECT_EQ(0u, moved.getBestValue());
+  moved.algorithm().addNewValue(7);
+  EXPECT_EQ(7u, moved.getBestValue());
+}
 
 /// Dashboard
 TEST(Dashboard, creation_top_frequency) {
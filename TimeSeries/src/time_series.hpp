@@ -1,11 +1,20 @@
 #pragma once
 
+#include <array>
 #include <vector>
 #include <queue>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <iterator>
 #include <functional>
+#include <type_traits>
+#include <unordered_map>
 #include <boost/circular_buffer.hpp>
 
 #define NO_TIMESTAMP 0ULL
+#define NO_MAX_AGE 0ULL
 /**
 * @brief Sample
 * T is the attribute type
@@ -29,14 +38,281 @@ struct Pose {
   Joint joints_[JOINT_TOTAL];
 };
 
+/**
+* @brief Span a contiguous sequence of T, which it does not own
+*/
+template <typename T>
+class Span {
+public:
+  Span() : data_(nullptr), size_(0) {}
+  Span(T* data, std::size_t size) : data_(data), size_(size) {}
+
+  T* data() const { return data_; }
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  T* begin() const { return data_; }
+  T* end() const { return data_ + size_; }
+  T& operator[](const std::size_t& pos) const { return data_[pos]; }
+
+private:
+  T* data_;
+  std::size_t size_;
+};
+
+/**
+* @brief RingView a zero-copy view of the content of a ring, oldest first:
+* the first span runs up to the end of the ring storage, the second one from its beginning
+* It is invalidated by the next change of the TimeSeries
+*/
+template <typename T>
+class RingView {
+public:
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::remove_const_t<T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T*;
+    using reference = T&;
+
+    // second_begin is nullptr when there is no second span
+    iterator(T* current, T* first_end, T* second_begin, bool in_second) :
+      current_(current), first_end_(first_end), second_begin_(second_begin), in_second_(in_second) {}
+
+    T& operator*() const { return *current_; }
+    T* operator->() const { return current_; }
+    iterator& operator++() {
+      if (++current_ == first_end_ && !in_second_ && second_begin_) {
+        current_ = second_begin_;
+        in_second_ = true;
+      }
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator previous = *this;
+      ++*this;
+      return previous;
+    }
+    // when the ring is full, the end of the second span is the beginning of the first one
+    bool operator==(const iterator& other) const { return current_ == other.current_ && in_second_ == other.in_second_; }
+    bool operator!=(const iterator& other) const { return !(*this == other); }
+
+  private:
+    T* current_;
+    T* first_end_;
+    T* second_begin_;
+    bool in_second_;
+  };
+
+  RingView() {}
+  RingView(const Span<T>& first, const Span<T>& second) :
+    first_(first.empty() ? second : first), second_(first.empty() ? Span<T>() : second) {}
+
+  const Span<T>& first() const { return first_; }
+  const Span<T>& second() const { return second_; }
+  std::size_t size() const { return first_.size() + second_.size(); }
+  bool empty() const { return size() == 0; }
+
+  // postition zero is the oldest
+  T& operator[](const std::size_t& pos) const {
+    return pos < first_.size() ? first_[pos] : second_[pos - first_.size()];
+  }
+
+  // the count elements from postition pos, without copy
+  RingView slice(const std::size_t& pos, const std::size_t& count) const {
+    if (pos >= first_.size()) {
+      return RingView(Span<T>(second_.data() + (pos - first_.size()), count), Span<T>());
+    }
+    std::size_t first = std::min(count, first_.size() - pos);
+    return RingView(Span<T>(first_.data() + pos, first), Span<T>(second_.data(), count - first));
+  }
+
+  iterator begin() const {
+    return iterator(first_.begin(), first_.end(), second_.empty() ? nullptr : second_.begin(), false);
+  }
+  iterator end() const {
+    if (second_.empty()) {
+      return iterator(first_.end(), first_.end(), nullptr, false);
+    }
+    return iterator(second_.end(), first_.end(), second_.begin(), true);
+  }
+
+private:
+  Span<T> first_;
+  Span<T> second_;
+};
+
+/**
+* @brief CircularStorage the samples of a TimeSeries in a boost::circular_buffer, timestamp and value side by side
+*/
+template <typename T>
+class CircularStorage {
+public:
+  using View = RingView<const Sample<T>>;
+
+  explicit CircularStorage(const std::size_t& max_size) : buffer_(max_size) {}
+
+  void clear() { buffer_.clear(); }
+  std::size_t size() const { return buffer_.size(); }
+  std::size_t capacity() const { return buffer_.capacity(); }
+  bool empty() const { return buffer_.empty(); }
+  bool full() const { return buffer_.full(); }
+
+  void push_back(const T& value, const uint64_t& timestamp) {
+    buffer_.push_back(Sample<T>(value, timestamp));
+  }
+
+  void pop_front() { buffer_.pop_front(); }
+
+  // the position of the first sample whose timestamp is not less than time, binary search
+  std::size_t lowerBound(const uint64_t& time) const {
+    auto it = std::lower_bound(buffer_.begin(), buffer_.end(), time,
+      [](const Sample<T>& sample, const uint64_t& time) { return sample.timestamp_ < time; });
+    return it - buffer_.begin();
+  }
+
+  // postition zero is the oldest
+  const T& value(const std::size_t& pos) const { return buffer_[pos].value_; }
+  const uint64_t& timestamp(const std::size_t& pos) const { return buffer_[pos].timestamp_; }
+  const Sample<T>& sample(const std::size_t& pos) const { return buffer_[pos]; }
+
+  // oldest first
+  const boost::circular_buffer<Sample<T>>& buffer() const { return buffer_; }
+
+  RingView<const Sample<T>> samplesView() const {
+    auto first = buffer_.array_one();
+    auto second = buffer_.array_two();
+    return RingView<const Sample<T>>(Span<const Sample<T>>(first.first, first.second),
+      Span<const Sample<T>>(second.first, second.second));
+  }
+
+  // the samples in the positions [first, last)
+  View view(const std::size_t& first, const std::size_t& last) const {
+    return samplesView().slice(first, last - first);
+  }
+
+private:
+  boost::circular_buffer<Sample<T>> buffer_;
+};
+
+/**
+* @brief ColumnarView zero-copy views of the two columns of a ColumnarStorage, over the same samples
+*/
+template <typename T>
+struct ColumnarView {
+  std::size_t size() const { return values_.size(); }
+  bool empty() const { return values_.empty(); }
+
+  RingView<const uint64_t> timestamps_;
+  RingView<const T> values_;
+};
+
+/**
+* @brief ColumnarStorage the samples of a TimeSeries as two columns, the timestamps and the values:
+* a scan over one column does not drag the other one through the cache.
+* The ring has a power of two slots, indexed with a mask, and holds up to max_size samples
+*/
+template <typename T>
+class ColumnarStorage {
+public:
+  using View = ColumnarView<T>;
+
+  explicit ColumnarStorage(const std::size_t& max_size) :
+    capacity_(max_size), mask_(roundUpToPowerOfTwo(max_size) - 1),
+    timestamps_(mask_ + 1), values_(mask_ + 1) {}
+
+  // the values are kept, e.g. the memory of std::vector values is reused
+  void clear() {
+    head_ = 0;
+    size_ = 0;
+  }
+  std::size_t size() const { return size_; }
+  std::size_t capacity() const { return capacity_; }
+  bool empty() const { return size_ == 0; }
+  bool full() const { return size_ == capacity_; }
+
+  void push_back(const T& value, const uint64_t& timestamp) {
+    if (capacity_ == 0) {
+      return;
+    }
+    // assigned in place: no allocation once the slot holds a value
+    std::size_t slot = (head_ + size_) & mask_;
+    values_[slot] = value;
+    timestamps_[slot] = timestamp;
+    if (size_ < capacity_) {
+      ++size_;
+    } else {
+      head_ = (head_ + 1) & mask_;
+    }
+  }
+
+  void pop_front() {
+    head_ = (head_ + 1) & mask_;
+    --size_;
+  }
+
+  // the position of the first sample whose timestamp is not less than time, binary search
+  std::size_t lowerBound(const uint64_t& time) const {
+    std::size_t first = 0;
+    std::size_t count = size_;
+    while (count > 0) {
+      std::size_t step = count / 2;
+      if (timestamp(first + step) < time) {
+        first += step + 1;
+        count -= step + 1;
+      } else {
+        count = step;
+      }
+    }
+    return first;
+  }
+
+  // postition zero is the oldest
+  const T& value(const std::size_t& pos) const { return values_[(head_ + pos) & mask_]; }
+  const uint64_t& timestamp(const std::size_t& pos) const { return timestamps_[(head_ + pos) & mask_]; }
+  Sample<T> sample(const std::size_t& pos) const { return Sample<T>(value(pos), timestamp(pos)); }
+
+  RingView<const T> values() const { return columnView(values_.data()); }
+  RingView<const uint64_t> timestamps() const { return columnView(timestamps_.data()); }
+
+  // the samples in the positions [first, last)
+  View view(const std::size_t& first, const std::size_t& last) const {
+    return View{ timestamps().slice(first, last - first), values().slice(first, last - first) };
+  }
+
+private:
+  static std::size_t roundUpToPowerOfTwo(const std::size_t& size) {
+    std::size_t power = 1;
+    while (power < size) {
+      power <<= 1;
+    }
+    return power;
+  }
+
+  template <typename V>
+  RingView<const V> columnView(const V* column) const {
+    std::size_t first = std::min(size_, mask_ + 1 - head_);
+    return RingView<const V>(Span<const V>(column + head_, first), Span<const V>(column, size_ - first));
+  }
+
+  std::size_t capacity_;
+  std::size_t mask_;
+  std::size_t head_{ 0 };
+  std::size_t size_{ 0 };
+  std::vector<uint64_t> timestamps_;
+  std::vector<T> values_;
+};
+
 
 /**
 * @brief BestAlgorithm is an abstract base class that traits TimeSeries 
 * in order to find best value of the time series
+* The algorithms below are final: held by value in a StaticTimeSeries, their calls are inlined.
 */
 template<typename T, typename U>
 class BestAlgorithm {
 public:
+  virtual ~BestAlgorithm() = default;
   virtual void clear() = 0;
   virtual void removeOldValue(const T& value) = 0;
   virtual void addNewValue(const T& value) = 0;
@@ -48,13 +324,13 @@ public:
 * It does not compute Best Value nor Best Confidence from TimeSeries. It does nothing.
 */
 template <typename T, typename U>
-class NullAlgorithm: public BestAlgorithm<T, U> {
+class NullAlgorithm final : public BestAlgorithm<T, U> {
 public:
   void clear() override {}
   void removeOldValue(const T& value) override {}
   void addNewValue(const T& value) override { }
   U getBestValue() const override {
-    return 0;
+    return U();
   }
 };
 
@@ -63,7 +339,7 @@ public:
 * The best value, is the last added (the newest)
 */
 template <typename T, typename U>
-class NewestValue : public BestAlgorithm<T, U> {
+class NewestValue final : public BestAlgorithm<T, U> {
 public:
   void clear() override { best_value_ = 0; }
   void removeOldValue(const T& value) override {}
@@ -77,74 +353,183 @@ public:
 /**
 * @brief TopFrequency
 * Best Value is the most frequently occurring value in the TimeSeries.
+* The values are grouped by count (count of counts): adding or removing a value moves it to the next
+* or the previous group, so the mode is kept up to date in O(1), and a value whose count drops to zero is erased.
 */
 template <typename T, typename U>
-class TopFrequency : public BestAlgorithm<T, U> {
+class TopFrequency final : public BestAlgorithm<T, U> {
 public:
-  void clear() override { count_map_.clear(); }
-  void removeOldValue(const T& value) override { count_map_[value]--; }
-  void addNewValue(const T& value) override { count_map_[value]++; }
+  TopFrequency() = default;
+  // the buckets point to the nodes of counts_: they are rebuilt for a copy
+  TopFrequency(const TopFrequency& other) : counts_(other.counts_), max_count_(other.max_count_) {
+    relink();
+  }
+  TopFrequency& operator=(const TopFrequency& other) {
+    counts_ = other.counts_;
+    max_count_ = other.max_count_;
+    relink();
+    return *this;
+  }
+  // the nodes are moved with counts_, so the buckets still point to them, and other is left empty
+  TopFrequency(TopFrequency&& other) :
+    counts_(std::move(other.counts_)), buckets_(std::move(other.buckets_)), max_count_(other.max_count_) {
+    other.clear();
+  }
+  TopFrequency& operator=(TopFrequency&& other) {
+    if (this != &other) {
+      counts_ = std::move(other.counts_);
+      buckets_ = std::move(other.buckets_);
+      max_count_ = other.max_count_;
+      other.clear();
+    }
+    return *this;
+  }
+
+  void clear() override {
+    counts_.clear();
+    buckets_.clear();
+    max_count_ = 0;
+  }
+
+  void removeOldValue(const T& value) override {
+    auto it = counts_.find(value);
+    if (it == counts_.end()) {
+      return;
+    }
+    Entry& entry = it->second;
+    unlink(&*it);
+    // this value was the last one with the highest count, it still has the next one
+    if (entry.count_ == max_count_ && buckets_[max_count_].empty()) {
+      --max_count_;
+    }
+    // no zero count is kept
+    if (--entry.count_ == 0) {
+      counts_.erase(it);
+    } else {
+      link(&*it);
+    }
+  }
+
+  void addNewValue(const T& value) override {
+    auto it = counts_.try_emplace(value).first;
+    if (it->second.count_ > 0) {
+      unlink(&*it);
+    }
+    ++it->second.count_;
+    link(&*it);
+    max_count_ = std::max(max_count_, it->second.count_);
+  }
+
+  // one of the most frequent values, O(1)
   U getBestValue() const override {
-    U best_value = 0;
-    std::size_t max_count = 0;
-    for (const auto& pair : count_map_) {
-      if (pair.second > max_count) {
-        max_count = pair.second;
-        best_value = pair.first;
-      }
+    if (max_count_ == 0) {
+      return U();
     }
-    return best_value;
+    return buckets_[max_count_].front()->first;
   }
+
+  // number of distinct values in the TimeSeries
+  std::size_t distinctValues() const {
+    return counts_.size();
+  }
+
 private:
-  std::unordered_map<T, U> count_map_;
+  struct Entry {
+    std::size_t count_{ 0 };
+    // position in buckets_[count_]
+    std::size_t index_{ 0 };
+  };
+  // the nodes of an unordered_map are not moved by a rehash
+  using Node = typename std::unordered_map<T, Entry>::value_type;
+
+  void link(Node* node) {
+    Entry& entry = node->second;
+    if (buckets_.size() <= entry.count_) {
+      buckets_.resize(entry.count_ + 1);
+    }
+    std::vector<Node*>& bucket = buckets_[entry.count_];
+    entry.index_ = bucket.size();
+    bucket.push_back(node);
+  }
+
+  void relink() {
+    buckets_.clear();
+    for (Node& node : counts_) {
+      link(&node);
+    }
+  }
+
+  void unlink(Node* node) {
+    Entry& entry = node->second;
+    std::vector<Node*>& bucket = buckets_[entry.count_];
+    // the last node of the bucket fills the hole
+    Node* last = bucket.back();
+    bucket[entry.index_] = last;
+    last->second.index_ = entry.index_;
+    bucket.pop_back();
+  }
+
+  // count of every value in the TimeSeries
+  std::unordered_map<T, Entry> counts_;
+  // buckets_[count] are the values seen count times, so the mode is in buckets_[max_count_]
+  std::vector<std::vector<Node*>> buckets_;
+  std::size_t max_count_{ 0 };
 };
 
 /**
 * @brief TopFrequencyBitmask
 * It computes Best Value from number of occurrences of bits position in a bitmask values.
 */
-class TopFrequencyBitmask : public BestAlgorithm<unsigned int, unsigned int> {
+class TopFrequencyBitmask final : public BestAlgorithm<unsigned int, unsigned int> {
 public:
   TopFrequencyBitmask(const unsigned int& max_flags = 1) : BestAlgorithm<unsigned int, unsigned int>(), max_flags_(max_flags) {}
   void clear() override { 
-    count_map_.clear();
+    count_.fill(0);
   }
   void removeOldValue(const unsigned int& value) override { 
-    // remove old value bit mask from the counter map
-    for (unsigned int k = 0; k < MAX_BITS_; ++k) {
-      if ((value & (1 << k)) != 0) {
-        count_map_[k]--;
-      }
+    // remove old value bit mask from the counters, only the set bits are visited
+    for (unsigned int bits = value; bits != 0; bits &= bits - 1) {
+      count_[lowestBit(bits)]--;
     }
   }
   void addNewValue(const unsigned int& value) override { 
     // count the bit position
-    for (unsigned int k = 0; k < MAX_BITS_; ++k) {
-      if ((value & (1 << k)) != 0) {
-        count_map_[k]++;
-      }
+    for (unsigned int bits = value; bits != 0; bits &= bits - 1) {
+      count_[lowestBit(bits)]++;
     }
   }
   unsigned int getBestValue() const override {
-    // compute best_value_
+    // the max_flags_ most frequent bits, the lowest bit first on ties
     unsigned int best_value = 0;
-    using Pair = std::pair<unsigned int, unsigned int>;
-    struct CompareCount {
-      bool operator() (const Pair& l, const Pair& r) const { return r.second > l.second; }
-    };
-    std::priority_queue<Pair, std::vector<Pair>, CompareCount> queue(count_map_.begin(), count_map_.end());
-
-    for (unsigned int i = 0; (i < max_flags_ && !queue.empty()); ++i) {
-      best_value |= (1 << queue.top().first);
-      queue.pop();
+    for (unsigned int i = 0; i < max_flags_; ++i) {
+      unsigned int best_bit = MAX_BITS_;
+      for (unsigned int k = 0; k < MAX_BITS_; ++k) {
+        if (count_[k] > 0 && (best_value & (1u << k)) == 0 && (best_bit == MAX_BITS_ || count_[k] > count_[best_bit])) {
+          best_bit = k;
+        }
+      }
+      if (best_bit == MAX_BITS_) {
+        break;
+      }
+      best_value |= (1u << best_bit);
     }
 
     return best_value;
   }
 
 private:
-  const unsigned int MAX_BITS_{ 32 };
-  std::unordered_map<unsigned int, unsigned int> count_map_;
+  // position of the lowest set bit of a non-zero value (de Bruijn multiplication)
+  static unsigned int lowestBit(const unsigned int& bits) {
+    static constexpr unsigned int POSITIONS[32] = {
+      0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+      31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+    };
+    return POSITIONS[((bits & (0u - bits)) * 0x077CB531u) >> 27];
+  }
+
+  static constexpr unsigned int MAX_BITS_{ 32 };
+  // occurrences of every bit position
+  std::array<unsigned int, MAX_BITS_> count_{};
   unsigned int max_flags_;  
 };
 
@@ -223,177 +608,264 @@ struct AccumulatedConfidences {
 };
 
 /**
-* @brief TimeSeries it's a circular buffer of Samples
-* THIS CLASS IS NOT THREAD SAFE!
+* @brief TimeSeriesBase the samples of TimeSeries and StaticTimeSeries, and the queries over them (CRTP)
+* Derived keeps its algorithm up to date with clearAlgorithm(), removeOldValue(const T&) and addNewValue(const T&),
+* resolved at compile time
 */
-template <typename T, typename U>
-class TimeSeries {
+template <typename Derived, typename T, typename Storage>
+class TimeSeriesBase {
 public:
-
-  TimeSeries(const size_t& max_size,
-    std::unique_ptr<BestAlgorithm<T, U>> best_algo = std::make_unique<NullAlgorithm<T, U>>()):
-    samples_(max_size), best_algo_(std::move(best_algo)) { }
-
   void clear() {
-    samples_.clear();
-    best_algo_->clear();
+    storage_.clear();
+    derived().clearAlgorithm();
   }
 
   std::size_t size() const {
-    return samples_.size();
+    return storage_.size();
   }
 
   bool empty() const {
-    return samples_.empty();
+    return storage_.empty();
   }
 
   std::size_t capacity() const {
-    return samples_.capacity();
+    return storage_.capacity();
   }
 
   void addSample(const T& value, const uint64_t& timestamp) {
     // Algorithm takes into account the oldest sample being removed
-    if (samples_.full()) {
-      best_algo_->removeOldValue(samples_.front().value_);
+    if (storage_.full()) {
+      derived().removeOldValue(storage_.value(0));
     }
 
     // add new value into Time Series
-    samples_.push_back(Sample<T>(value, timestamp));
+    storage_.push_back(value, timestamp);
 
     // Algorithm takes into account the new added value
-    best_algo_->addNewValue(value);
+    derived().addNewValue(value);
+
+    // the samples older than max_age are removed too
+    if (max_age_ != NO_MAX_AGE) {
+      // a timestamp going backwards does not evict anything, instead of wrapping around
+      while (!storage_.empty() && timestamp >= storage_.timestamp(0) && timestamp - storage_.timestamp(0) >= max_age_) {
+        derived().removeOldValue(storage_.value(0));
+        storage_.pop_front();
+      }
+    }
+  }
+
+  // keep only the samples younger than max_age (in timestamp units, e.g. microseconds), relative to the newest one,
+  // the capacity is still the upper bound. NO_MAX_AGE, i.e. zero, disables it. It is applied from the next addSample()
+  void setMaxAge(const uint64_t& max_age) {
+    max_age_ = max_age;
+  }
+
+  const uint64_t& maxAge() const {
+    return max_age_;
   }
 
+  // the samples are returned by reference with a CircularStorage, by value with a ColumnarStorage
+  // (the fields of a sample are not side by side), the values are always returned by reference
   // the oldest sample
-  const Sample<T> oldestSample() const {
-    if (samples_.empty()) {
+  decltype(auto) oldestSample() const {
+    if (storage_.empty()) {
       throw std::out_of_range("Out of range");
     }
-    return samples_.front();
+    return storage_.sample(0);
+  }
+
+  const T& oldestValue() const {
+    if (storage_.empty()) {
+      throw std::out_of_range("Out of range");
+    }
+    return storage_.value(0);
   }
 
   // the newest sample
-  const Sample<T> newestSample() const {
-    if (samples_.empty()) {
+  decltype(auto) newestSample() const {
+    if (storage_.empty()) {
+      throw std::out_of_range("Out of range");
+    }
+    return storage_.sample(storage_.size() - 1);
+  }
+
+  const T& newestValue() const {
+    if (storage_.empty()) {
       throw std::out_of_range("Out of range");
     }
-    return samples_.back();
+    return storage_.value(storage_.size() - 1);
   }
 
   // postition zero is the oldest
-  const Sample<T> at(const std::size_t& pos) const {
-    if (pos >= samples_.size()) {
+  decltype(auto) at(const std::size_t& pos) const {
+    if (pos >= storage_.size()) {
       throw std::out_of_range("Out of range");
     }
-    return samples_[pos];
+    return storage_.sample(pos);
   }
 
-  // oldest first
-  const boost::circular_buffer<Sample<T>>& samples() const {
-    return samples_;
+  // the timestamps must be pushed in order: the queries below are binary searches, O(log n),
+  // returning zero-copy views invalidated by the next change of the TimeSeries
+  // (RingView of the samples with a CircularStorage, ColumnarView with a ColumnarStorage)
+  // the samples whose timestamp is in [begin, end)
+  typename Storage::View range(const uint64_t& begin, const uint64_t& end) const {
+    std::size_t first = storage_.lowerBound(begin);
+    return storage_.view(first, std::max(first, storage_.lowerBound(end)));
+  }
+
+  // the samples whose timestamp is not less than begin
+  typename Storage::View since(const uint64_t& begin) const {
+    return storage_.view(storage_.lowerBound(begin), storage_.size());
+  }
+
+  // the samples younger than duration, relative to the newest one
+  typename Storage::View window(const uint64_t& duration) const {
+    if (storage_.empty() || duration == 0) {
+      return storage_.view(0, 0);
+    }
+    const uint64_t& newest = storage_.timestamp(storage_.size() - 1);
+    return since(newest >= duration ? newest - duration + 1 : 0);
+  }
+
+  // oldest first, only with a CircularStorage
+  template <typename S = Storage>
+  auto samples() const -> decltype(std::declval<const S&>().buffer()) {
+    return storage_.buffer();
+  }
+
+  // zero-copy view of the samples as two contiguous spans, oldest first, only with a CircularStorage
+  template <typename S = Storage>
+  auto samplesView() const -> decltype(std::declval<const S&>().samplesView()) {
+    return storage_.samplesView();
+  }
+
+  // zero-copy views of the columns, oldest first, only with a ColumnarStorage
+  template <typename S = Storage>
+  auto values() const -> decltype(std::declval<const S&>().values()) {
+    return storage_.values();
+  }
+
+  template <typename S = Storage>
+  auto timestamps() const -> decltype(std::declval<const S&>().timestamps()) {
+    return storage_.timestamps();
+  }
+
+  const Storage& storage() const {
+    return storage_;
   }
 
   // it does a copy, oldest first
   const std::vector<T> valuesCopy() const {
     std::vector<T> values;
-    std::transform(samples_.begin(), samples_.end(), std::back_inserter(values), std::mem_fn(&Sample<T>::value_));
+    values.reserve(storage_.size());
+    for (std::size_t pos = 0; pos < storage_.size(); ++pos) {
+      values.push_back(storage_.value(pos));
+    }
     return values;
   }
 
-  U getBestValue() const {
-    return best_algo_->getBestValue();
-  }
+protected:
+  explicit TimeSeriesBase(const std::size_t& max_size) : storage_(max_size) {}
+  ~TimeSeriesBase() = default;
 
-  BestAlgorithm<T, U>* getBestValueAlgorithm() {
-    return best_algo_.get();
-  }
+  Storage storage_;
+  uint64_t max_age_{ NO_MAX_AGE };
 
 private:
-  boost::circular_buffer<Sample<T>> samples_;
-  std::unique_ptr<BestAlgorithm<T, U>> best_algo_;
+  Derived& derived() {
+    return static_cast<Derived&>(*this);
+  }
 };
 
-
 /**
 * @brief TimeSeries it's a circular buffer of Samples
+* Storage is CircularStorage (boost::circular_buffer of Samples) or ColumnarStorage (a column per field)
 * THIS CLASS IS NOT THREAD SAFE!
-
-template <std::size_t SIZE, typename T, typename Algo = NullAlgorithm<T>>
-class TimeSeries {
+*/
+template <typename T, typename U, typename Storage = CircularStorage<T>>
+class TimeSeries : public TimeSeriesBase<TimeSeries<T, U, Storage>, T, Storage> {
 public:
 
-  TimeSeries() {}
+  TimeSeries(const size_t& max_size,
+    std::unique_ptr<BestAlgorithm<T, U>> best_algo = std::make_unique<NullAlgorithm<T, U>>()):
+    TimeSeriesBase<TimeSeries, T, Storage>(max_size), best_algo_(std::move(best_algo)) { }
 
-  void clear() {
-    samples_.clear();
-    algo_.clear();
+  U getBestValue() const {
+    return best_algo_->getBestValue();
   }
 
-  std::size_t size() const {
-    return samples_.size();
+  BestAlgorithm<T, U>* getBestValueAlgorithm() {
+    return best_algo_.get();
   }
 
-  bool empty() const {
-    return samples_.empty();
+private:
+  friend class TimeSeriesBase<TimeSeries, T, Storage>;
+
+  void clearAlgorithm() {
+    best_algo_->clear();
   }
 
-  std::size_t capacity() const {
-    return samples_.capacity();
+  void removeOldValue(const T& value) {
+    best_algo_->removeOldValue(value);
   }
 
-  void addSample(const T& value, const uint64_t& timestamp) {
-    // Algorithm takes into account the oldest sample being removed
-    if (samples_.full()) {
-      algo_.removeOldValue(samples_.front().value_);
-    }
+  void addNewValue(const T& value) {
+    best_algo_->addNewValue(value);
+  }
 
-    // add new value into Time Series
-    samples_.push_back(Sample<T>(value, timestamp));
+  std::unique_ptr<BestAlgorithm<T, U>> best_algo_;
+};
 
-    // Algorithm takes into account the new added value
-    algo_.addNewValue(value);
+
+/**
+* @brief StaticTimeSeries it's a circular buffer of SIZE Samples
+* The algorithm is a policy held by value: no heap object, and its calls are resolved at compile time
+* Algo is any type with clear(), removeOldValue(const T&) and addNewValue(const T&),
+* e.g. NewestValue, TopFrequency, TopFrequencyBitmask, BitMaskOccurrences or AccumulatedConfidences
+* Storage is CircularStorage or ColumnarStorage, as for TimeSeries
+* THIS CLASS IS NOT THREAD SAFE!
+*/
+template <std::size_t SIZE, typename T, typename Algo = NullAlgorithm<T, T>, typename Storage = CircularStorage<T>>
+class StaticTimeSeries : public TimeSeriesBase<StaticTimeSeries<SIZE, T, Algo, Storage>, T, Storage> {
+public:
+  static constexpr std::size_t CAPACITY = SIZE;
+
+  // the arguments are forwarded to the algorithm, e.g. the max_flags of TopFrequencyBitmask
+  template <typename... Args, typename = std::enable_if_t<std::is_constructible<Algo, Args&&...>::value>>
+  explicit StaticTimeSeries(Args&&... args) : TimeSeriesBase<StaticTimeSeries, T, Storage>(SIZE), algo_(std::forward<Args>(args)...) {}
+
+  constexpr std::size_t capacity() const {
+    return SIZE;
   }
 
-  // the oldest sample
-  const Sample<T> oldestSample() const {
-    if (samples_.empty()) {
-      throw std::out_of_range("Out of range");
-    }
-    return samples_.front();
+  // only for the algorithms computing a best value
+  template <typename A = Algo>
+  auto getBestValue() const -> decltype(std::declval<const A&>().getBestValue()) {
+    return algo_.getBestValue();
   }
 
-  // the newest sample
-  const Sample<T> newestSample() const {
-    if (samples_.empty()) {
-      throw std::out_of_range("Out of range");
-    }
-    return samples_.back();
+  Algo& algorithm() {
+    return algo_;
   }
 
-  // postition zero is the oldest
-  const Sample<T> at(const std::size_t& pos) const {
-    if (pos >= samples_.size()) {
-      throw std::out_of_range("Out of range");
-    }
-    return samples_[pos];
+  const Algo& algorithm() const {
+    return algo_;
   }
 
-  // oldest first
-  const boost::circular_buffer<Sample<T>>& samples() const {
-    return samples_;
+private:
+  friend class TimeSeriesBase<StaticTimeSeries, T, Storage>;
+
+  void clearAlgorithm() {
+    algo_.clear();
   }
 
-  // it does a copy, oldest first
-  const std::vector<T> valuesCopy() const {
-    std::vector<T> values;
-    std::transform(samples_.begin(), samples_.end(), std::back_inserter(values), std::mem_fn(&Sample<T>::value_));
-    return values;
+  void removeOldValue(const T& value) {
+    algo_.removeOldValue(value);
   }
 
-  Algo algo_;
-  
+  void addNewValue(const T& value) {
+    algo_.addNewValue(value);
+  }
 
-private:
-  boost::circular_buffer<Sample<T>> samples_{ SIZE };
+  Algo algo_;
 };
-*/
\ No newline at end of file
@@ -84,18 +84,20 @@ public:
     ts_data_map[timestamp].push_back(data);
   }
 
+  // a reference to the stored data, valid until the next pushData()
   template <typename T>
-  data_t getData(const uint64_t& timestamp) {
+  const data_t& getData(const uint64_t& timestamp) const {
+    static const data_t no_data;
     std::type_index data_type = typeid(T);
     auto it = type_data_map_.find(data_type);
     if (it != type_data_map_.end()) {
-      ts_data_map_t& ts_data_map = it->second;
+      const ts_data_map_t& ts_data_map = it->second;
       auto it_ts = ts_data_map.find(timestamp);
       if (it_ts != ts_data_map.end()) {
-        return ts_data_map[timestamp];
+        return it_ts->second;
       }
     }
-    return data_t();
+    return no_data;
   }
 
 };
@@ -18,7 +18,7 @@ public:
   template <typename T>
   void addSample(const uint64_t& timestamp, T& value) {
     // find all indices
-    index_vector_t indices = getTimeSeriesIndices<T>();
+    const index_vector_t& indices = getTimeSeriesIndices<T>();
 
     // timeseries doesn't exist yet
     if (indices.empty()) { 
@@ -82,7 +82,7 @@ public:
   template <typename T>
   std::shared_ptr<TimeSeries<T>> getTimeSeries(const int& id = Attribute::UNIQUE_ID) const {
     // find all indices
-    index_vector_t indices = getTimeSeriesIndices<T>();
+    const index_vector_t& indices = getTimeSeriesIndices<T>();
     // is the id for that timeseries?
     if (id >= indices.size()) {
       return nullptr;
@@ -95,7 +95,7 @@ public:
   std::vector<std::shared_ptr<TimeSeries<T>>> getAllTimeSeries() {
     std::vector<std::shared_ptr<TimeSeries<T>>> all_timeseries;
     // find all indices
-    index_vector_t indices = getTimeSeriesIndices<T>();
+    const index_vector_t& indices = getTimeSeriesIndices<T>();
     for (auto& index : indices) {
       std::shared_ptr<TimeSeries<T>> timeseries = std::static_pointer_cast<TimeSeries<T>>(timeseries_[index]);
       all_timeseries.push_back(timeseries);
@@ -106,13 +106,14 @@ public:
 
 private:
   template <typename T>
-  index_vector_t getTimeSeriesIndices() const {
+  const index_vector_t& getTimeSeriesIndices() const {
     auto it = index_map_.find(typeid(T));
     if (it != index_map_.end()) {
       return it->second;
     }
 
-    return index_vector_t(); // no indices
+    static const index_vector_t no_indices;
+    return no_indices;
   }
 
   template <typename T>
@@ -4,6 +4,7 @@
 #include <queue>
 #include <functional>
 #include <boost/circular_buffer.hpp>
+#include <boost/range/iterator_range.hpp>
 
 #define NO_TIMESTAMP 0ULL
 /**
@@ -22,6 +23,25 @@ struct Sample {
 
 
 
+/**
+* @brief SamplesView the samples of a TimeSeries as two contiguous spans of the ring, oldest first, without copy
+* It is invalidated by the next change of the TimeSeries
+*/
+template <typename T>
+struct SamplesView {
+  using Span = boost::iterator_range<const Sample<T>*>;
+
+  std::size_t size() const { return first_.size() + second_.size(); }
+  bool empty() const { return size() == 0; }
+  // postition zero is the oldest
+  const Sample<T>& operator[](const std::size_t& pos) const {
+    return pos < first_.size() ? first_[pos] : second_[pos - first_.size()];
+  }
+
+  Span first_;
+  Span second_;
+};
+
 /**
 * @brief TimeSeries it's a circular buffer of Samples
 * THIS CLASS IS NOT THREAD SAFE!
@@ -57,14 +77,14 @@ public:
   }
 
   // the oldest sample
-  const Sample<T> oldestSample() const {
+  const Sample<T>& oldestSample() const {
     if (samples_.empty()) {
       throw std::out_of_range("Out of range: the TimeSeries is empty");
     }
     return samples_.front();
   }
 
-  const T oldestValue() const {
+  const T& oldestValue() const {
     if (samples_.empty()) {
       throw std::out_of_range("Out of range: the TimeSeries is empty");
     }
@@ -72,14 +92,14 @@ public:
   }
 
   // the newest sample
-  const Sample<T> newestSample() const {
+  const Sample<T>& newestSample() const {
     if (samples_.empty()) {
       throw std::out_of_range("Out of range: the TimeSeries is empty");
     }
     return samples_.back();
   }
 
-  const T newestValue() const {
+  const T& newestValue() const {
     if (samples_.empty()) {
       throw std::out_of_range("Out of range: the TimeSeries is empty");
     }
@@ -87,7 +107,7 @@ public:
   }
 
   // postition zero is the oldest
-  const Sample<T> at(const std::size_t& pos) const {
+  const Sample<T>& at(const std::size_t& pos) const {
     if (pos >= samples_.size()) {
       throw std::out_of_range("Out of range: the TimeSeries is empty");
     }
@@ -111,6 +131,13 @@ public:
     return samples_;
   }
 
+  // zero-copy view of the samples, oldest first
+  SamplesView<T> samplesView() const {
+    auto first = samples_.array_one();
+    auto second = samples_.array_two();
+    return { { first.first, first.first + first.second }, { second.first, second.first + second.second } };
+  }
+
   // it does a copy, oldest first
   const std::vector<T> valuesCopy() const {
     std::vector<T> values;